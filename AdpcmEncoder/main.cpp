@@ -0,0 +1,100 @@
+// Encodes a WAV file, or a headerless file in the default format, into a compressed
+// file (see soundsys/Adpcm.h) that the library plays like any other.
+// The samples are converted to 16 bits first. Mono and stereo only.
+//
+// USAGE
+//	adpcmencoder input.wav output.adpcm [frames-per-block]
+//
+//	frames-per-block	the size of the blocks, even, 128 by default. Larger blocks
+//						compress a little more, smaller ones decode at a finer grain.
+//
+#include "../soundsys/Adpcm.h"
+#include "../soundsys/AudioFormat.h"
+#include "../soundsys/SampleConversion.h"
+#include "../soundsys/WavHeader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+// ReadSamples reads the audio data of a file as 16-bit samples.
+static bool ReadSamples(const char *filename, OUT sound::WavInfo *info, OUT std::vector<int16_t> *samples)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file || sound::ParseWavHeader(&file, info) || info->compressed) {
+		return false;
+	}
+
+	std::vector<byte> data(info->dataSize);
+	file.read((char *)data.data(), data.size());
+	if (static_cast<size_t>(file.gcount()) != data.size()) {
+		return false;
+	}
+
+	const auto numSamples = info->dataSize / (info->format.wBitsPerSample / 8);
+	samples->resize(numSamples);
+
+	switch (sound::SampleTypeOf(info->format)) {
+	case sound::SAMPLE_TYPE_S16: {
+		samples->assign(reinterpret_cast<const int16_t *>(data.data()), reinterpret_cast<const int16_t *>(data.data()) + numSamples);
+	}break;
+
+	case sound::SAMPLE_TYPE_S24: {
+		std::vector<float> f32(numSamples);
+		sound::ConvertS24ToF32(f32.data(), data.data(), numSamples);
+		sound::ConvertF32ToS16(samples->data(), f32.data(), numSamples);
+	}break;
+
+	case sound::SAMPLE_TYPE_F32: {
+		sound::ConvertF32ToS16(samples->data(), reinterpret_cast<const float *>(data.data()), numSamples);
+	}break;
+
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3) {
+		fprintf(stderr, "usage: adpcmencoder input.wav output.adpcm [frames-per-block]\n");
+		return 1;
+	}
+
+	const size_t framesPerBlock = (argc > 3) ? strtoul(argv[3], nullptr, 10) : sound::kAdpcmDefaultFramesPerBlock;
+	if (framesPerBlock < 2 || framesPerBlock % 2 != 0 || framesPerBlock > sound::kAdpcmMaxFramesPerBlock) {
+		fprintf(stderr, "The number of frames per block must be even, from 2 to %zu.\n", sound::kAdpcmMaxFramesPerBlock);
+		return 1;
+	}
+
+	sound::WavInfo info;
+	std::vector<int16_t> samples;
+	if (!ReadSamples(argv[1], &info, &samples)) {
+		fprintf(stderr, "Cannot read the audio file %s.\n", argv[1]);
+		return 1;
+	}
+
+	const auto numChannels = info.format.nChannels;
+	if (numChannels != 1 && numChannels != 2) {
+		fprintf(stderr, "Only mono and stereo files can be encoded.\n");
+		return 1;
+	}
+
+	std::vector<byte> encoded;
+	sound::EncodeAdpcm(samples.data(), samples.size() / numChannels, numChannels, info.format.nSamplesPerSec, framesPerBlock, &encoded);
+
+	std::ofstream out(argv[2], std::ios::binary);
+	out.write((const char *)encoded.data(), encoded.size());
+	if (!out) {
+		fprintf(stderr, "Cannot write %s.\n", argv[2]);
+		return 1;
+	}
+
+	printf("%s: %zu bytes of samples, %zu bytes compressed (%.2f:1)\n", argv[2], samples.size() * sizeof(int16_t),
+		encoded.size(), samples.size() * sizeof(int16_t) / static_cast<double>(encoded.size()));
+
+	return 0;
+}
@@ -0,0 +1,63 @@
+// Builds an asset pack (see soundsys/AssetPack.h) out of audio files: WAV files,
+// compressed files or headerless files in the default format.
+// Each asset is named after its filename as given, which is the name the game plays it by.
+//
+// USAGE
+//	assetpacker output.pack file... [@list.txt]
+//
+//	@list.txt	adds the files listed in a text file, one per line
+//
+#include "../soundsys/AssetPack.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// ReadList appends the lines of a list file, except the empty ones.
+static bool ReadList(const char *filename, std::vector<std::string> *filenames)
+{
+	std::ifstream list(filename);
+	if (!list) {
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(list, line)) {
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		if (!line.empty()) {
+			filenames->push_back(line);
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3) {
+		fprintf(stderr, "usage: assetpacker output.pack file... [@list.txt]\n");
+		return 1;
+	}
+
+	std::vector<std::string> filenames;
+	for (int i = 2; i < argc; i++) {
+		if (argv[i][0] != '@') {
+			filenames.push_back(argv[i]);
+		}
+		else if (!ReadList(argv[i] + 1, &filenames)) {
+			fprintf(stderr, "Cannot read the list %s.\n", argv[i] + 1);
+			return 1;
+		}
+	}
+
+	if (sound::BuildAssetPack(argv[1], filenames)) {
+		fprintf(stderr, "Cannot build %s: a file is missing, unsupported or listed twice.\n", argv[1]);
+		return 1;
+	}
+
+	printf("%s: %zu assets\n", argv[1], filenames.size());
+	return 0;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// The result of a benchmark: the fastest of its runs.
+// samples is the number of samples a run processes, bytes the number of bytes of its input,
+// or of its output for the functions that have no input.
+struct BenchResult {
+	std::string		name;
+	uint64_t		samples;
+	uint64_t		bytes;
+	uint64_t		ns;
+	int				runs;
+
+	double NsPerSample() const { return samples ? (double)ns / samples : 0.; }
+	double BytesPerSecond() const { return ns ? bytes * 1e9 / ns : 0.; }
+};
+
+// CLASS:		BenchSuite
+//
+// PURPOSE:		Runs the benchmarks whose name contains the filter, prints their results
+//				as they come and keeps them for the JSON report.
+//				A benchmark runs once to warm up the caches, then again until it ran for
+//				kMinDuration and at least kMinRuns times. The fastest run is reported:
+//				the others were slowed down by something else.
+//
+class BenchSuite {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static const int kMinRuns = 5;
+	static const int kMaxRuns = 10000;
+
+	BenchSuite(const char *filter) : m_filter(filter ? filter : "") {}
+
+	// Enabled returns true iff the benchmarks named name must run.
+	bool Enabled(const std::string &name) const
+	{
+		return name.find(m_filter) != std::string::npos;
+	}
+
+	const std::vector<BenchResult> &Results() const { return m_results; }
+
+	// Run measures body, a function that processes numSamples samples read from numBytes bytes.
+	template <class Body>
+	void Run(const std::string &name, uint64_t numSamples, uint64_t numBytes, Body body)
+	{
+		if (!Enabled(name)) {
+			return;
+		}
+
+		body();
+
+		const auto kMinDuration = std::chrono::milliseconds(200);
+		auto start = Clock::now();
+		auto best = Clock::duration::max();
+		int runs = 0;
+		while (runs < kMaxRuns && (runs < kMinRuns || Clock::now() - start < kMinDuration)) {
+			auto runStart = Clock::now();
+			body();
+			best = std::min(best, Clock::now() - runStart);
+			runs++;
+		}
+
+		auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(best).count();
+		Record(BenchResult{ name, numSamples, numBytes, static_cast<uint64_t>(ns), runs });
+	}
+
+	// Record keeps the result of a benchmark measured by the caller.
+	void Record(const BenchResult &result)
+	{
+		printf("%-40s %10.3f ns/sample %10.1f MB/s\n", result.name.c_str(), result.NsPerSample(), result.BytesPerSecond() / 1e6);
+		m_results.push_back(result);
+	}
+
+	// WriteJson writes the results, in the order they were recorded, so that the reports
+	// of two versions can be diffed.
+	bool WriteJson(const char *filename, const char *simdLevel) const;
+
+private:
+	std::string					m_filter;
+	std::vector<BenchResult>	m_results;
+};
+
+// The benchmarks add the bytes they read to g_benchSink, so that the compiler cannot
+// remove the reads.
+extern volatile uint64_t g_benchSink;
+
+void BenchReader(BenchSuite *suite);
+void BenchBufferWrites(BenchSuite *suite);
+void BenchKernels(BenchSuite *suite);
+void BenchRender(BenchSuite *suite);
+void BenchPause(BenchSuite *suite);
+void BenchStreaming(BenchSuite *suite, const char *filename);
@@ -0,0 +1,34 @@
+// Region writes through the headless backend: the copy into the device buffer,
+// with the lock and unlock around it, for several latencies.
+//
+#include "Bench.h"
+#include "../soundsys/AudioFormat.h"
+#include "../soundsys/HeadlessDevice.h"
+#include "../soundsys/StreamingBuffer.h"
+
+void BenchBufferWrites(BenchSuite *suite)
+{
+	if (!suite->Enabled("buffer/")) {
+		return;
+	}
+
+	const auto format = sound::MakeWaveFormat(WAVE_FORMAT_PCM, 2, 48000, 16);
+	const int kNumRegions = 4;
+	const int kNumLaps = 16;
+
+	for (DWORD latencyMs : { 20, 80, 400 }) {
+		sound::NullDevice device;
+		sound::StreamingBuffer buffer(&device, format, latencyMs, kNumRegions);
+
+		std::vector<byte> region(buffer.RegionSize(), 0x11);
+		const uint64_t numBytes = static_cast<uint64_t>(buffer.RegionSize()) * kNumRegions * kNumLaps;
+
+		suite->Run("buffer/write_region/" + std::to_string(latencyMs) + "ms", numBytes / 2, numBytes, [&]() {
+			for (int lap = 0; lap < kNumLaps; lap++) {
+				for (int i = 0; i < kNumRegions; i++) {
+					buffer.WriteToRegion(i, region.data());
+				}
+			}
+		});
+	}
+}
@@ -0,0 +1,145 @@
+// The mixing and conversion kernels, for every instruction set the CPU supports,
+// the resampler for each quality, and the decoder of compressed files.
+// The buffers fit in the L1 cache: this measures the computation, not the memory.
+//
+#include "Bench.h"
+#include "../soundsys/Adpcm.h"
+#include "../soundsys/Cpu.h"
+#include "../soundsys/MixKernels.h"
+#include "../soundsys/Resampler.h"
+#include "../soundsys/SampleConversion.h"
+
+static const size_t	kNumSamples = 4096;
+static const size_t	kNumFrames = kNumSamples / 2;
+
+static void BenchConversionKernels(BenchSuite *suite, const sound::ConversionKernels &k)
+{
+	const std::string suffix = std::string("/") + sound::SimdLevelName(k.level);
+
+	std::vector<int16_t> s16(kNumSamples, 1234);
+	std::vector<byte> s24(3 * kNumSamples, 0x12);
+	std::vector<float> f32(kNumSamples, 0.25f);
+	std::vector<float> left(kNumFrames, 0.25f), right(kNumFrames, -0.25f);
+	std::vector<float> out(2 * kNumSamples);
+
+	suite->Run("convert/s16_to_f32" + suffix, kNumSamples, 2 * kNumSamples, [&]() {
+		k.s16ToF32(out.data(), s16.data(), kNumSamples);
+	});
+	suite->Run("convert/f32_to_s16" + suffix, kNumSamples, 4 * kNumSamples, [&]() {
+		k.f32ToS16(s16.data(), f32.data(), kNumSamples);
+	});
+	suite->Run("convert/s24_to_f32" + suffix, kNumSamples, 3 * kNumSamples, [&]() {
+		k.s24ToF32(out.data(), s24.data(), kNumSamples);
+	});
+	suite->Run("convert/f32_to_s24" + suffix, kNumSamples, 4 * kNumSamples, [&]() {
+		k.f32ToS24(s24.data(), f32.data(), kNumSamples);
+	});
+	suite->Run("convert/mono_to_stereo" + suffix, kNumSamples, 4 * kNumSamples, [&]() {
+		k.monoToStereo(out.data(), f32.data(), kNumSamples);
+	});
+	suite->Run("convert/stereo_to_mono" + suffix, kNumSamples, 4 * kNumSamples, [&]() {
+		k.stereoToMono(out.data(), f32.data(), kNumFrames);
+	});
+	suite->Run("convert/interleave" + suffix, kNumSamples, 4 * kNumSamples, [&]() {
+		k.interleave(out.data(), left.data(), right.data(), kNumFrames);
+	});
+	suite->Run("convert/deinterleave" + suffix, kNumSamples, 4 * kNumSamples, [&]() {
+		k.deinterleave(left.data(), right.data(), f32.data(), kNumFrames);
+	});
+}
+
+// BenchMixKernels measures the mixing kernels: the SIMD ones picked at compile time
+// when simd is true, their scalar versions otherwise.
+static void BenchMixKernels(BenchSuite *suite, bool simd)
+{
+	const std::string suffix = simd ? "/simd" : "/scalar";
+
+	std::vector<int16_t> s16(kNumSamples, 1234);
+	std::vector<float> f32(kNumSamples, 0.25f);
+	std::vector<float> acc(kNumSamples, 0.f);
+	std::vector<float> gains(kNumFrames, 0.5f);
+
+	suite->Run("mix/accumulate_s16" + suffix, kNumSamples, 2 * kNumSamples, [&]() {
+		(simd ? sound::AccumulateS16 : sound::AccumulateS16_Scalar)(acc.data(), s16.data(), kNumSamples, 0.5f);
+	});
+	suite->Run("mix/accumulate_f32" + suffix, kNumSamples, 4 * kNumSamples, [&]() {
+		(simd ? sound::AccumulateF32 : sound::AccumulateF32_Scalar)(acc.data(), f32.data(), kNumSamples, 0.5f);
+	});
+	suite->Run("mix/accumulate_s16_ramp" + suffix, kNumSamples, 2 * kNumSamples, [&]() {
+		(simd ? sound::AccumulateS16Ramp : sound::AccumulateS16Ramp_Scalar)(acc.data(), s16.data(), kNumFrames, 2, gains.data());
+	});
+	suite->Run("mix/accumulate_f32_ramp" + suffix, kNumSamples, 4 * kNumSamples, [&]() {
+		(simd ? sound::AccumulateF32Ramp : sound::AccumulateF32Ramp_Scalar)(acc.data(), f32.data(), kNumFrames, 2, gains.data());
+	});
+	suite->Run("mix/linear_ramp" + suffix, kNumFrames, 4 * kNumFrames, [&]() {
+		(simd ? sound::FillLinearRamp : sound::FillLinearRamp_Scalar)(gains.data(), kNumFrames, 0.f, 1.f / kNumFrames);
+	});
+	suite->Run("mix/exponential_ramp" + suffix, kNumFrames, 4 * kNumFrames, [&]() {
+		(simd ? sound::FillExponentialRamp : sound::FillExponentialRamp_Scalar)(gains.data(), kNumFrames, 1.f, 0.999f);
+	});
+}
+
+// BenchResampler converts stereo audio from 44.1 kHz to 48 kHz, in chunks of the size of a refill.
+static void BenchResampler(BenchSuite *suite, sound::RESAMPLER_QUALITY quality, const char *name)
+{
+	const size_t kChunkFrames = 4800;
+
+	sound::Resampler resampler;
+	resampler.Init(44100, 48000, 2, quality, kChunkFrames);
+
+	std::vector<float> in(2 * resampler.MaxInputFrames(), 0.1f);
+	std::vector<float> out(2 * kChunkFrames);
+
+	const uint64_t numSamples = 2 * kChunkFrames;
+	suite->Run(std::string("resample/") + name, numSamples, numSamples * sizeof(float), [&]() {
+		auto numIn = resampler.InputFramesNeeded(kChunkFrames);
+		resampler.Process(in.data(), numIn, out.data(), kChunkFrames);
+	});
+}
+
+// BenchAdpcmDecoder decodes stereo blocks, one unit after the other and by groups of units.
+static void BenchAdpcmDecoder(BenchSuite *suite)
+{
+	const size_t kFramesPerBlock = sound::kAdpcmDefaultFramesPerBlock;
+	const size_t kNumBlocks = kNumFrames / kFramesPerBlock;
+
+	std::vector<int16_t> tone(2 * kNumFrames);
+	for (size_t i = 0; i < tone.size(); i++) {
+		tone[i] = static_cast<int16_t>((i * 2654435761u) >> 20);
+	}
+	std::vector<byte> file;
+	sound::EncodeAdpcm(tone.data(), kNumFrames, 2, 44100, kFramesPerBlock, &file);
+
+	const byte *blocks = file.data() + sound::kAdpcmHeaderSize;
+	const uint64_t numBytes = file.size() - sound::kAdpcmHeaderSize;
+	std::vector<int16_t> out(tone.size());
+
+	suite->Run("codec/adpcm_decode/scalar", tone.size(), numBytes, [&]() {
+		sound::DecodeAdpcmBlocks_Scalar(out.data(), blocks, kNumBlocks, 2, kFramesPerBlock);
+	});
+	suite->Run("codec/adpcm_decode/lanes", tone.size(), numBytes, [&]() {
+		sound::DecodeAdpcmBlocks(out.data(), blocks, kNumBlocks, 2, kFramesPerBlock);
+	});
+}
+
+void BenchKernels(BenchSuite *suite)
+{
+	const auto best = sound::DetectSimdLevel();
+	for (int level = sound::SIMD_LEVEL_SCALAR; level <= best; level++) {
+		const auto &kernels = sound::GetConversionKernels(static_cast<sound::SIMD_LEVEL>(level));
+
+		// Levels that are not compiled in fall back on a lower one, already measured.
+		if (kernels.level == level) {
+			BenchConversionKernels(suite, kernels);
+		}
+	}
+
+	BenchMixKernels(suite, false);
+	BenchMixKernels(suite, true);
+
+	BenchResampler(suite, sound::RESAMPLER_QUALITY_LOW, "low");
+	BenchResampler(suite, sound::RESAMPLER_QUALITY_MEDIUM, "medium");
+	BenchResampler(suite, sound::RESAMPLER_QUALITY_HIGH, "high");
+
+	BenchAdpcmDecoder(suite);
+}
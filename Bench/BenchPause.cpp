@@ -0,0 +1,128 @@
+// Round trips of a music paused and played again, with a streaming thread and a device
+// that plays in real time: the time from the request that stops the output to the
+// streaming thread playing it again.
+// A sample is a round trip: the ns/sample column is the latency of a round trip.
+//	- pause/resume		Pause then Resume: the buffer goes on from its play cursor;
+//	- pause/stop_play	Stop then Play: the file is opened again and the buffer refilled.
+//
+#include "Bench.h"
+#include "../soundsys/HeadlessDevice.h"
+#include "../soundsys/SoundSystem.h"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+static const char	*kPauseFilename = "bench_pause.tmp";
+static const DWORD	kPauseSeconds = 30;
+static const int	kNumRoundTrips = 200;
+
+static bool CreatePauseFile(const WAVEFORMATEX &format)
+{
+	std::vector<int16_t> samples(kPauseSeconds * format.nSamplesPerSec * format.nChannels);
+	for (size_t i = 0; i < samples.size(); i++) {
+		samples[i] = static_cast<int16_t>(i * 37);
+	}
+
+	std::ofstream file(kPauseFilename, std::ios::binary);
+	file.write((const char *)samples.data(), samples.size() * sizeof(int16_t));
+
+	return static_cast<bool>(file);
+}
+
+// WaitFor spins until done returns true. Returns false after a second.
+template <class Condition>
+static bool WaitFor(Condition done)
+{
+	const auto start = BenchSuite::Clock::now();
+	while (!done()) {
+		if (BenchSuite::Clock::now() - start > std::chrono::seconds(1)) {
+			return false;
+		}
+		std::this_thread::yield();
+	}
+
+	return true;
+}
+
+// RoundTrips measures kNumRoundTrips round trips of a playing music:
+// stop stops the output, and start plays it again.
+// Only the second half of each round trip is timed: stopping is the same for both.
+template <class Stop, class Start>
+static void RoundTrips(BenchSuite *suite, const char *name, Stop stop, Start start)
+{
+	if (!suite->Enabled(name)) {
+		return;
+	}
+
+	// Without the cache, Play reads the file again, as it would a music too big for the cache.
+	sound::SoundSystemDesc desc;
+	desc.cacheBudgetBytes = 0;
+
+	sound::SoundSystem *system = nullptr;
+	if (sound::CreateSoundSystem(new sound::NullDevice(sound::DEVICE_CLOCK_REAL_TIME), &system, desc)) {
+		fprintf(stderr, "Cannot create the sound system.\n");
+		return;
+	}
+
+	sound::AssetHandle asset;
+	if (system->Register(kPauseFilename, &asset) || system->Play(asset) || !WaitFor([&]() { return system->IsPlaying(); })) {
+		fprintf(stderr, "Cannot play %s.\n", kPauseFilename);
+		sound::DestroySoundSystem(&system);
+		return;
+	}
+
+	uint64_t totalNs = 0;
+	uint64_t worstNs = 0;
+	for (int i = 0; i < kNumRoundTrips; i++) {
+		if (!stop(system, asset)) {
+			fprintf(stderr, "%s: the output did not stop.\n", name);
+			break;
+		}
+
+		const auto begin = BenchSuite::Clock::now();
+		if (!start(system, asset)) {
+			fprintf(stderr, "%s: the output did not play again.\n", name);
+			break;
+		}
+		const auto ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(BenchSuite::Clock::now() - begin).count());
+
+		totalNs += ns;
+		worstNs = std::max(worstNs, ns);
+	}
+
+	const auto health = system->Health();
+	sound::DestroySoundSystem(&system);
+
+	suite->Record(BenchResult{ name, kNumRoundTrips, 0, totalNs, kNumRoundTrips });
+	printf("%-40s %10.3f us worst, %llu underruns\n", "", worstNs / 1e3, (unsigned long long)health.numUnderruns);
+}
+
+void BenchPause(BenchSuite *suite)
+{
+	if (!suite->Enabled("pause/")) {
+		return;
+	}
+	if (!CreatePauseFile(sound::DefaultWaveFormat())) {
+		fprintf(stderr, "Cannot create %s.\n", kPauseFilename);
+		return;
+	}
+
+	RoundTrips(suite, "pause/resume",
+		[](sound::SoundSystem *system, sound::AssetHandle) {
+			return !system->Pause() && WaitFor([&]() { return system->IsPaused(); });
+		},
+		[](sound::SoundSystem *system, sound::AssetHandle) {
+			return !system->Resume() && WaitFor([&]() { return !system->IsPaused(); });
+		});
+
+	RoundTrips(suite, "pause/stop_play",
+		[](sound::SoundSystem *system, sound::AssetHandle) {
+			return !system->Stop() && WaitFor([&]() { return !system->IsPlaying(); });
+		},
+		[](sound::SoundSystem *system, sound::AssetHandle asset) {
+			return !system->Play(asset) && WaitFor([&]() { return system->IsPlaying(); });
+		});
+
+	remove(kPauseFilename);
+}
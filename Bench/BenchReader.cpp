@@ -0,0 +1,170 @@
+// AudioFileReader::Read at several chunk sizes, for each way of reading a file:
+// from an ifstream, from the read-ahead thread, from a mapped file and from the asset cache,
+// and from a compressed file in memory, decoded while it is read.
+// Also the opening of many small files, from the disk and from an asset pack.
+// The file is in the page cache: this measures the reader, not the disk.
+//
+#include "Bench.h"
+#include "../soundsys/Adpcm.h"
+#include "../soundsys/AssetCache.h"
+#include "../soundsys/AudioFileReader.h"
+#include "../soundsys/MappedFile.h"
+#include "../soundsys/Voice.h"
+
+#include <cstdio>
+#include <fstream>
+
+static const char	*kReaderFilename = "bench_reader.tmp";
+static const size_t	kReaderFileSize = 8 << 20;
+
+// ReadAll reads the reader up to EOF, touching a byte per cache line of each chunk
+// as a consumer would.
+static void ReadAll(sound::AudioFileReader *reader, size_t chunkSize)
+{
+	uint64_t sum = 0;
+	while (reader->Read(chunkSize) == ERROR_NONE) {
+		auto data = reader->Data();
+		for (size_t i = 0; i < data.size; i += 64) {
+			sum += data.ptr[i];
+		}
+	}
+	g_benchSink += sum;
+}
+
+static bool CreateReaderFile()
+{
+	std::vector<char> data(kReaderFileSize);
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = static_cast<char>(i * 7);
+	}
+
+	std::ofstream file(kReaderFilename, std::ios::binary);
+	file.write(data.data(), data.size());
+
+	return static_cast<bool>(file);
+}
+
+// BenchOpen opens small sounds one after the other, as a burst of sound effects would,
+// from their files and from a pack of them.
+static void BenchOpen(BenchSuite *suite)
+{
+	const int kNumFiles = 256;
+	const size_t kFileSize = 4096;
+	const size_t kMaxFrames = 1024;
+
+	std::vector<std::string> filenames;
+	std::vector<byte> data(kFileSize, 0x12);
+	for (int i = 0; i < kNumFiles; i++) {
+		filenames.push_back("bench_open_" + std::to_string(i) + ".tmp");
+		std::ofstream file(filenames.back(), std::ios::binary);
+		file.write((const char *)data.data(), data.size());
+	}
+
+	sound::AssetPack pack;
+	if (sound::BuildAssetPack("bench_open.pack", filenames) || pack.Open("bench_open.pack")) {
+		fprintf(stderr, "Cannot create bench_open.pack.\n");
+	}
+	else {
+		sound::Voice voice;
+		const uint64_t numSamples = kNumFiles * kFileSize / 2;
+
+		suite->Run("reader/open_file", numSamples, kNumFiles * kFileSize, [&]() {
+			for (const auto &filename : filenames) {
+				voice.Open(filename.c_str(), kMaxFrames);
+				voice.Read(kMaxFrames);
+			}
+		});
+
+		voice.SetAssetPack(&pack);
+		suite->Run("reader/open_pack", numSamples, kNumFiles * kFileSize, [&]() {
+			for (const auto &filename : filenames) {
+				voice.Open(filename.c_str(), kMaxFrames);
+				voice.Read(kMaxFrames);
+			}
+		});
+		voice.Close();
+		pack.Close();
+	}
+
+	for (const auto &filename : filenames) {
+		remove(filename.c_str());
+	}
+	remove("bench_open.pack");
+}
+
+void BenchReader(BenchSuite *suite)
+{
+	if (!suite->Enabled("reader/")) {
+		return;
+	}
+	if (!CreateReaderFile()) {
+		fprintf(stderr, "Cannot create %s.\n", kReaderFilename);
+		return;
+	}
+
+	// 16-bit samples.
+	const uint64_t numSamples = kReaderFileSize / 2;
+
+	sound::AssetCache cache(kReaderFileSize, 1);
+	{
+		sound::MappedFile mapped;
+		if (mapped.Open(kReaderFilename) == ERROR_NONE) {
+			cache.Insert(1, &mapped);
+		}
+	}
+
+	// The same samples, compressed.
+	std::vector<byte> compressed;
+	{
+		std::vector<int16_t> samples(numSamples);
+		for (size_t i = 0; i < samples.size(); i++) {
+			samples[i] = static_cast<int16_t>(i * 7);
+		}
+		sound::EncodeAdpcm(samples.data(), samples.size(), 1, 44100, sound::kAdpcmDefaultFramesPerBlock, &compressed);
+	}
+
+	for (size_t chunkSize : { 256, 4096, 65536 }) {
+		const auto suffix = "/" + std::to_string(chunkSize);
+
+		suite->Run("reader/ifstream" + suffix, numSamples, kReaderFileSize, [chunkSize]() {
+			std::ifstream file(kReaderFilename, std::ios::binary);
+			sound::AudioFileReader reader(chunkSize, &file, kReaderFileSize);
+			ReadAll(&reader, chunkSize);
+		});
+
+		suite->Run("reader/readahead" + suffix, numSamples, kReaderFileSize, [chunkSize]() {
+			std::ifstream file(kReaderFilename, std::ios::binary);
+			sound::AudioFileReader reader(chunkSize, &file, kReaderFileSize);
+			reader.StartReadAhead(chunkSize, chunkSize, 8);
+			ReadAll(&reader, chunkSize);
+			reader.StopReadAhead();
+		});
+
+		suite->Run("reader/mmap" + suffix, numSamples, kReaderFileSize, [chunkSize]() {
+			sound::MappedFile mapped;
+			if (mapped.Open(kReaderFilename) == ERROR_NONE) {
+				sound::AudioFileReader reader(chunkSize, mapped.Data(), mapped.Size());
+				ReadAll(&reader, chunkSize);
+			}
+		});
+
+		suite->Run("reader/cache" + suffix, numSamples, kReaderFileSize, [chunkSize, &cache]() {
+			auto asset = cache.Find(1);
+			if (asset) {
+				sound::AudioFileReader reader(chunkSize, asset.Data(), asset.Size());
+				ReadAll(&reader, chunkSize);
+			}
+		});
+
+		const auto codedSize = compressed.size() - sound::kAdpcmHeaderSize;
+		suite->Run("reader/adpcm" + suffix, numSamples, codedSize, [chunkSize, codedSize, &compressed]() {
+			sound::AudioFileReader reader(chunkSize, compressed.data() + sound::kAdpcmHeaderSize, codedSize);
+			reader.SetAdpcm(1, sound::kAdpcmDefaultFramesPerBlock, kReaderFileSize);
+			ReadAll(&reader, chunkSize);
+		});
+	}
+
+	remove(kReaderFilename);
+
+	BenchOpen(suite);
+}
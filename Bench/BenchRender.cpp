@@ -0,0 +1,89 @@
+// Offline renders of many sounds at once: the throughput of the whole mixing path,
+// from the files to the buffer, without a device clock.
+// A sample is a sample of a voice: a render of 500 voices mixes 500 samples per output sample.
+//
+#include "Bench.h"
+#include "../soundsys/HeadlessDevice.h"
+#include "../soundsys/SoundSystem.h"
+
+#include <cstdio>
+#include <fstream>
+
+static const char	*kRenderFilename = "bench_render.tmp";
+static const DWORD	kRenderSeconds = 10;
+
+static bool CreateRenderFile(const WAVEFORMATEX &format)
+{
+	std::vector<int16_t> samples(kRenderSeconds * format.nSamplesPerSec * format.nChannels);
+	uint32_t noise = 1;
+	for (auto &sample : samples) {
+		noise = noise * 1664525 + 1013904223;
+		sample = static_cast<int16_t>(noise >> 20);
+	}
+
+	std::ofstream file(kRenderFilename, std::ios::binary);
+	file.write((const char *)samples.data(), samples.size() * sizeof(int16_t));
+
+	return static_cast<bool>(file);
+}
+
+// RenderVoices renders the file played by numVoices sounds at once, to its end.
+static void RenderVoices(BenchSuite *suite, int numVoices)
+{
+	const auto name = "render/" + std::to_string(numVoices) + "_voices";
+	if (!suite->Enabled(name)) {
+		return;
+	}
+
+	sound::SoundSystemDesc desc;
+	desc.maxSounds = numVoices;
+
+	sound::SoundSystem *system = nullptr;
+	if (sound::CreateOfflineSoundSystem(new sound::NullDevice(sound::DEVICE_CLOCK_MANUAL), &system, desc)) {
+		fprintf(stderr, "Cannot create the sound system.\n");
+		return;
+	}
+
+	sound::AssetHandle asset;
+	if (system->Register(kRenderFilename, &asset)) {
+		fprintf(stderr, "Cannot register %s.\n", kRenderFilename);
+		sound::DestroySoundSystem(&system);
+		return;
+	}
+
+	const DWORD numFrames = kRenderSeconds * desc.format.nSamplesPerSec;
+
+	auto start = BenchSuite::Clock::now();
+	for (int i = 0; i < numVoices; i++) {
+		// The requests are handled when the queue is full.
+		if (system->PlaySound(asset)) {
+			system->Render(0);
+			system->PlaySound(asset);
+		}
+	}
+	system->Render(numFrames);
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(BenchSuite::Clock::now() - start);
+
+	sound::DestroySoundSystem(&system);
+
+	const uint64_t numSamples = static_cast<uint64_t>(numFrames) * desc.format.nChannels * numVoices;
+	suite->Record(BenchResult{ name, numSamples, numSamples * sizeof(int16_t), static_cast<uint64_t>(elapsed.count()), 1 });
+	printf("%-40s %10.1fx real time\n", "", kRenderSeconds * 1e9 / elapsed.count());
+}
+
+void BenchRender(BenchSuite *suite)
+{
+	if (!suite->Enabled("render/")) {
+		return;
+	}
+	if (!CreateRenderFile(sound::DefaultWaveFormat())) {
+		fprintf(stderr, "Cannot create %s.\n", kRenderFilename);
+		return;
+	}
+
+	for (int numVoices : { 1, 64, 500 }) {
+		RenderVoices(suite, numVoices);
+	}
+
+	remove(kRenderFilename);
+}
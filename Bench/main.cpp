@@ -0,0 +1,131 @@
+// Micro-benchmarks of the library, reported in ns/sample and in bytes/s:
+//	- stream/		an audio file streamed through a headless device, as fast as possible;
+//	- reader/		AudioFileReader::Read, for each way of reading a file and several chunk sizes,
+//					and the opening of small files, from the disk and from an asset pack;
+//	- buffer/		region writes through the headless backend;
+//	- convert/		the conversion kernels, for each instruction set the CPU supports;
+//	- mix/			the mixing kernels, SIMD and scalar;
+//	- resample/		the resampler, for each quality;
+//	- codec/		the decoder of compressed files;
+//	- render/		offline renders of many sounds at once;
+//	- pause/		the latency of a music paused and played again, in ns per round trip.
+//
+// USAGE
+//	bench [--filter text] [--json report.json] [file.bin]
+//
+//	--filter	only runs the benchmarks whose name contains the text
+//	--json		also writes the results to a JSON file, to diff them between versions
+//
+#include "Bench.h"
+#include "../soundsys/SoundSystem.h"
+#include "../soundsys/Cpu.h"
+#include "../soundsys/HeadlessDevice.h"
+
+#include <cstring>
+#include <thread>
+
+volatile uint64_t g_benchSink = 0;
+
+bool BenchSuite::WriteJson(const char *filename, const char *simdLevel) const
+{
+	auto file = fopen(filename, "w");
+	if (!file) {
+		return false;
+	}
+
+	fprintf(file, "{\n\t\"simd\": \"%s\",\n\t\"benchmarks\": [\n", simdLevel);
+	for (size_t i = 0; i < m_results.size(); i++) {
+		const auto &r = m_results[i];
+		fprintf(file, "\t\t{ \"name\": \"%s\", \"ns_per_sample\": %.4f, \"bytes_per_second\": %.0f, "
+			"\"samples\": %llu, \"bytes\": %llu, \"ns\": %llu, \"runs\": %d }%s\n",
+			r.name.c_str(), r.NsPerSample(), r.BytesPerSecond(),
+			(unsigned long long)r.samples, (unsigned long long)r.bytes, (unsigned long long)r.ns, r.runs,
+			(i + 1 < m_results.size()) ? "," : "");
+	}
+	fprintf(file, "\t]\n}\n");
+
+	return fclose(file) == 0;
+}
+
+// BenchStreaming plays the file once: it is long enough not to be repeated.
+void BenchStreaming(BenchSuite *suite, const char *filename)
+{
+	const auto name = std::string("stream/") + filename;
+	if (!suite->Enabled(name)) {
+		return;
+	}
+
+	// The system owns the device but we keep an eye on the number of bytes played.
+	auto device = new sound::NullDevice(sound::DEVICE_CLOCK_AS_FAST_AS_POSSIBLE);
+
+	sound::SoundSystemDesc desc;
+
+	sound::SoundSystem *system = nullptr;
+	auto err = sound::CreateSoundSystem(device, &system, desc);
+	if (err) {
+		fprintf(stderr, "Cannot create the sound system.\n");
+		return;
+	}
+
+	auto start = BenchSuite::Clock::now();
+	system->Play(filename);
+
+	// The streaming thread plays the file as fast as it can, then stops the buffer.
+	while (device->PlayedBytes() == 0 || system->IsPlaying()) {
+		std::this_thread::yield();
+
+		if (BenchSuite::Clock::now() - start > std::chrono::seconds(10)) {
+			fprintf(stderr, "Cannot play %s.\n", filename);
+			sound::DestroySoundSystem(&system);
+			return;
+		}
+	}
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(BenchSuite::Clock::now() - start);
+
+	const auto playedBytes = device->PlayedBytes();
+	const auto bytesPerSample = desc.format.wBitsPerSample / 8;
+	suite->Record(BenchResult{ name, playedBytes / bytesPerSample, playedBytes, static_cast<uint64_t>(elapsed.count()), 1 });
+
+	sound::DestroySoundSystem(&system);
+}
+
+int main(int argc, char **argv)
+{
+	const char *filename = "ff3boss_raccourcie.bin";
+	const char *filter = nullptr;
+	const char *jsonFilename = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			filter = argv[++i];
+		}
+		else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+			jsonFilename = argv[++i];
+		}
+		else if (argv[i][0] == '-') {
+			fprintf(stderr, "usage: bench [--filter text] [--json report.json] [file.bin]\n");
+			return 1;
+		}
+		else {
+			filename = argv[i];
+		}
+	}
+
+	const auto simdLevel = sound::SimdLevelName(sound::DetectSimdLevel());
+	printf("CPU: %s\n", simdLevel);
+
+	BenchSuite suite(filter);
+	BenchStreaming(&suite, filename);
+	BenchReader(&suite);
+	BenchBufferWrites(&suite);
+	BenchKernels(&suite);
+	BenchRender(&suite);
+	BenchPause(&suite);
+
+	if (jsonFilename && !suite.WriteJson(jsonFilename, simdLevel)) {
+		fprintf(stderr, "Cannot write %s.\n", jsonFilename);
+		return 1;
+	}
+
+	return 0;
+}
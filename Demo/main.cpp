@@ -1,5 +1,6 @@
 // Always include this header before the line #define WIN32_LEAN_AND_MEAN
 #include "../soundsys/SoundSystem.h"
+#include "../soundsys/Trace.h"
 
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
@@ -82,6 +83,7 @@ Error Initialize(IN HINSTANCE instance)
 void Shutdown(HINSTANCE instance)
 {
 	sound::DestroySoundSystem(&g_soundSys);
+	sound::WriteTraceFile("demo.trace");
 	UnregisterClass(kWindowClassName, instance);
 }
 
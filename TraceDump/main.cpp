@@ -0,0 +1,55 @@
+// Prints the records of a trace file, written by sound::WriteTraceFile,
+// one line per record, with times relative to the first record.
+//
+// USAGE
+//	tracedump file.trace [min-level]
+//
+//	min-level	the least severe level printed: error, warning, info or verbose (default)
+//
+#include "../soundsys/Trace.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static int ParseLevel(const char *name)
+{
+	const char *kNames[] = { "error", "warning", "info", "verbose" };
+	for (int i = 0; i < 4; i++) {
+		if (strcmp(name, kNames[i]) == 0) {
+			return sound::TRACE_LEVEL_ERROR + i;
+		}
+	}
+
+	return -1;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: tracedump file.trace [error|warning|info|verbose]\n");
+		return 1;
+	}
+
+	auto minLevel = (argc > 2) ? ParseLevel(argv[2]) : sound::TRACE_LEVEL_VERBOSE;
+	if (minLevel < 0) {
+		fprintf(stderr, "Unknown level %s.\n", argv[2]);
+		return 1;
+	}
+
+	std::vector<sound::TraceRecord> records;
+	auto err = sound::ReadTraceFile(argv[1], &records);
+	if (err) {
+		fprintf(stderr, "Cannot read the trace file %s.\n", argv[1]);
+		return 1;
+	}
+
+	const auto startNs = records.empty() ? 0 : records.front().timeNs;
+	for (const auto &record : records) {
+		if (record.level <= minLevel) {
+			printf("%s\n", sound::DescribeTraceRecord(record, startNs).c_str());
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,241 @@
+#include "pch.h"
+#include "Adpcm.h"
+#include <algorithm>
+#include <cstring>
+
+namespace sound {
+
+	static const char	kAdpcmSignature[4] = { 'S', 'A', 'D', 'P' };
+	static const WORD	kAdpcmVersion = 1;
+
+	static const int	kMaxStepIndex = 88;
+
+	static const int16_t kStepTable[kMaxStepIndex + 1] = {
+		7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+		19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+		50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+		130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+		337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+		876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+		2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+		5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+		15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+	};
+
+	static const int8_t kIndexTable[16] = {
+		-1, -1, -1, -1, 2, 4, 6, 8,
+		-1, -1, -1, -1, 2, 4, 6, 8
+	};
+
+	static uint16_t Read16(const byte *p)
+	{
+		return static_cast<uint16_t>(p[0] | (p[1] << 8));
+	}
+
+	static uint32_t Read32(const byte *p)
+	{
+		return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+			| (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+	}
+
+	static void Write16(std::vector<byte> *out, uint16_t v)
+	{
+		out->push_back(static_cast<byte>(v));
+		out->push_back(static_cast<byte>(v >> 8));
+	}
+
+	static void Write32(std::vector<byte> *out, uint32_t v)
+	{
+		Write16(out, static_cast<uint16_t>(v));
+		Write16(out, static_cast<uint16_t>(v >> 16));
+	}
+
+	// DecodeNibble updates the state of a unit with the next nibble and returns the sample.
+	// The difference is computed with a multiplication rather than by adding the bits of the
+	// nibble one by one: without branches, which the random bits of a signal mispredict.
+	static inline int16_t DecodeNibble(int nibble, int *predictor, int *index)
+	{
+		const int step = kStepTable[*index];
+		const int diff = ((2 * (nibble & 7) + 1) * step) >> 3;
+
+		// Bit 3 is the sign.
+		const int sign = -(nibble >> 3);
+		auto p = *predictor + ((diff ^ sign) - sign);
+		*predictor = std::min(std::max(p, -32768), 32767);
+		*index = std::min(std::max(*index + kIndexTable[nibble], 0), kMaxStepIndex);
+
+		return static_cast<int16_t>(*predictor);
+	}
+
+	// A unit being decoded: its state, its nibbles and where its samples go.
+	struct AdpcmUnit {
+		int				predictor;
+		int				index;
+		const byte		*nibbles;
+		int16_t			*dst;
+	};
+
+	static AdpcmUnit StartUnit(const byte *src, size_t unit, int numChannels, size_t framesPerBlock, int16_t *dst)
+	{
+		const auto unitSize = kAdpcmUnitHeaderSize + framesPerBlock / 2;
+		const auto block = unit / numChannels;
+		const auto channel = unit % numChannels;
+
+		const byte *header = src + unit * unitSize;
+
+		AdpcmUnit u;
+		u.predictor = static_cast<int16_t>(Read16(header));
+		u.index = std::min<int>(header[2], kMaxStepIndex);
+		u.nibbles = header + kAdpcmUnitHeaderSize;
+		u.dst = dst + block * framesPerBlock * numChannels + channel;
+
+		return u;
+	}
+
+	static void DecodeUnit(AdpcmUnit u, int numChannels, size_t framesPerBlock)
+	{
+		for (size_t k = 0; k < framesPerBlock; k += 2) {
+			auto packed = u.nibbles[k / 2];
+			u.dst[k * numChannels] = DecodeNibble(packed & 0xF, &u.predictor, &u.index);
+			u.dst[(k + 1) * numChannels] = DecodeNibble(packed >> 4, &u.predictor, &u.index);
+		}
+	}
+
+
+	//					FILES
+	//
+
+	bool IsAdpcmFile(const byte *data, size_t size)
+	{
+		return size >= sizeof(kAdpcmSignature) && std::memcmp(data, kAdpcmSignature, sizeof(kAdpcmSignature)) == 0;
+	}
+
+	Error ParseAdpcmHeader(const byte *data, size_t size, OUT AdpcmInfo *info)
+	{
+		assert(info != nullptr);
+
+		if (size < kAdpcmHeaderSize || !IsAdpcmFile(data, size) || Read16(data + 4) != kAdpcmVersion) {
+			return ERROR_FAILURE;
+		}
+
+		info->numChannels = Read16(data + 6);
+		info->samplesPerSec = Read32(data + 8);
+		info->numFrames = Read32(data + 12);
+		info->framesPerBlock = Read16(data + 16);
+
+		const auto fpb = info->framesPerBlock;
+		if (info->numChannels < 1 || info->numChannels > 2 || info->samplesPerSec == 0
+			|| fpb < 2 || fpb % 2 != 0 || fpb > kAdpcmMaxFramesPerBlock) {
+			return ERROR_FAILURE;
+		}
+
+		return ERROR_NONE;
+	}
+
+	void EncodeAdpcm(const int16_t *samples, size_t numFrames, int numChannels, DWORD samplesPerSec,
+		size_t framesPerBlock, OUT std::vector<byte> *file)
+	{
+		assert(numChannels == 1 || numChannels == 2);
+		assert(framesPerBlock >= 2 && framesPerBlock % 2 == 0 && framesPerBlock <= kAdpcmMaxFramesPerBlock);
+		assert(file != nullptr);
+
+		const auto numBlocks = (numFrames + framesPerBlock - 1) / framesPerBlock;
+
+		file->clear();
+		file->reserve(kAdpcmHeaderSize + numBlocks * AdpcmBlockSize(numChannels, framesPerBlock));
+		file->insert(file->end(), kAdpcmSignature, kAdpcmSignature + sizeof(kAdpcmSignature));
+		Write16(file, kAdpcmVersion);
+		Write16(file, static_cast<uint16_t>(numChannels));
+		Write32(file, samplesPerSec);
+		Write32(file, static_cast<uint32_t>(numFrames));
+		Write16(file, static_cast<uint16_t>(framesPerBlock));
+		Write16(file, 0);
+
+		// The step index goes on from a block to the next: the first samples of a block
+		// are coded with a step that suits the signal.
+		int index[2] = { 0, 0 };
+
+		for (size_t b = 0; b < numBlocks; b++) {
+			const auto first = b * framesPerBlock;
+
+			for (int c = 0; c < numChannels; c++) {
+				auto sampleAt = [&](size_t f) -> int {
+					return (f < numFrames) ? samples[f * numChannels + c] : 0;
+				};
+
+				// The unit starts from its first sample: its first nibble codes a null difference.
+				int predictor = sampleAt(first);
+				Write16(file, static_cast<uint16_t>(predictor));
+				file->push_back(static_cast<byte>(index[c]));
+				file->push_back(0);
+
+				for (size_t k = 0; k < framesPerBlock; k += 2) {
+					byte packed = 0;
+
+					for (size_t j = 0; j < 2; j++) {
+						// The decoder reconstructs a difference of (m + 1/2) quarter steps.
+						int diff = sampleAt(first + k + j) - predictor;
+						int nibble = 0;
+						if (diff < 0) {
+							nibble = 8;
+							diff = -diff;
+						}
+						nibble |= std::min(4 * diff / kStepTable[index[c]], 7);
+
+						DecodeNibble(nibble, &predictor, &index[c]);
+						packed |= static_cast<byte>(nibble << (4 * j));
+					}
+
+					file->push_back(packed);
+				}
+			}
+		}
+	}
+
+
+	//					DECODING
+	//
+
+	void DecodeAdpcmBlocks_Scalar(int16_t *dst, const byte *src, size_t numBlocks, int numChannels, size_t framesPerBlock)
+	{
+		const auto numUnits = numBlocks * numChannels;
+
+		for (size_t unit = 0; unit < numUnits; unit++) {
+			DecodeUnit(StartUnit(src, unit, numChannels, framesPerBlock, dst), numChannels, framesPerBlock);
+		}
+	}
+
+	void DecodeAdpcmBlocks(int16_t *dst, const byte *src, size_t numBlocks, int numChannels, size_t framesPerBlock)
+	{
+		const int kNumLanes = 4;
+		const auto numUnits = numBlocks * numChannels;
+
+		// Groups of units decoded side by side: the chains of dependent samples of the
+		// lanes are independent and the CPU runs them in parallel.
+		size_t unit = 0;
+		for (; unit + kNumLanes <= numUnits; unit += kNumLanes) {
+			AdpcmUnit lanes[kNumLanes];
+			for (int l = 0; l < kNumLanes; l++) {
+				lanes[l] = StartUnit(src, unit + l, numChannels, framesPerBlock, dst);
+			}
+
+			for (size_t k = 0; k < framesPerBlock; k += 2) {
+				byte packed[kNumLanes];
+				for (int l = 0; l < kNumLanes; l++) {
+					packed[l] = lanes[l].nibbles[k / 2];
+				}
+				for (int l = 0; l < kNumLanes; l++) {
+					lanes[l].dst[k * numChannels] = DecodeNibble(packed[l] & 0xF, &lanes[l].predictor, &lanes[l].index);
+				}
+				for (int l = 0; l < kNumLanes; l++) {
+					lanes[l].dst[(k + 1) * numChannels] = DecodeNibble(packed[l] >> 4, &lanes[l].predictor, &lanes[l].index);
+				}
+			}
+		}
+
+		// The units left are less than a group.
+		for (; unit < numUnits; unit++) {
+			DecodeUnit(StartUnit(src, unit, numChannels, framesPerBlock, dst), numChannels, framesPerBlock);
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "framework.h"
+#include <vector>
+
+namespace sound {
+
+	// Compressed audio files: 16-bit samples coded as 4-bit IMA ADPCM, about 4:1.
+	//
+	// A file is a header followed by blocks. All the numbers are little endian.
+	//	"SADP"			signature
+	//	uint16			version, 1
+	//	uint16			number of channels, 1 or 2
+	//	uint32			sample rate
+	//	uint32			number of frames
+	//	uint16			frames per block, even
+	//	uint16			zero
+	//
+	// A block codes framesPerBlock frames, zero padded in the last block. It holds a unit per
+	// channel: a 4-byte header (the 16-bit predictor before the first sample, the step index
+	// and a zero) followed by a nibble per sample, the low nibble first.
+	// Every unit restarts the decoder: units decode independently of each other, so several
+	// of them are decoded side by side.
+
+	const size_t	kAdpcmHeaderSize = 20;
+	const size_t	kAdpcmUnitHeaderSize = 4;
+
+	// The encoder's block size: 128 frames, 2.9 ms at 44.1 kHz.
+	const size_t	kAdpcmDefaultFramesPerBlock = 128;
+	const size_t	kAdpcmMaxFramesPerBlock = 8192;
+
+	struct AdpcmInfo {
+		WORD	numChannels;
+		DWORD	samplesPerSec;
+		DWORD	numFrames;
+		WORD	framesPerBlock;
+	};
+
+	// AdpcmBlockSize returns the number of bytes of a block.
+	inline size_t AdpcmBlockSize(int numChannels, size_t framesPerBlock)
+	{
+		return numChannels * (kAdpcmUnitHeaderSize + framesPerBlock / 2);
+	}
+
+	// IsAdpcmFile returns true iff the data starts with the signature of a compressed file.
+	bool IsAdpcmFile(const byte *data, size_t size);
+
+	// ParseAdpcmHeader reads the header of a compressed file.
+	// Returns ERROR_FAILURE if it is not one, or if the header is not supported.
+	Error ParseAdpcmHeader(const byte *data, size_t size, OUT AdpcmInfo *info);
+
+	// EncodeAdpcm encodes interleaved 16-bit samples into a whole compressed file, header included.
+	//
+	// PRECONDITIONS
+	//	numChannels is 1 or 2
+	//	framesPerBlock is even and at most kAdpcmMaxFramesPerBlock
+	//
+	void EncodeAdpcm(const int16_t *samples, size_t numFrames, int numChannels, DWORD samplesPerSec,
+		size_t framesPerBlock, OUT std::vector<byte> *file);
+
+	// DecodeAdpcmBlocks decodes numBlocks whole blocks into interleaved 16-bit samples:
+	// numBlocks * framesPerBlock frames. Four units are decoded side by side, which hides
+	// the latency of the sample-to-sample dependency of each of them.
+	void DecodeAdpcmBlocks(int16_t *dst, const byte *src, size_t numBlocks, int numChannels, size_t framesPerBlock);
+
+	// The scalar version decodes one unit after the other. It computes the same results, bit for bit.
+	void DecodeAdpcmBlocks_Scalar(int16_t *dst, const byte *src, size_t numBlocks, int numChannels, size_t framesPerBlock);
+}
@@ -0,0 +1,213 @@
+#include "pch.h"
+#include "AssetCache.h"
+
+namespace sound {
+
+	//					ASSET
+	//
+
+	AssetCache::Asset::Asset(AssetCache *cache, size_t slot)
+		: m_cache(cache)
+		, m_slot(slot)
+	{
+		m_cache->m_slots[m_slot].numUsers++;
+	}
+
+	AssetCache::Asset &AssetCache::Asset::operator=(Asset &&other)
+	{
+		if (this != &other) {
+			reset();
+			m_cache = other.m_cache;
+			m_slot = other.m_slot;
+			other.m_cache = nullptr;
+		}
+
+		return *this;
+	}
+
+	const byte *AssetCache::Asset::Data() const
+	{
+		assert(m_cache != nullptr);
+		return m_cache->m_slots[m_slot].file.Data();
+	}
+
+	size_t AssetCache::Asset::Size() const
+	{
+		assert(m_cache != nullptr);
+		return m_cache->m_slots[m_slot].file.Size();
+	}
+
+	void AssetCache::Asset::reset()
+	{
+		if (m_cache) {
+			assert(m_cache->m_slots[m_slot].numUsers > 0);
+			m_cache->m_slots[m_slot].numUsers--;
+			m_cache = nullptr;
+		}
+	}
+
+
+	//					CACHE
+	//
+
+	AssetCache::AssetCache(size_t budgetBytes, size_t maxAssets)
+		: m_budget(budgetBytes)
+		, m_numSlots(maxAssets)
+		, m_slots(new Slot[maxAssets])
+	{}
+
+	AssetCache::~AssetCache()
+	{
+#ifndef NDEBUG
+		for (size_t i = 0; i < m_numSlots; i++) {
+			assert(m_slots[i].numUsers == 0);
+		}
+#endif
+	}
+
+	AssetCacheStats AssetCache::Stats() const
+	{
+		AssetCacheStats stats;
+		stats.hits = m_hits.load(std::memory_order_relaxed);
+		stats.misses = m_misses.load(std::memory_order_relaxed);
+		stats.evictions = m_evictions.load(std::memory_order_relaxed);
+		stats.residentBytes = m_residentBytes.load(std::memory_order_relaxed);
+		stats.budgetBytes = m_budget;
+
+		return stats;
+	}
+
+	AssetCache::Asset AssetCache::Find(AssetHandle handle)
+	{
+		const auto slot = SlotOf(handle);
+		if (slot == kNone || !m_slots[slot].resident) {
+			m_misses.fetch_add(1, std::memory_order_relaxed);
+			return Asset();
+		}
+
+		// Move the asset to the front: it is now the most recently used.
+		Unlink(slot);
+		Link(slot);
+
+		m_hits.fetch_add(1, std::memory_order_relaxed);
+		return Asset(this, slot);
+	}
+
+	AssetCache::Asset AssetCache::Insert(AssetHandle handle, MappedFile *file)
+	{
+		assert(file != nullptr && file->IsOpen());
+
+		const auto slot = SlotOf(handle);
+		if (slot == kNone) {
+			return Asset();
+		}
+
+		// Another voice played the same file to its end first.
+		if (m_slots[slot].resident) {
+			return Asset(this, slot);
+		}
+
+		const auto size = file->Size();
+		if (!MakeRoom(size)) {
+			return Asset();
+		}
+
+		auto &entry = m_slots[slot];
+		entry.file.Swap(*file);
+		entry.resident = true;
+		Link(slot);
+		m_residentBytes.fetch_add(size, std::memory_order_relaxed);
+
+		return Asset(this, slot);
+	}
+
+	void AssetCache::Clear()
+	{
+		auto slot = m_tail;
+		while (slot != kNone) {
+			auto prev = m_slots[slot].prev;
+			if (m_slots[slot].numUsers == 0) {
+				Evict(slot);
+			}
+			slot = prev;
+		}
+	}
+
+	size_t AssetCache::SlotOf(AssetHandle handle) const
+	{
+		if (handle == kInvalidAssetHandle || handle > m_numSlots) {
+			return kNone;
+		}
+
+		return handle - 1;
+	}
+
+	bool AssetCache::MakeRoom(size_t size)
+	{
+		if (size > m_budget) {
+			return false;
+		}
+
+		// Walk from the least recently used asset and skip the ones in use.
+		auto slot = m_tail;
+		while (m_residentBytes + size > m_budget && slot != kNone) {
+			auto prev = m_slots[slot].prev;
+			if (m_slots[slot].numUsers == 0) {
+				Evict(slot);
+			}
+			slot = prev;
+		}
+
+		return m_residentBytes + size <= m_budget;
+	}
+
+	void AssetCache::Evict(size_t slot)
+	{
+		auto &entry = m_slots[slot];
+		assert(entry.resident && entry.numUsers == 0);
+
+		m_residentBytes.fetch_sub(entry.file.Size(), std::memory_order_relaxed);
+		m_evictions.fetch_add(1, std::memory_order_relaxed);
+
+		Unlink(slot);
+		entry.file.Close();
+		entry.resident = false;
+	}
+
+	void AssetCache::Link(size_t slot)
+	{
+		auto &entry = m_slots[slot];
+		entry.prev = kNone;
+		entry.next = m_head;
+
+		if (m_head != kNone) {
+			m_slots[m_head].prev = slot;
+		}
+		else {
+			m_tail = slot;
+		}
+		m_head = slot;
+	}
+
+	void AssetCache::Unlink(size_t slot)
+	{
+		auto &entry = m_slots[slot];
+
+		if (entry.prev != kNone) {
+			m_slots[entry.prev].next = entry.next;
+		}
+		else {
+			m_head = entry.next;
+		}
+
+		if (entry.next != kNone) {
+			m_slots[entry.next].prev = entry.prev;
+		}
+		else {
+			m_tail = entry.prev;
+		}
+
+		entry.prev = kNone;
+		entry.next = kNone;
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "framework.h"
+#include <atomic>
+#include <memory>
+
+#include "AssetRegistry.h"
+#include "MappedFile.h"
+
+namespace sound {
+
+	// AssetCacheStats is a snapshot of the counters of an AssetCache.
+	struct AssetCacheStats {
+		uint64_t	hits{ 0 };
+		uint64_t	misses{ 0 };
+		uint64_t	evictions{ 0 };
+		size_t		residentBytes{ 0 };
+		size_t		budgetBytes{ 0 };
+	};
+
+	// CLASS:		AssetCache
+	//
+	// PURPOSE:		Keeps the files of recently played assets mapped, within a budget of bytes,
+	//				so that playing them again opens no file and maps nothing.
+	//				A voice that played a mapped file to its end hands the mapping over:
+	//				it is not copied, and the OS keeps its pages as long as memory allows.
+	//				When an asset does not fit, the least recently used assets are
+	//				evicted, except the ones still in use.
+	//
+	//				Assets are stored under their AssetHandle. The constructor allocates
+	//				everything: Find and Insert neither allocate nor copy, and only an
+	//				eviction makes a system call, to unmap a file.
+	//
+	//				The cache itself is used by a single thread; Stats can be called
+	//				from any thread.
+	//
+	class AssetCache {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(AssetCache);
+
+		// CLASS:		Asset
+		//
+		// PURPOSE:		A hold on a resident asset: the asset is not evicted while it is held.
+		//				An empty Asset holds nothing.
+		//
+		class Asset {
+		public:
+			Asset() {}
+			Asset(Asset &&other) { *this = std::move(other); }
+			Asset &operator=(Asset &&other);
+			~Asset() { reset(); }
+
+			explicit operator bool() const { return m_cache != nullptr; }
+
+			// Data returns the address of the first byte of the file.
+			const byte *Data() const;
+
+			size_t Size() const;
+
+			// reset releases the asset.
+			void reset();
+
+		private:
+			friend class AssetCache;
+			Asset(AssetCache *cache, size_t slot);
+
+			AssetCache	*m_cache{ nullptr };
+			size_t		m_slot{ 0 };
+		};
+
+		// The cache holds the assets of handles 1 to maxAssets.
+		AssetCache(size_t budgetBytes, size_t maxAssets);
+
+		// No Asset may outlive the cache.
+		~AssetCache();
+
+		//				ACCESSORS
+		//
+
+		// Stats returns the current value of the counters.
+		AssetCacheStats Stats() const;
+
+		//				MANIPULATORS
+		//
+
+		// Find returns the asset stored under the handle, or an empty Asset if it is not resident.
+		// It counts a hit or a miss and makes the asset the most recently used.
+		Asset Find(AssetHandle handle);
+
+		// Insert takes the mapping of file over and stores it under the handle: file is left
+		// closed, and the pointers into the mapping stay valid.
+		// If the asset is resident already, it is returned and file is left as is.
+		// Returns an empty Asset, and leaves file as is, if the handle is not one of the cache
+		// or if the asset does not fit in the budget, even after evicting every asset
+		// that is not in use.
+		Asset Insert(AssetHandle handle, MappedFile *file);
+
+		// Clear evicts all the assets that are not in use.
+		void Clear();
+
+	private:
+		static const size_t kNone = SIZE_MAX;
+
+		struct Slot {
+			MappedFile	file;
+			bool		resident{ false };
+			size_t		numUsers{ 0 };
+
+			// Neighbors in the list of the resident assets, most recently used first.
+			size_t		prev{ kNone };
+			size_t		next{ kNone };
+		};
+
+		// SlotOf returns the slot of a handle, or kNone if the handle is not one of the cache.
+		size_t SlotOf(AssetHandle handle) const;
+
+		// MakeRoom evicts least recently used assets until size more bytes fit in the budget.
+		// Returns false iff that is not possible.
+		bool MakeRoom(size_t size);
+
+		void Evict(size_t slot);
+
+		// Link makes a resident asset the most recently used; Unlink removes it from the list.
+		void Link(size_t slot);
+		void Unlink(size_t slot);
+
+	private:
+		size_t	m_budget;
+
+		size_t						m_numSlots;
+		std::unique_ptr<Slot[]>		m_slots;
+
+		// The least recently used asset is at the tail.
+		size_t	m_head{ kNone };
+		size_t	m_tail{ kNone };
+
+		std::atomic<uint64_t>	m_hits{ 0 };
+		std::atomic<uint64_t>	m_misses{ 0 };
+		std::atomic<uint64_t>	m_evictions{ 0 };
+		std::atomic<size_t>		m_residentBytes{ 0 };
+	};
+}
@@ -0,0 +1,273 @@
+#include "pch.h"
+#include "AssetPack.h"
+#include "Adpcm.h"
+#include "AudioFormat.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace sound {
+
+	static const char	kPackSignature[4] = { 'S', 'P', 'A', 'K' };
+	static const WORD	kPackVersion = 1;
+
+	// The fields of the header, past the signature and the version.
+	struct PackHeader {
+		uint32_t	numAssets;
+		uint32_t	numBuckets;
+		uint32_t	namesSize;
+	};
+
+	uint64_t PackHash(const char *name, size_t length)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < length; i++) {
+			hash ^= static_cast<byte>(name[i]);
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	// PackedFormat returns the format of the samples of an entry.
+	static WAVEFORMATEX PackedFormat(const PackEntry &entry)
+	{
+		return MakeWaveFormat(entry.formatTag, entry.numChannels, entry.samplesPerSec, entry.bitsPerSample);
+	}
+
+	// IsValidEntry returns true iff the entry lies within a pack of fileSize bytes and
+	// its audio data can be played.
+	static bool IsValidEntry(const PackEntry &entry, const char *names, size_t namesSize, size_t fileSize)
+	{
+		if (entry.nameOffset > namesSize || entry.nameLength >= namesSize - entry.nameOffset
+			|| names[entry.nameOffset + entry.nameLength] != 0
+			|| entry.hash != PackHash(names + entry.nameOffset, entry.nameLength)) {
+			return false;
+		}
+
+		if (entry.dataOffset > fileSize || entry.codedSize > fileSize - entry.dataOffset) {
+			return false;
+		}
+
+		const auto format = PackedFormat(entry);
+		if (!IsSupportedFormat(format) || entry.dataSize % format.nBlockAlign != 0) {
+			return false;
+		}
+
+		const auto fpb = entry.framesPerBlock;
+		if (fpb == 0) {
+			return entry.codedSize == entry.dataSize;
+		}
+
+		// The blocks of a compressed asset must cover its samples.
+		if (format.wBitsPerSample != 16 || fpb % 2 != 0 || fpb > kAdpcmMaxFramesPerBlock) {
+			return false;
+		}
+		const auto blockSize = AdpcmBlockSize(entry.numChannels, fpb);
+		const auto numFrames = entry.dataSize / format.nBlockAlign;
+		return entry.codedSize % blockSize == 0 && entry.codedSize / blockSize * fpb >= numFrames;
+	}
+
+	Error AssetPack::Open(const char *filename)
+	{
+		Close();
+
+		auto err = m_file.Open(filename);
+		if (err) {
+			return err;
+		}
+
+		const auto *data = m_file.Data();
+		const auto size = m_file.Size();
+
+		if (size < kPackHeaderSize || std::memcmp(data, kPackSignature, sizeof(kPackSignature)) != 0
+			|| data[4] != kPackVersion || data[5] != 0) {
+			Close();
+			return ERROR_FAILURE;
+		}
+
+		PackHeader header;
+		std::memcpy(&header, data + 8, sizeof(header));
+
+		// An empty bucket ends every search: there are more buckets than assets.
+		const auto numBuckets = static_cast<size_t>(header.numBuckets);
+		const auto tablesSize = static_cast<uint64_t>(header.numAssets) * sizeof(PackEntry) + numBuckets * sizeof(uint32_t);
+		if (numBuckets <= header.numAssets || (numBuckets & (numBuckets - 1)) != 0
+			|| tablesSize + header.namesSize > size - kPackHeaderSize) {
+			Close();
+			return ERROR_FAILURE;
+		}
+
+		m_numAssets = header.numAssets;
+		m_numBuckets = numBuckets;
+		m_entries = reinterpret_cast<const PackEntry *>(data + kPackHeaderSize);
+		m_buckets = reinterpret_cast<const uint32_t *>(m_entries + m_numAssets);
+		m_names = reinterpret_cast<const char *>(m_buckets + m_numBuckets);
+
+		for (size_t i = 0; i < m_numAssets; i++) {
+			if (!IsValidEntry(m_entries[i], m_names, header.namesSize, size)) {
+				DebugPrintfA("ERROR: AssetPack::Open() - The entry %zu of %s is invalid!\n", i, filename);
+				Close();
+				return ERROR_FAILURE;
+			}
+		}
+
+		for (size_t i = 0; i < m_numBuckets; i++) {
+			if (m_buckets[i] > m_numAssets) {
+				Close();
+				return ERROR_FAILURE;
+			}
+		}
+
+		// The streaming thread then starts any asset without a system call.
+		for (size_t i = 0; i < m_numAssets; i++) {
+			const auto &entry = m_entries[i];
+			m_file.Prefetch(static_cast<size_t>(entry.dataOffset), std::min(kPackPrefetchSize, static_cast<size_t>(entry.codedSize)));
+		}
+
+		return ERROR_NONE;
+	}
+
+	void AssetPack::Close()
+	{
+		m_file.Close();
+
+		m_numAssets = 0;
+		m_numBuckets = 0;
+		m_entries = nullptr;
+		m_buckets = nullptr;
+		m_names = nullptr;
+	}
+
+	bool AssetPack::Find(const char *name, OUT PackedAsset *asset) const
+	{
+		assert(name != nullptr);
+		assert(asset != nullptr);
+
+		if (!IsOpen()) {
+			return false;
+		}
+
+		const auto length = std::strlen(name);
+		const auto hash = PackHash(name, length);
+		const auto mask = m_numBuckets - 1;
+
+		// Linear probing: the buckets of the names that collide follow each other.
+		for (auto i = static_cast<size_t>(hash) & mask; m_buckets[i] != 0; i = (i + 1) & mask) {
+			const auto &entry = m_entries[m_buckets[i] - 1];
+			if (entry.hash != hash || entry.nameLength != length || std::memcmp(m_names + entry.nameOffset, name, length) != 0) {
+				continue;
+			}
+
+			asset->data = m_file.Data() + entry.dataOffset;
+			asset->info.format = PackedFormat(entry);
+			asset->info.dataOffset = static_cast<size_t>(entry.dataOffset);
+			asset->info.dataSize = static_cast<size_t>(entry.dataSize);
+			asset->info.compressed = (entry.framesPerBlock != 0);
+			asset->info.codedSize = static_cast<size_t>(entry.codedSize);
+			asset->info.framesPerBlock = entry.framesPerBlock;
+			return true;
+		}
+
+		return false;
+	}
+
+
+	//					BUILDING
+	//
+
+	// ReadAudioData reads the audio data of a file, compressed or not, and locates it.
+	static Error ReadAudioData(const std::string &filename, OUT WavInfo *info, OUT std::vector<byte> *data)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file || ParseWavHeader(&file, info)) {
+			return ERROR_FAILURE;
+		}
+
+		data->resize(info->compressed ? info->codedSize : info->dataSize);
+		file.read((char *)data->data(), data->size());
+
+		return (static_cast<size_t>(file.gcount()) == data->size()) ? ERROR_NONE : ERROR_READ;
+	}
+
+	Error BuildAssetPack(const char *packFilename, const std::vector<std::string> &filenames)
+	{
+		const auto numAssets = filenames.size();
+
+		size_t numBuckets = 1;
+		while (numBuckets < 2 * numAssets) {
+			numBuckets *= 2;
+		}
+
+		std::vector<PackEntry> entries(numAssets);
+		std::vector<uint32_t> buckets(numBuckets, 0);
+		std::string names;
+
+		for (size_t i = 0; i < numAssets; i++) {
+			const auto &name = filenames[i];
+			auto &entry = entries[i];
+			entry = PackEntry{};
+			entry.hash = PackHash(name.data(), name.size());
+			entry.nameOffset = static_cast<uint32_t>(names.size());
+			entry.nameLength = static_cast<uint32_t>(name.size());
+			names.append(name);
+			names.push_back('\0');
+
+			auto b = static_cast<size_t>(entry.hash) & (numBuckets - 1);
+			for (; buckets[b] != 0; b = (b + 1) & (numBuckets - 1)) {
+				if (filenames[buckets[b] - 1] == name) {
+					DebugPrintfA("ERROR: BuildAssetPack() - %s comes twice!\n", name.c_str());
+					return ERROR_FAILURE;
+				}
+			}
+			buckets[b] = static_cast<uint32_t>(i + 1);
+		}
+
+		// The data of the first asset comes after the tables, on a page boundary.
+		auto align = [](uint64_t offset) { return (offset + kPackAlignment - 1) / kPackAlignment * kPackAlignment; };
+		auto offset = align(kPackHeaderSize + numAssets * sizeof(PackEntry) + numBuckets * sizeof(uint32_t) + names.size());
+
+		std::vector<std::vector<byte>> data(numAssets);
+		for (size_t i = 0; i < numAssets; i++) {
+			WavInfo info;
+			if (ReadAudioData(filenames[i], &info, &data[i])) {
+				DebugPrintfA("ERROR: BuildAssetPack() - %s is not a supported audio file!\n", filenames[i].c_str());
+				return ERROR_FAILURE;
+			}
+
+			auto &entry = entries[i];
+			entry.dataOffset = offset;
+			entry.dataSize = info.dataSize;
+			entry.codedSize = data[i].size();
+			entry.formatTag = SampleTypeOf(info.format) == SAMPLE_TYPE_F32 ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+			entry.numChannels = info.format.nChannels;
+			entry.samplesPerSec = info.format.nSamplesPerSec;
+			entry.bitsPerSample = info.format.wBitsPerSample;
+			entry.framesPerBlock = info.framesPerBlock;
+
+			offset = align(offset + data[i].size());
+		}
+
+		std::ofstream file(packFilename, std::ios::binary);
+
+		byte header[kPackHeaderSize] = { 0 };
+		std::memcpy(header, kPackSignature, sizeof(kPackSignature));
+		header[4] = static_cast<byte>(kPackVersion);
+		const PackHeader fields = { static_cast<uint32_t>(numAssets), static_cast<uint32_t>(numBuckets), static_cast<uint32_t>(names.size()) };
+		std::memcpy(header + 8, &fields, sizeof(fields));
+
+		file.write((const char *)header, sizeof(header));
+		file.write((const char *)entries.data(), entries.size() * sizeof(PackEntry));
+		file.write((const char *)buckets.data(), buckets.size() * sizeof(uint32_t));
+		file.write(names.data(), names.size());
+
+		for (size_t i = 0; i < numAssets; i++) {
+			// Zeros up to the page of the asset.
+			const std::vector<char> padding(static_cast<size_t>(entries[i].dataOffset - static_cast<uint64_t>(file.tellp())), 0);
+			file.write(padding.data(), padding.size());
+			file.write((const char *)data[i].data(), data[i].size());
+		}
+
+		return file ? ERROR_NONE : ERROR_FAILURE;
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "framework.h"
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "WavHeader.h"
+
+namespace sound {
+
+	// Asset packs: many audio files in a single file, looked up by name in a hash table.
+	//
+	// A pack is a header, a table of entries, a table of buckets, the names, then the
+	// audio data of the assets. All the numbers are little endian.
+	//	"SPAK"			signature
+	//	uint16			version, 1
+	//	uint16			zero
+	//	uint32			number of assets
+	//	uint32			number of buckets, a power of two larger than the number of assets
+	//	uint32			number of bytes of the names
+	//	uint32			zero
+	//	uint64			zero
+	// The entries (see PackEntry) follow, then the buckets: a uint32 per bucket, the index
+	// of an entry plus one, or zero if the bucket is empty. An asset is in the first bucket
+	// from hash % numBuckets on, going up, that refers to its entry.
+	// The names are stored one after the other, each followed by a zero.
+	// The audio data of each asset starts on a page boundary: it is read in place from
+	// the mapped pack, without being parsed or copied.
+
+	const size_t	kPackHeaderSize = 32;
+	const size_t	kPackAlignment = 4096;
+
+	// Number of bytes at the start of each asset that Open asks the OS to load:
+	// the first chunks played, so that a music queued with PlayNext starts without a fault.
+	const size_t	kPackPrefetchSize = 64 * 1024;
+
+	// PackEntry describes an asset. It is read in place from the mapped pack.
+	struct PackEntry {
+		uint64_t	hash;				// PackHash of the name
+		uint32_t	nameOffset;			// offset of the name from the first name
+		uint32_t	nameLength;			// number of bytes of the name, without the ending zero
+		uint64_t	dataOffset;			// offset of the audio data in the pack
+		uint64_t	dataSize;			// number of bytes of samples
+		uint64_t	codedSize;			// number of bytes of the data in the pack, dataSize if not compressed
+		uint16_t	formatTag;
+		uint16_t	numChannels;
+		uint32_t	samplesPerSec;
+		uint16_t	bitsPerSample;
+		uint16_t	framesPerBlock;		// 0 if not compressed (see Adpcm.h)
+		uint32_t	reserved;
+	};
+	static_assert(sizeof(PackEntry) == 56, "PackEntry is a record of the file");
+
+	// PackHash returns the 64-bit FNV-1a hash of a name.
+	uint64_t PackHash(const char *name, size_t length);
+
+	// A PackedAsset is the audio data of an asset of a mounted pack.
+	struct PackedAsset {
+		const byte	*data;		// the first byte of the data, in the mapped pack
+		WavInfo		info;		// info.dataOffset is the offset of the data in the pack
+	};
+
+	// CLASS:		AssetPack
+	//
+	// PURPOSE:		A pack mapped in memory.
+	//				Find looks an asset up in constant time, and neither allocates nor
+	//				makes system calls: once the pack is open, playing from it makes no
+	//				system call, and does no I/O but the page faults of the mapping.
+	//				Open prefetches the start of every asset, once.
+	//
+	class AssetPack {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(AssetPack);
+
+		AssetPack() {}
+
+		//				ACCESSORS
+		//
+
+		bool IsOpen() const { return m_file.IsOpen(); }
+
+		size_t NumAssets() const { return m_numAssets; }
+
+		// Find looks up the asset of the given name.
+		// Returns false if the pack is not open or does not hold it.
+		bool Find(const char *name, OUT PackedAsset *asset) const;
+
+		//				MANIPULATORS
+		//
+
+		// Open maps a pack and asks the OS to load the first kPackPrefetchSize bytes
+		// of each asset in the background. The pack previously open, if any, is closed.
+		// Fails if the file is not a pack, or if an entry does not lie within the file
+		// or has an unsupported format.
+		Error Open(const char *filename);
+
+		// Close unmaps the pack. The assets found in it become invalid.
+		void Close();
+
+	private:
+		MappedFile			m_file;
+		size_t				m_numAssets{ 0 };
+		size_t				m_numBuckets{ 0 };
+		const PackEntry		*m_entries{ nullptr };
+		const uint32_t		*m_buckets{ nullptr };
+		const char			*m_names{ nullptr };
+	};
+
+	// BuildAssetPack writes a pack of audio files: WAV, compressed or headerless files.
+	// The assets are named after the filenames, as they are written.
+	// Fails if a file cannot be read, is not a supported audio file, or comes twice.
+	Error BuildAssetPack(const char *packFilename, const std::vector<std::string> &filenames);
+}
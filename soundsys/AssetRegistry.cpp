@@ -0,0 +1,64 @@
+#include "pch.h"
+#include "AssetRegistry.h"
+#include <fstream>
+
+namespace sound {
+
+	AssetRegistry::AssetRegistry(size_t capacity)
+		: m_capacity(capacity)
+		, m_assets(new RegisteredAsset[capacity])
+	{
+	}
+
+	const RegisteredAsset *AssetRegistry::Find(AssetHandle handle) const
+	{
+		if (handle == kInvalidAssetHandle || handle > NumAssets()) {
+			return nullptr;
+		}
+
+		return &m_assets[handle - 1];
+	}
+
+	Error AssetRegistry::Register(const char *path, const AssetPack *pack, OUT AssetHandle *handle)
+	{
+		assert(path != nullptr);
+		assert(handle != nullptr);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto it = m_handles.find(path);
+		if (it != m_handles.end()) {
+			*handle = it->second;
+			return ERROR_NONE;
+		}
+
+		const auto index = m_numAssets.load(std::memory_order_relaxed);
+		if (index == m_capacity) {
+			DebugPrintfA("ERROR: AssetRegistry::Register() - Cannot register %s, the registry is full!\n", path);
+			return ERROR_FAILURE;
+		}
+
+		auto &asset = m_assets[index];
+		asset.path = path;
+		asset.inPack = pack && pack->Find(path, &asset.packed);
+
+		// A file is only checked here: the voice that plays it maps it and reads its header again.
+		if (!asset.inPack) {
+			std::ifstream file(path, std::ios::binary);
+			WavInfo info;
+			if (!file || ParseWavHeader(&file, &info)) {
+				DebugPrintfA("ERROR: AssetRegistry::Register() - %s is not a supported audio file!\n", path);
+				return ERROR_FAILURE;
+			}
+		}
+
+		*handle = static_cast<AssetHandle>(index + 1);
+		asset.handle = *handle;
+		m_handles.emplace(asset.path, *handle);
+
+		// The asset is complete before a reader can see it.
+		m_numAssets.store(index + 1, std::memory_order_release);
+
+		return ERROR_NONE;
+	}
+}
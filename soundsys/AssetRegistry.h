@@ -0,0 +1,76 @@
+#pragma once
+
+#include "framework.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "AssetPack.h"
+
+namespace sound {
+
+	// An AssetHandle names a registered asset in the requests: a fixed-size number
+	// rather than a path that the streaming thread would have to copy and look up.
+	// The handles of an AssetRegistry are 1, 2, 3... in the order of registration.
+	using AssetHandle = uint32_t;
+	const AssetHandle	kInvalidAssetHandle = 0;
+
+	// A RegisteredAsset is an asset resolved once, at registration.
+	struct RegisteredAsset {
+		AssetHandle		handle{ kInvalidAssetHandle };
+		std::string		path;
+		bool			inPack{ false };
+		PackedAsset		packed{};		// where the asset lies in the pack, if inPack
+	};
+
+	// CLASS:		AssetRegistry
+	//
+	// PURPOSE:		Resolves audio files to handles, once.
+	//				Register checks that the file can be played: it is in the pack, or it
+	//				is a file with a supported format. The streaming thread then gets the
+	//				resolved asset from its handle, without a lock, a string or an allocation.
+	//
+	//				Register can be called from any thread; Find too.
+	//				Assets are never unregistered: a handle stays valid as long as the registry.
+	//
+	class AssetRegistry {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(AssetRegistry);
+
+		// The registry holds up to capacity assets.
+		AssetRegistry(size_t capacity);
+
+		//				ACCESSORS
+		//
+
+		size_t Capacity() const { return m_capacity; }
+
+		size_t NumAssets() const { return m_numAssets.load(std::memory_order_acquire); }
+
+		// Find returns the asset of a handle, or nullptr if the handle was not returned by Register.
+		const RegisteredAsset *Find(AssetHandle handle) const;
+
+		//				MANIPULATORS
+		//
+
+		// Register resolves the asset at path, looking it up in pack first if pack is not nullptr,
+		// and returns its handle. A path registered earlier gets the same handle.
+		// Fails if the asset is neither in the pack nor a supported audio file,
+		// or if the registry is full.
+		Error Register(const char *path, const AssetPack *pack, OUT AssetHandle *handle);
+
+	private:
+		size_t								m_capacity;
+
+		// Allocated once: the assets never move, and the first m_numAssets ones are
+		// complete for whoever read the count.
+		std::unique_ptr<RegisteredAsset[]>	m_assets;
+		std::atomic<size_t>					m_numAssets{ 0 };
+
+		// Only touched by Register.
+		std::mutex								m_mutex;
+		std::unordered_map<std::string, AssetHandle>	m_handles;
+	};
+}
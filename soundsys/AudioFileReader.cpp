@@ -1,13 +1,52 @@
 #include "pch.h"
 #include "AudioFileReader.h"
+#include "Adpcm.h"
+#include <algorithm>
+#include <cstring>
 
 namespace sound {
 
-	AudioFileReader::AudioFileReader(size_t bufCapacity, std::ifstream *file)
-		: m_buf(bufCapacity, 0)
-		, m_file(file)
+	// Zeros shared by all the readers in memory mode, so that reading past EOF
+	// does not write anything. Being zero-initialized, the array does not take
+	// space in the executable.
+	static const size_t	kSilenceSize = 1 << 20;
+	static byte			s_silence[kSilenceSize];
+
+	AudioFileReader::AudioFileReader(size_t bufCapacity, std::istream *file, size_t size)
+		: AudioFileReader(bufCapacity, file ? std::unique_ptr<ByteSource>(new StreamSource(file, size)) : nullptr)
+	{
+	}
+
+	AudioFileReader::AudioFileReader(size_t bufCapacity, const byte *data, size_t size)
+		: AudioFileReader(bufCapacity, std::unique_ptr<ByteSource>(new MemorySource(data, size)))
+	{
+	}
+
+	AudioFileReader::AudioFileReader(size_t bufCapacity, std::unique_ptr<ByteSource> source)
+		: m_capacity(bufCapacity)
+		, m_buf(bufCapacity, 0)
+		, m_data(m_buf.data())
+		, m_ownedSource(std::move(source))
+		, m_source(m_ownedSource.get())
 	{
 		assert(bufCapacity >= 1);
+
+		// A source in memory is read in place.
+		if (m_source && m_source->IsInMemory()) {
+			m_inMemory = true;
+			m_memory = m_source->Span();
+			m_memorySize = m_source->Size();
+		}
+	}
+
+	bool AudioFileReader::AtEOF() const
+	{
+		return m_eof;
+	}
+
+	ReadStats AudioFileReader::ReadAheadStats() const
+	{
+		return m_readingAhead ? m_queue->Stats() : ReadStats{};
 	}
 
 	Error AudioFileReader::Read(size_t size)
@@ -18,45 +57,430 @@ namespace sound {
 			size = BufferCapacity();
 		}
 
+		if (m_loopBody) {
+			return ReadLooped(size);
+		}
+
+		m_position += size;
+		return ReadFromSource(size);
+	}
+
+	Error AudioFileReader::ReadFromSource(size_t size)
+	{
+		return m_decoding ? ReadDecoded(size) : ReadRaw(size);
+	}
+
+	Error AudioFileReader::ReadRaw(size_t size)
+	{
+		if (m_readingAhead) {
+			return ReadFromQueue(size);
+		}
+
+		if (m_inMemory) {
+			return ReadFromMemory(size);
+		}
+
+		return ReadFromStream(size);
+	}
+
+	Error AudioFileReader::ReadFromStream(size_t size)
+	{
 		Error err;
 		if (UnusualState(OUT &err)) {
 			ZeroData(size);
 			return err;
 		}
 
-		m_dataSize = 0;
+		auto numRead = m_source->Read(m_buf.data(), size);
 
-		m_file->read((char *)m_buf.data(), size);
-		auto numRead = m_file->gcount();
-
-		if (0 < numRead && numRead < size) {
-			// Pad with zeros.
-			auto begin = m_buf.data() + numRead;
-			auto end = m_buf.data() + size;
-			std::fill(begin, end, (byte)0);
+		// Pad with zeros.
+		std::fill(m_buf.data() + numRead, m_buf.data() + size, (byte)0);
+		m_data = m_buf.data();
+		m_dataSize = size;
+		m_audioSize = numRead;
 
-			m_dataSize = size;
+		if (m_source->Failure()) {
+			m_failure = true;
+			return ERROR_READ;
 		}
 
-		if (m_file->eof()) {
+		// The end of the audio data can come before the end of the file.
+		if (numRead < size) {
+			m_eof = true;
 			return ERROR_EOF;
 		}
-		else if (m_file->bad() || m_file->fail()) {
-			m_failure = true;
+
+		return ERROR_NONE;
+	}
+
+	void AudioFileReader::SetAdpcm(int numChannels, size_t framesPerBlock, size_t pcmSize)
+	{
+		assert(!m_readingAhead && m_position == 0);
+		assert(framesPerBlock >= 2 && framesPerBlock % 2 == 0 && framesPerBlock <= kAdpcmMaxFramesPerBlock);
+
+		m_decoding = true;
+		m_numChannels = numChannels;
+		m_framesPerBlock = framesPerBlock;
+		m_blockSize = AdpcmBlockSize(numChannels, framesPerBlock);
+		m_blockPcmSize = framesPerBlock * numChannels * sizeof(int16_t);
+		m_pcmRemaining = pcmSize;
+
+		// Fewer than a block of samples is left over after a chunk, so a chunk
+		// and its leftover fit in the capacity plus a block.
+		m_buf.resize(std::max(m_capacity, CodedSize(m_capacity)));
+		m_pcm.assign(m_capacity + m_blockPcmSize, 0);
+		m_data = m_buf.data();
+	}
+
+	size_t AudioFileReader::CodedSize(size_t size) const
+	{
+		return (size + m_blockPcmSize - 1) / m_blockPcmSize * m_blockSize;
+	}
+
+	Error AudioFileReader::ReadDecoded(size_t size)
+	{
+		if (m_failure) {
+			ZeroData(size);
 			return ERROR_READ;
 		}
+
+		if (m_eof) {
+			ZeroData(size);
+			return ERROR_EOF;
+		}
+
+		// Samples decoded past the previous chunk come first.
+		auto numDecoded = m_pcmEnd - m_pcmBegin;
+		std::memmove(m_pcm.data(), m_pcm.data() + m_pcmBegin, numDecoded);
+
+		if (numDecoded < size && !m_codedEnd) {
+			auto err = ReadRaw(CodedSize(size - numDecoded));
+
+			// The raw reads flag the end of the blocks, not the end of the samples.
+			m_codedEnd = (err != ERROR_NONE);
+			m_eof = false;
+
+			auto numBlocks = m_audioSize / m_blockSize;
+			DecodeAdpcmBlocks(reinterpret_cast<int16_t *>(m_pcm.data() + numDecoded), m_data, numBlocks, m_numChannels, m_framesPerBlock);
+			numDecoded += numBlocks * m_blockPcmSize;
+		}
+
+		// The last block is padded past the end of the samples.
+		auto numAudio = std::min({ numDecoded, size, m_pcmRemaining });
+		m_pcmRemaining -= numAudio;
+
+		if (numAudio < size) {
+			std::fill(m_pcm.data() + numAudio, m_pcm.data() + size, (byte)0);
+			m_pcmBegin = m_pcmEnd = 0;
+			m_eof = !m_failure;
+		}
 		else {
-			m_dataSize = size;
+			m_pcmBegin = size;
+			m_pcmEnd = numDecoded;
+		}
+
+		m_data = m_pcm.data();
+		m_dataSize = size;
+		m_audioSize = numAudio;
+
+		return m_failure ? ERROR_READ : (m_eof ? ERROR_EOF : ERROR_NONE);
+	}
+
+	void AudioFileReader::SetLoop(const byte *body, size_t bodySize, size_t endOffset)
+	{
+		assert(body != nullptr && bodySize >= 1);
+		assert(m_position <= endOffset);
+
+		m_loopBody = body;
+		m_loopBodySize = bodySize;
+		m_loopEnd = endOffset;
+		m_inLoop = false;
+		m_loopPos = 0;
+	}
+
+	Error AudioFileReader::ReadLooped(size_t size)
+	{
+		size_t numCopied = 0;
+
+		if (!m_inLoop) {
+			auto beforeEnd = m_loopEnd - m_position;
+
+			// The chunk is before the end of the loop: read it as usual.
+			if (size <= beforeEnd) {
+				auto err = ReadFromSource(size);
+				m_position += size;
+				return err;
+			}
+
+			// The chunk crosses the end: its first part is read as usual and moved to
+			// the buffer, where the start of the body follows it.
+			if (beforeEnd > 0) {
+				auto err = ReadFromSource(beforeEnd);
+				if (err == ERROR_READ) {
+					return err;
+				}
+				std::memmove(m_buf.data(), m_data, beforeEnd);
+				numCopied = beforeEnd;
+			}
+
+			m_position = m_loopEnd;
+			m_inLoop = true;
+			m_eof = false;
+		}
+
+		// Zero copy: point into the body.
+		if (numCopied == 0 && m_loopPos + size <= m_loopBodySize) {
+			m_data = m_loopBody + m_loopPos;
+			m_loopPos = (m_loopPos + size) % m_loopBodySize;
+		}
+		else {
+			CopyFromLoopBody(m_buf.data() + numCopied, size - numCopied);
+			m_data = m_buf.data();
+		}
+
+		m_dataSize = size;
+		m_audioSize = size;
+		return ERROR_NONE;
+	}
+
+	void AudioFileReader::CopyFromLoopBody(byte *dst, size_t size)
+	{
+		while (size > 0) {
+			auto n = std::min(size, m_loopBodySize - m_loopPos);
+			std::memcpy(dst, m_loopBody + m_loopPos, n);
+
+			dst += n;
+			size -= n;
+			m_loopPos = (m_loopPos + n) % m_loopBodySize;
+		}
+	}
+
+	Error AudioFileReader::StartReadAhead(size_t firstChunkSize, size_t chunkSize, int numChunks)
+	{
+		assert(!m_readingAhead);
+		assert(firstChunkSize <= BufferCapacity() && chunkSize <= BufferCapacity());
+
+		// A source in memory has nothing to read ahead.
+		if (!m_source || m_inMemory) {
+			return ERROR_FAILURE;
 		}
-		
+
+		if (m_decoding) {
+			firstChunkSize = CodedSize(firstChunkSize);
+			chunkSize = CodedSize(chunkSize);
+		}
+
+		try {
+			if (!m_queue) {
+				m_queue.reset(new ReadAheadQueue());
+			}
+			m_queue->Start(m_source, firstChunkSize, chunkSize, numChunks);
+		}
+		catch (const std::exception &e) {
+			return ERROR_FAILURE;
+		}
+
+		m_readingAhead = true;
 		return ERROR_NONE;
 	}
 
+	void AudioFileReader::StopReadAhead()
+	{
+		if (m_queue) {
+			m_queue->Stop();
+		}
+		m_readingAhead = false;
+
+		m_holdsChunk = false;
+		m_data = m_buf.data();
+	}
+
+	void AudioFileReader::Reset(size_t bufCapacity, const byte *data, size_t size)
+	{
+		ResetState(bufCapacity);
+
+		// Reading in place needs no source object.
+		m_inMemory = true;
+		m_memory = data;
+		m_memorySize = size;
+	}
+
+	void AudioFileReader::Reset(size_t bufCapacity, std::unique_ptr<ByteSource> source)
+	{
+		Reset(bufCapacity, source.get());
+		m_ownedSource = std::move(source);
+	}
+
+	void AudioFileReader::Reset(size_t bufCapacity, ByteSource *source)
+	{
+		ResetState(bufCapacity);
+
+		m_source = source;
+		if (m_source && m_source->IsInMemory()) {
+			m_inMemory = true;
+			m_memory = m_source->Span();
+			m_memorySize = m_source->Size();
+		}
+	}
+
+	void AudioFileReader::ResetState(size_t bufCapacity)
+	{
+		assert(bufCapacity >= 1);
+
+		// The read-ahead thread reads the previous source.
+		StopReadAhead();
+		m_ownedSource.reset();
+		m_source = nullptr;
+
+		// The buffer only grows.
+		m_capacity = bufCapacity;
+		if (m_buf.size() < bufCapacity) {
+			m_buf.resize(bufCapacity);
+		}
+		m_data = m_buf.data();
+		m_dataSize = 0;
+		m_audioSize = 0;
+
+		m_failure = false;
+		m_eof = false;
+
+		m_inMemory = false;
+		m_memory = nullptr;
+		m_memorySize = 0;
+		m_memoryPos = 0;
+
+		m_loopBody = nullptr;
+		m_loopBodySize = 0;
+		m_loopEnd = 0;
+		m_position = 0;
+		m_inLoop = false;
+		m_loopPos = 0;
+
+		m_decoding = false;
+		m_numChannels = 0;
+		m_framesPerBlock = 0;
+		m_blockSize = 0;
+		m_blockPcmSize = 0;
+		m_pcmBegin = 0;
+		m_pcmEnd = 0;
+		m_pcmRemaining = 0;
+		m_codedEnd = false;
+
+		m_chunkOffset = 0;
+	}
+
+	Error AudioFileReader::ReadFromQueue(size_t size)
+	{
+		// The chunk handed out by the previous Read is not needed anymore.
+		if (m_holdsChunk) {
+			m_queue->PopFront();
+			m_holdsChunk = false;
+			m_data = m_buf.data();
+		}
+
+		if (m_failure) {
+			ZeroData(size);
+			return ERROR_READ;
+		}
+
+		if (m_eof) {
+			ZeroData(size);
+			return ERROR_EOF;
+		}
+
+		// Fast path: the front chunk holds exactly the requested bytes.
+		// It is zero padded up to its capacity if the file ends in it.
+		const auto &front = m_queue->Front();
+		auto fits = (front.size == size) || (front.eof && front.size < size && size <= front.data.size());
+		if (m_chunkOffset == 0 && fits) {
+			m_data = front.data.data();
+			m_dataSize = size;
+			m_audioSize = front.size;
+			m_holdsChunk = true;
+
+			m_eof = front.eof;
+			m_failure = front.failure;
+			return m_failure ? ERROR_READ : (m_eof ? ERROR_EOF : ERROR_NONE);
+		}
+
+		// Slow path: gather the bytes from successive chunks into the buffer.
+		size_t numCopied = 0;
+		while (numCopied < size) {
+			const auto &chunk = m_queue->Front();
+
+			auto n = std::min(size - numCopied, chunk.size - m_chunkOffset);
+			std::memcpy(m_buf.data() + numCopied, chunk.data.data() + m_chunkOffset, n);
+			numCopied += n;
+			m_chunkOffset += n;
+
+			if (m_chunkOffset < chunk.size) {
+				break;
+			}
+
+			// The chunk is used up. The last chunk of the file is kept: there is nothing after it.
+			if (chunk.eof || chunk.failure) {
+				m_eof = chunk.eof;
+				m_failure = chunk.failure;
+				break;
+			}
+
+			m_queue->PopFront();
+			m_chunkOffset = 0;
+		}
+
+		// Pad with zeros.
+		std::fill(m_buf.data() + numCopied, m_buf.data() + size, (byte)0);
+		m_dataSize = size;
+		m_audioSize = numCopied;
+
+		return m_failure ? ERROR_READ : (m_eof ? ERROR_EOF : ERROR_NONE);
+	}
+
+	Error AudioFileReader::ReadFromMemory(size_t size)
+	{
+		auto remaining = m_memorySize - m_memoryPos;
+
+		// Zero copy: point into the memory.
+		if (remaining >= size) {
+			m_data = m_memory + m_memoryPos;
+			m_dataSize = size;
+			m_audioSize = size;
+			m_memoryPos += size;
+			return ERROR_NONE;
+		}
+
+		// Past EOF: point to the silence page.
+		if (remaining == 0) {
+			m_eof = true;
+
+			if (size <= kSilenceSize) {
+				m_data = s_silence;
+				m_dataSize = size;
+				m_audioSize = 0;
+			}
+			else {
+				ZeroData(size);
+			}
+			return ERROR_EOF;
+		}
+
+		// The chunk that contains EOF: copy what is left and pad with zeros.
+		std::memcpy(m_buf.data(), m_memory + m_memoryPos, remaining);
+		std::fill(m_buf.data() + remaining, m_buf.data() + size, (byte)0);
+		m_data = m_buf.data();
+		m_dataSize = size;
+		m_audioSize = remaining;
+		m_memoryPos = m_memorySize;
+		m_eof = true;
+
+		return ERROR_EOF;
+	}
+
 	bool AudioFileReader::UnusualState(OUT Error *err)
 	{
 		assert(err != nullptr);
 
-		if (!m_file) {
+		if (!m_source) {
 			*err = ERROR_FAILURE;
 			return true;
 		}
@@ -78,6 +502,8 @@ namespace sound {
 	{
 		std::fill(m_buf.data(), m_buf.data() + size, (byte)0);
 
+		m_data = m_buf.data();
 		m_dataSize = size;
+		m_audioSize = 0;
 	}
-}
\ No newline at end of file
+}
@@ -2,14 +2,37 @@
 
 #include "framework.h"
 #include <fstream>
+#include <memory>
 #include <vector>
 
+#include "ByteSource.h"
+#include "ReadAheadQueue.h"
+
 namespace sound {
 
 	// CLASS:		AudioFileReader 
 	//
-	// PURPOSE:		Reads chunks of data from an audio file into an internal buffer.
-	//				When EOF is reached, the reader adds zero padding.
+	// PURPOSE:		Reads chunks of data from a byte source (see ByteSource.h) into an
+	//				internal buffer. When EOF is reached, the reader adds zero padding.
+	//
+	//				In read-ahead mode, a background thread reads the source ahead into a ring
+	//				of chunks. When a Read asks for exactly the next chunk, the reader hands
+	//				out that chunk instead of copying it.
+	//
+	//				In memory mode, the source is in memory, for instance a mapped file.
+	//				Data() points into the span itself, and to a shared page of zeros
+	//				once EOF is reached. Only the chunk that contains EOF is copied.
+	//
+	//				With a loop, the reader goes on with a loop body held in memory when
+	//				it reaches the end of the loop, instead of EOF, and repeats it forever.
+	//				The chunk that crosses the end of the loop is filled up with the start
+	//				of the body. Reading the body does no I/O, and does not copy the chunks
+	//				that lie inside it.
+	//
+	//				In decoding mode, the file, queue or memory holds compressed blocks
+	//				(see Adpcm.h). The reader reads the blocks that cover each chunk and
+	//				decodes them; the samples decoded past the chunk are kept for the next.
+	//				Sizes, EOF and padding are those of the decoded samples.
 	//
 	struct BufferData {
 		const byte	*ptr;
@@ -18,27 +41,45 @@ namespace sound {
 
 	class AudioFileReader {
 	public:
-		AudioFileReader(size_t bufCapacity = 64, std::ifstream *file = nullptr);
+		// The reader reads the file from its current position, up to size bytes:
+		// EOF is reached at the end of the audio data even if the file goes on.
+		// A reader without a file fails to read.
+		AudioFileReader(size_t bufCapacity = 64, std::istream *file = nullptr, size_t size = SIZE_MAX);
+
+		// This constructor creates a reader in memory mode.
+		// The memory must stay valid as long as the reader is used.
+		AudioFileReader(size_t bufCapacity, const byte *data, size_t size);
+
+		// This constructor reads any source, in memory mode if the source is in memory.
+		AudioFileReader(size_t bufCapacity, std::unique_ptr<ByteSource> source);
 
 		//				ACCESSORS
 		//
 
 		// AtEOF returns true iff the reader reached EOF.
-		bool AtEOF() const { return m_file->eof(); }
+		bool AtEOF() const;
 
-		// Failure returns true iff an error occured while reading the file.
+		// Failure returns true iff an error occured while reading the source.
 		// Being at EOF is not a failure.
 		auto Failure() const { return m_failure; }
 
-		auto BufferCapacity() const { return m_buf.size(); }
+		auto BufferCapacity() const { return m_capacity; }
 
 		// Data returns a pointer to the data buffer and the number of bytes it contains.
 		// The number of bytes includes the zero padding.
+		// The pointer is valid until the next call to Read.
 		const BufferData Data() const
 		{
-			return BufferData{ m_buf.data(), m_dataSize };
+			return BufferData{ m_data, m_dataSize };
 		}
 
+		// AudioSize returns the number of bytes of Data() that come from the file,
+		// the others being zero padding.
+		size_t AudioSize() const { return m_audioSize; }
+
+		// ReadAheadStats returns the stall statistics of the read-ahead mode.
+		ReadStats ReadAheadStats() const;
+
 		//				MANIPULATORS
 		//
 
@@ -55,19 +96,164 @@ namespace sound {
 		//
 		Error Read(size_t size = 0);
 
+		// SetLoop makes the reader go on with the loop body once it has read endOffset bytes,
+		// then repeat the body forever. The body is usually the bytes of the audio data that
+		// end at endOffset, and it must stay valid as long as the reader is used.
+		//
+		// PRECONDITIONS
+		//	No Read went past endOffset yet.
+		//	bodySize >= 1
+		//
+		void SetLoop(const byte *body, size_t bodySize, size_t endOffset);
+
+		// SetAdpcm switches the reader to decoding mode: the bytes it reads are compressed
+		// blocks that decode to pcmSize bytes of 16-bit samples.
+		//
+		// PRECONDITIONS
+		//	No Read was done yet, and the reader is not in read-ahead mode.
+		//	framesPerBlock is even and at most kAdpcmMaxFramesPerBlock.
+		//
+		void SetAdpcm(int numChannels, size_t framesPerBlock, size_t pcmSize);
+
+		// StartReadAhead switches the reader to read-ahead mode.
+		// The first chunk read ahead has firstChunkSize bytes, the following ones chunkSize bytes.
+		// Reads of these sizes, in that order, do not copy any data.
+		//
+		// PRECONDITIONS
+		//	No Read was done yet.
+		//	firstChunkSize <= BufferCapacity() && chunkSize <= BufferCapacity()
+		//
+		// In decoding mode, the sizes are those of decoded chunks. The chunks read ahead
+		// are the blocks that cover them.
+		//
+		Error StartReadAhead(size_t firstChunkSize, size_t chunkSize, int numChunks);
+
+		// StopReadAhead stops reading ahead. The background thread is kept for the next
+		// StartReadAhead, which then does not create one.
+		// It must be called before the file of a StreamSource is closed.
+		void StopReadAhead();
+
+		// Reset makes the reader read another source from the start, as a reader created
+		// with the same arguments would. The buffers are kept: in memory mode, Reset
+		// allocates nothing as long as they are large enough.
+		void Reset(size_t bufCapacity, const byte *data, size_t size);
+		void Reset(size_t bufCapacity, std::unique_ptr<ByteSource> source);
+
+		// This version does not own the source: it must stay valid as long as the reader
+		// reads it. A source reused from a file to the next is then not allocated again.
+		void Reset(size_t bufCapacity, ByteSource *source);
+
+		// Reserve allocates the buffer for a capacity of bufCapacity bytes, so that the
+		// next Reset up to that capacity does not.
+		void Reserve(size_t bufCapacity) { m_buf.reserve(bufCapacity); }
+
 	private:
+		// ResetState forgets the source and the modes, and sizes the buffer for bufCapacity.
+		void ResetState(size_t bufCapacity);
+
 		bool UnusualState(OUT Error *err);
 
 		// ZeroData fills size bytes of the buffer with zeros and
-		// sets the m_dataSize to size.
+		// sets the m_dataSize to size. None of them is audio.
 		void ZeroData(size_t size);
 
+		// ReadFromQueue is the Read function of the read-ahead mode.
+		Error ReadFromQueue(size_t size);
+
+		// ReadFromMemory is the Read function of the memory mode.
+		Error ReadFromMemory(size_t size);
+
+		// ReadFromSource reads the next bytes of audio, decoded if the reader is in decoding mode.
+		Error ReadFromSource(size_t size);
+
+		// ReadRaw reads the next bytes from the source, the queue or the memory.
+		Error ReadRaw(size_t size);
+
+		// ReadFromStream is the Read function of a source that is not in memory.
+		Error ReadFromStream(size_t size);
+
+		// ReadDecoded is the Read function of the decoding mode.
+		Error ReadDecoded(size_t size);
+
+		// CodedSize returns the number of bytes of the blocks that decode to size bytes.
+		size_t CodedSize(size_t size) const;
+
+		// ReadLooped is the Read function of a reader with a loop.
+		Error ReadLooped(size_t size);
+
+		// CopyFromLoopBody copies size bytes of the loop body, from the current position in
+		// the body on and wrapping around its end, to dst.
+		void CopyFromLoopBody(byte *dst, size_t size);
+
 	private:
+		size_t				m_capacity;
 		std::vector<byte>	m_buf;
+
+		// Where Data() points: m_buf, a chunk of the read-ahead queue,
+		// the memory being read or the silence page.
+		const byte			*m_data;
 		size_t				m_dataSize{ 0 };
+		size_t				m_audioSize{ 0 };
 
-		std::ifstream		*m_file;
+		// The source read, owned by m_ownedSource unless it was given by pointer.
+		std::unique_ptr<ByteSource>	m_ownedSource;
+		ByteSource					*m_source{ nullptr };
 
 		bool				m_failure{ false };
+
+		bool				m_eof{ false };
+
+		//		Memory mode
+		//
+
+		bool				m_inMemory{ false };
+		const byte			*m_memory{ nullptr };
+		size_t				m_memorySize{ 0 };
+		size_t				m_memoryPos{ 0 };
+
+		//		Loop
+		//
+
+		const byte			*m_loopBody{ nullptr };
+		size_t				m_loopBodySize{ 0 };
+		size_t				m_loopEnd{ 0 };
+
+		// Number of bytes read, up to the end of the loop.
+		size_t				m_position{ 0 };
+
+		// True iff the end of the loop was reached; m_loopPos is then the position in the body.
+		bool				m_inLoop{ false };
+		size_t				m_loopPos{ 0 };
+
+		//		Decoding mode
+		//
+
+		bool				m_decoding{ false };
+		int					m_numChannels{ 0 };
+		size_t				m_framesPerBlock{ 0 };
+		size_t				m_blockSize{ 0 };
+		size_t				m_blockPcmSize{ 0 };
+
+		// Decoded samples: the chunk handed out, followed by the samples decoded past it.
+		std::vector<byte>	m_pcm;
+		size_t				m_pcmBegin{ 0 };
+		size_t				m_pcmEnd{ 0 };
+
+		// Number of decoded bytes left to hand out, and whether all the blocks were read.
+		size_t				m_pcmRemaining{ 0 };
+		bool				m_codedEnd{ false };
+
+		//		Read-ahead mode
+		//
+
+		// The queue is created by the first StartReadAhead and kept until the reader is destroyed.
+		std::unique_ptr<ReadAheadQueue>	m_queue;
+		bool				m_readingAhead{ false };
+
+		// Number of bytes of the front chunk that were already read.
+		size_t				m_chunkOffset{ 0 };
+
+		// True iff Data() points to the front chunk, which is popped on the next Read.
+		bool				m_holdsChunk{ false };
 	};
-}
\ No newline at end of file
+}
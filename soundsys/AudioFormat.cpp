@@ -0,0 +1,48 @@
+#include "pch.h"
+#include "AudioFormat.h"
+
+namespace sound {
+
+	WAVEFORMATEX MakeWaveFormat(WORD formatTag, WORD numChannels, DWORD samplesPerSec, WORD bitsPerSample)
+	{
+		WAVEFORMATEX format = {};
+		format.wFormatTag = formatTag;
+		format.nChannels = numChannels;
+		format.nSamplesPerSec = samplesPerSec;
+		format.wBitsPerSample = bitsPerSample;
+		format.nBlockAlign = (format.nChannels * format.wBitsPerSample) / 8;
+		format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+		format.cbSize = 0;
+
+		return format;
+	}
+
+	WAVEFORMATEX DefaultWaveFormat()
+	{
+		return MakeWaveFormat(WAVE_FORMAT_PCM, 1, 44100, 16);
+	}
+
+	SAMPLE_TYPE SampleTypeOf(const WAVEFORMATEX &format)
+	{
+		if (format.wFormatTag == WAVE_FORMAT_PCM) {
+			switch (format.wBitsPerSample) {
+			case 16:	return SAMPLE_TYPE_S16;
+			case 24:	return SAMPLE_TYPE_S24;
+			}
+		}
+		else if (format.wFormatTag == WAVE_FORMAT_IEEE_FLOAT && format.wBitsPerSample == 32) {
+			return SAMPLE_TYPE_F32;
+		}
+
+		return SAMPLE_TYPE_UNSUPPORTED;
+	}
+
+	bool IsSupportedFormat(const WAVEFORMATEX &format)
+	{
+		return SampleTypeOf(format) != SAMPLE_TYPE_UNSUPPORTED
+			&& (format.nChannels == 1 || format.nChannels == 2)
+			&& format.nSamplesPerSec >= 1
+			&& format.nBlockAlign == (format.nChannels * format.wBitsPerSample) / 8
+			&& format.nAvgBytesPerSec == format.nSamplesPerSec * format.nBlockAlign;
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "framework.h"
+
+namespace sound {
+
+	// Sample types the library can read and play.
+	enum SAMPLE_TYPE {
+		SAMPLE_TYPE_UNSUPPORTED,
+		SAMPLE_TYPE_S16,		// signed 16-bit integers
+		SAMPLE_TYPE_S24,		// signed 24-bit integers packed in 3 bytes
+		SAMPLE_TYPE_F32			// floats, 1.0 being the full scale
+	};
+
+	// MakeWaveFormat returns a format of interleaved samples.
+	// formatTag is WAVE_FORMAT_PCM or WAVE_FORMAT_IEEE_FLOAT.
+	WAVEFORMATEX MakeWaveFormat(WORD formatTag, WORD numChannels, DWORD samplesPerSec, WORD bitsPerSample);
+
+	// DefaultWaveFormat returns the format of the headerless audio files:
+	// mono, 44.1 kHz, 16 bits.
+	WAVEFORMATEX DefaultWaveFormat();
+
+	// SampleTypeOf returns the type of the samples of a format.
+	SAMPLE_TYPE SampleTypeOf(const WAVEFORMATEX &format);
+
+	// IsSupportedFormat returns true iff the samples have a supported type,
+	// there are 1 or 2 channels and the sizes of the format are consistent.
+	bool IsSupportedFormat(const WAVEFORMATEX &format);
+}
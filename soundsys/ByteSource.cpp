@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "ByteSource.h"
+#include <algorithm>
+#include <cstring>
+
+namespace sound {
+
+	// CopySpan copies the bytes of a span from *position on, up to size bytes, and moves
+	// the position after them.
+	static size_t CopySpan(byte *dst, size_t size, const byte *span, size_t spanSize, size_t *position)
+	{
+		auto n = std::min(size, spanSize - *position);
+		if (n > 0) {
+			std::memcpy(dst, span + *position, n);
+		}
+		*position += n;
+
+		return n;
+	}
+
+	StreamSource::StreamSource(std::istream *stream, size_t size)
+		: m_stream(stream)
+		, m_size(size)
+		, m_remaining(size)
+	{
+		assert(stream != nullptr);
+	}
+
+	StreamSource::StreamSource(std::istream *stream, size_t offset, size_t size)
+		: StreamSource(stream, size)
+	{
+		m_stream->seekg(static_cast<std::streamoff>(offset));
+	}
+
+	bool StreamSource::Failure() const
+	{
+		// A read that stops at the end of the file sets both eofbit and failbit.
+		return m_stream->bad() || (m_stream->fail() && !m_stream->eof());
+	}
+
+	size_t StreamSource::Read(byte *dst, size_t size)
+	{
+		m_stream->read((char *)dst, std::min(size, m_remaining));
+		auto numRead = static_cast<size_t>(m_stream->gcount());
+		m_remaining -= numRead;
+
+		return numRead;
+	}
+
+	void StreamSource::Reset(std::istream *stream, size_t size)
+	{
+		assert(stream != nullptr);
+
+		m_stream = stream;
+		m_size = size;
+		m_remaining = size;
+	}
+
+	MemorySource::MemorySource(const byte *data, size_t size)
+		: m_data(data)
+		, m_size(size)
+	{
+		assert(data != nullptr || size == 0);
+	}
+
+	size_t MemorySource::Read(byte *dst, size_t size)
+	{
+		return CopySpan(dst, size, m_data, m_size, &m_position);
+	}
+
+	Error MappedFileSource::Open(const char *filename, size_t offset, size_t size)
+	{
+		auto err = m_file.Open(filename);
+		if (err) {
+			return err;
+		}
+
+		if (offset > m_file.Size() || (size != SIZE_MAX && size > m_file.Size() - offset)) {
+			m_file.Close();
+			return ERROR_FAILURE;
+		}
+
+		m_offset = offset;
+		m_size = (size == SIZE_MAX) ? m_file.Size() - offset : size;
+		m_position = 0;
+
+		return ERROR_NONE;
+	}
+
+	size_t MappedFileSource::Read(byte *dst, size_t size)
+	{
+		return CopySpan(dst, size, Span(), m_size, &m_position);
+	}
+}
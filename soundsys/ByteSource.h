@@ -0,0 +1,131 @@
+#pragma once
+
+#include "framework.h"
+#include <istream>
+
+#include "MappedFile.h"
+
+namespace sound {
+
+	// CLASS:		ByteSource
+	//
+	// PURPOSE:		The bytes of an asset, wherever they live: a range of a stream (a whole
+	//				file or an entry of an archive), or a span of memory (a buffer, a cached
+	//				asset, a mapped file or a range of one).
+	//				A source is read once, from its first byte to its last.
+	//				A source in memory also exposes its span, so that its readers can hand
+	//				out pointers into it instead of copying.
+	//
+	class ByteSource {
+	public:
+		virtual ~ByteSource() {}
+
+		//				ACCESSORS
+		//
+
+		// IsInMemory returns true iff the bytes are in memory, at Span().
+		virtual bool IsInMemory() const { return false; }
+
+		// Span returns the first byte of a source in memory, nullptr otherwise.
+		// It can be nullptr for an empty source in memory as well.
+		virtual const byte *Span() const { return nullptr; }
+
+		// Size returns the number of bytes of the source, SIZE_MAX if it is a stream
+		// read up to its end.
+		virtual size_t Size() const = 0;
+
+		// Failure returns true iff a read error occured.
+		// Reaching the end of the source is not a failure.
+		virtual bool Failure() const = 0;
+
+		//				MANIPULATORS
+		//
+
+		// Read copies the next bytes of the source to dst, up to size bytes.
+		// Returns the number of bytes copied: fewer than size at the end of the source
+		// or on a read error.
+		virtual size_t Read(byte *dst, size_t size) = 0;
+	};
+
+	// CLASS:		StreamSource
+	//
+	// PURPOSE:		Reads a range of a stream, usually a file: its audio data, or an
+	//				entry of an archive. The stream is not owned.
+	//
+	class StreamSource : public ByteSource {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(StreamSource);
+
+		// The source reads up to size bytes from the current position of the stream.
+		StreamSource(std::istream *stream, size_t size = SIZE_MAX);
+
+		// This constructor moves the stream to offset first.
+		StreamSource(std::istream *stream, size_t offset, size_t size);
+
+		size_t Size() const override { return m_size; }
+		bool Failure() const override;
+
+		size_t Read(byte *dst, size_t size) override;
+
+		// Reset makes the source read another range, as a source created with the
+		// same arguments would.
+		void Reset(std::istream *stream, size_t size = SIZE_MAX);
+
+	private:
+		std::istream	*m_stream;
+		size_t			m_size;
+		size_t			m_remaining;
+	};
+
+	// CLASS:		MemorySource
+	//
+	// PURPOSE:		A span of memory that someone else owns: it must stay valid
+	//				as long as the source is used.
+	//
+	class MemorySource : public ByteSource {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(MemorySource);
+
+		MemorySource(const byte *data, size_t size);
+
+		bool IsInMemory() const override { return true; }
+		const byte *Span() const override { return m_data; }
+		size_t Size() const override { return m_size; }
+		bool Failure() const override { return false; }
+
+		size_t Read(byte *dst, size_t size) override;
+
+	private:
+		const byte		*m_data;
+		size_t			m_size;
+		size_t			m_position{ 0 };
+	};
+
+	// CLASS:		MappedFileSource
+	//
+	// PURPOSE:		A range of a file that the source maps in memory, and unmaps when destroyed.
+	//
+	class MappedFileSource : public ByteSource {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(MappedFileSource);
+
+		MappedFileSource() {}
+
+		bool IsInMemory() const override { return true; }
+		const byte *Span() const override { return m_file.Data() ? m_file.Data() + m_offset : nullptr; }
+		size_t Size() const override { return m_size; }
+		bool Failure() const override { return false; }
+
+		// Open maps the file and selects size bytes from offset on, or up to the end of the file.
+		// Fails if the file cannot be mapped or if the range goes past its end.
+		Error Open(const char *filename, size_t offset = 0, size_t size = SIZE_MAX);
+
+		size_t Read(byte *dst, size_t size) override;
+
+	private:
+		MappedFile		m_file;
+		size_t			m_offset{ 0 };
+		size_t			m_size{ 0 };
+		size_t			m_position{ 0 };
+	};
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace sound {
+
+	// CLASS:		CommandRing
+	//
+	// PURPOSE:		Bounded lock-free queue with many producers and a single consumer.
+	//				Producers never block: Push fails when the ring is full.
+	//				Each slot carries a sequence number telling whether it is free
+	//				for the current lap of the producers or holds a value for the consumer.
+	//
+	// PRECONDITIONS
+	//	N, the capacity, is a power of two.
+	//	T is trivially copyable.
+	//
+	template <class T, size_t N>
+	class CommandRing {
+		static_assert(N >= 2 && (N & (N - 1)) == 0, "Capacity must be a power of two.");
+
+	public:
+		CommandRing()
+		{
+			for (size_t i = 0; i < N; i++) {
+				m_slots[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		CommandRing(const CommandRing &) = delete;
+		void operator=(const CommandRing &) = delete;
+
+		//				ACCESSORS
+		//
+
+		static constexpr size_t Capacity() { return N; }
+
+		// Empty is only reliable when called by the consumer.
+		bool Empty() const
+		{
+			auto head = m_head.load(std::memory_order_relaxed);
+			auto seq = m_slots[head & kMask].sequence.load(std::memory_order_acquire);
+
+			return seq != head + 1;
+		}
+
+		//				MANIPULATORS
+		//
+
+		// Push adds a value to the ring. It can be called from any thread.
+		// Returns false iff the ring is full.
+		bool Push(const T &value)
+		{
+			auto pos = m_tail.load(std::memory_order_relaxed);
+
+			Slot *slot;
+			while (true) {
+				slot = &m_slots[pos & kMask];
+				auto seq = slot->sequence.load(std::memory_order_acquire);
+				auto diff = static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos);
+
+				if (diff == 0) {
+					// The slot is free: try to claim it.
+					if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						break;
+					}
+				}
+				else if (diff < 0) {
+					// The consumer has not released the slot yet.
+					return false;
+				}
+				else {
+					// Another producer claimed the slot first.
+					pos = m_tail.load(std::memory_order_relaxed);
+				}
+			}
+
+			slot->value = value;
+			slot->sequence.store(pos + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		// Pop removes the oldest value from the ring.
+		// It must only be called by the consumer thread.
+		// Returns false iff the ring is empty.
+		bool Pop(T *value)
+		{
+			auto head = m_head.load(std::memory_order_relaxed);
+			auto &slot = m_slots[head & kMask];
+
+			auto seq = slot.sequence.load(std::memory_order_acquire);
+			if (seq != head + 1) {
+				return false;
+			}
+
+			*value = slot.value;
+
+			// Release the slot for the next lap of the producers.
+			slot.sequence.store(head + N, std::memory_order_release);
+			m_head.store(head + 1, std::memory_order_relaxed);
+
+			return true;
+		}
+
+		// PopAll removes up to maxCount values from the ring, oldest first.
+		// It must only be called by the consumer thread.
+		// Returns the number of values removed.
+		size_t PopAll(T *values, size_t maxCount)
+		{
+			size_t n = 0;
+			while (n < maxCount && Pop(&values[n])) {
+				n++;
+			}
+
+			return n;
+		}
+
+	private:
+		static const size_t kMask = N - 1;
+
+		struct Slot {
+			std::atomic<size_t>	sequence;
+			T					value;
+		};
+
+		// The producers and the consumer work on separate cache lines.
+		alignas(64) std::atomic<size_t>	m_tail{ 0 };
+		alignas(64) std::atomic<size_t>	m_head{ 0 };
+		alignas(64) Slot				m_slots[N];
+	};
+}
@@ -0,0 +1,63 @@
+#include "pch.h"
+#include "Cpu.h"
+
+#if defined(SOUND_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace sound {
+
+#ifdef SOUND_HAS_AVX2
+	// CpuHasAvx2 returns true iff the CPU has AVX2 and the OS saves the AVX registers.
+	static bool CpuHasAvx2()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+
+		// The OS must have enabled XSAVE and the saving of the XMM and YMM registers.
+		__cpuid(info, 1);
+		const auto osxsave = (info[2] & (1 << 27)) != 0;
+		const auto avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+			return false;
+		}
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		// Also checks that the OS supports AVX.
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+	SIMD_LEVEL DetectSimdLevel()
+	{
+#ifdef SOUND_HAS_AVX2
+		if (CpuHasAvx2()) {
+			return SIMD_LEVEL_AVX2;
+		}
+#endif
+
+#ifdef SOUND_HAS_SSE2
+		return SIMD_LEVEL_SSE2;
+#else
+		return SIMD_LEVEL_SCALAR;
+#endif
+	}
+
+	const char *SimdLevelName(SIMD_LEVEL level)
+	{
+		switch (level) {
+		case SIMD_LEVEL_SCALAR:	return "scalar";
+		case SIMD_LEVEL_SSE2:	return "SSE2";
+		case SIMD_LEVEL_AVX2:	return "AVX2";
+		}
+
+		return "unknown";
+	}
+}
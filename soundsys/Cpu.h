@@ -0,0 +1,43 @@
+#pragma once
+
+#include "framework.h"
+
+// SOUND_X86 is defined when compiling for x86 or x64.
+// The SSE2 paths are compiled in when the target has SSE2, which every x64 CPU has.
+// The AVX2 paths are always compiled in on x86; they only run if the CPU has AVX2.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SOUND_X86 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOUND_HAS_SSE2 1
+#endif
+
+#if defined(SOUND_X86) && (defined(_MSC_VER) || defined(__GNUC__))
+#define SOUND_HAS_AVX2 1
+#endif
+
+// Functions using AVX2 instructions are marked with SOUND_TARGET_AVX2.
+// GCC and Clang only accept the intrinsics in functions compiled for the instruction set.
+#if defined(SOUND_HAS_AVX2) && defined(__GNUC__)
+#define SOUND_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SOUND_TARGET_AVX2
+#endif
+
+namespace sound {
+
+	// Instruction sets, from the least to the most capable.
+	enum SIMD_LEVEL {
+		SIMD_LEVEL_SCALAR,
+		SIMD_LEVEL_SSE2,
+		SIMD_LEVEL_AVX2
+	};
+
+	// DetectSimdLevel returns the most capable instruction set that the CPU and
+	// the OS support, among the ones compiled in.
+	SIMD_LEVEL DetectSimdLevel();
+
+	// SimdLevelName returns a readable name of the level, for instance "SSE2".
+	const char *SimdLevelName(SIMD_LEVEL level);
+}
@@ -0,0 +1,204 @@
+#include "pch.h"
+#include "DirectSoundDevice.h"
+
+#ifdef _WIN32
+
+#include <stdexcept>
+
+namespace sound {
+
+	DirectSoundDevice::DirectSoundDevice(HWND window)
+		: m_window(window)
+	{
+		HRESULT hr = S_OK;
+
+		hr = DirectSoundCreate8(NULL, &m_directSound, NULL);
+		if (FAILED(hr)) {
+			throw std::runtime_error("sound: DirectSoundCreate8() failed.");
+		}
+
+		hr = m_directSound->SetCooperativeLevel(m_window, DSSCL_PRIORITY);
+		if (FAILED(hr)) {
+			SafeRelease(&m_directSound);
+			throw std::runtime_error("sound: SetCooperativeLevel() failed.");
+		}
+
+		// Create the primary buffer.
+		DSBUFFERDESC desc{ 0 };
+		ZeroMemory(&desc, sizeof(DSBUFFERDESC));
+		desc.dwSize = sizeof(DSBUFFERDESC);
+		desc.dwFlags = DSBCAPS_PRIMARYBUFFER | DSBCAPS_CTRLVOLUME;
+		desc.dwBufferBytes = 0;
+		desc.lpwfxFormat = NULL;
+
+		hr = m_directSound->CreateSoundBuffer(&desc, &m_primaryBuffer, NULL);
+		if (FAILED(hr)) {
+			SafeRelease(&m_directSound);
+			throw std::runtime_error("sound: CreateSoundBuffer() failed.");
+		}
+	}
+
+	DirectSoundDevice::~DirectSoundDevice()
+	{
+		for (auto &event : m_events) {
+			if (event) {
+				CloseHandle(event);
+				event = nullptr;
+			}
+		}
+
+		SafeRelease(&m_DSBuffer);
+		SafeRelease(&m_primaryBuffer);
+		SafeRelease(&m_directSound);
+	}
+
+	void DirectSoundDevice::CreateBuffer(const WAVEFORMATEX &format, DWORD capacity, const std::vector<DWORD> &notifyOffsets)
+	{
+		assert(m_DSBuffer == nullptr);
+
+		m_wavFormat = format;
+
+		CreateUnderlyingDirectSoundBuffer(capacity);
+		CreateEvents(notifyOffsets.size());
+		SendNotificationPositions(notifyOffsets);
+	}
+
+	void DirectSoundDevice::CreateUnderlyingDirectSoundBuffer(DWORD capacity)
+	{
+		// Set the buffer description of the secondary sound buffer that the wave file will be loaded onto.
+		m_desc = { 0 };
+		m_desc.dwSize = sizeof(DSBUFFERDESC);
+		m_desc.dwFlags = DSBCAPS_CTRLPOSITIONNOTIFY | DSBCAPS_GETCURRENTPOSITION2;
+		m_desc.lpwfxFormat = &m_wavFormat;
+		m_desc.dwBufferBytes = capacity;
+
+		auto hr = m_directSound->CreateSoundBuffer(&m_desc, &m_DSBuffer, NULL);
+		if (FAILED(hr)) {
+			throw std::runtime_error("sound::DirectSoundDevice - CreateSoundBuffer() failed.");
+		}
+	}
+
+	void DirectSoundDevice::CreateEvents(size_t count)
+	{
+		// Create Windows events that will be signaled when the play cursor
+		// crosses certain positions in the buffer.
+		// We need one event for each position being crossed, plus one that
+		// Interrupt sets to wake up the waiting thread.
+		m_numNotifications = count;
+		m_events.assign(count + 1, nullptr);
+		for (auto &event : m_events) {
+			event = CreateEventA(NULL, FALSE, FALSE, NULL);
+			if (!event) {
+				throw std::runtime_error("sound::DirectSoundDevice - CreateEventA() failed.");
+			}
+		}
+	}
+
+	void DirectSoundDevice::SendNotificationPositions(const std::vector<DWORD> &notifyOffsets)
+	{
+		const auto N = notifyOffsets.size();
+
+		std::vector<DSBPOSITIONNOTIFY> pos(N);
+		for (size_t i = 0; i < N; i++) {
+			pos[i].dwOffset = notifyOffsets[i];
+			pos[i].hEventNotify = m_events[i];
+		}
+
+		LPDIRECTSOUNDNOTIFY8 notify;
+		if (FAILED(m_DSBuffer->QueryInterface(IID_IDirectSoundNotify, (LPVOID *)&notify))) {
+			throw std::runtime_error("sound::DirectSoundDevice - QueryInterface() failed.");
+		}
+
+		auto hr = notify->SetNotificationPositions(static_cast<DWORD>(N), pos.data());
+		notify->Release();
+
+		if (FAILED(hr)) {
+			throw std::runtime_error("sound::DirectSoundDevice - SetNotificationPositions() failed.");
+		}
+	}
+
+	void DirectSoundDevice::Play()
+	{
+		// Move the play cursor to the beginning of the buffer.
+		m_DSBuffer->SetCurrentPosition(0);
+
+		m_DSBuffer->Play(0, 0, DSBPLAY_LOOPING);
+	}
+
+	void DirectSoundDevice::Stop()
+	{
+		m_DSBuffer->Stop();
+	}
+
+	void DirectSoundDevice::Resume()
+	{
+		// A stopped DirectSound buffer keeps its play cursor.
+		m_DSBuffer->Play(0, 0, DSBPLAY_LOOPING);
+	}
+
+	bool DirectSoundDevice::WaitForNotification(DWORD timeoutMs, int *pos)
+	{
+		assert(pos != nullptr);
+
+		// WaitForMultipleObjects reports the signaled event with the smallest index,
+		// so notifications take precedence over the interrupt event that comes last.
+		const auto N = static_cast<DWORD>(m_numNotifications);
+
+		auto hr = WaitForMultipleObjects(N + 1, m_events.data(), FALSE, timeoutMs);
+		if (WAIT_OBJECT_0 <= hr && hr < WAIT_OBJECT_0 + N) {
+			*pos = static_cast<int>(hr - WAIT_OBJECT_0);
+			return true;
+		}
+
+		return false;
+	}
+
+	void DirectSoundDevice::Interrupt()
+	{
+		if (!m_events.empty()) {
+			SetEvent(m_events.back());
+		}
+	}
+
+	Error DirectSoundDevice::Lock(DWORD offset, DWORD size, DeviceMemoryRegion *memory)
+	{
+		assert(memory != nullptr);
+
+		MemorySpan span0;
+		MemorySpan span1;
+
+		auto hr = m_DSBuffer->Lock(
+			offset,
+			size,
+			&span0.begin, &span0.length,
+			&span1.begin, &span1.length,
+			0
+		);
+
+		memory->span[0] = span0;
+		memory->span[1] = span1;
+
+		return FAILED(hr) ? ERROR_FAILURE : ERROR_NONE;
+	}
+
+	Error DirectSoundDevice::Unlock(const DeviceMemoryRegion &memory)
+	{
+		auto hr = m_DSBuffer->Unlock(
+			memory.span[0].begin, memory.span[0].length,	// first part
+			memory.span[1].begin, memory.span[1].length		// second part
+		);
+
+		return FAILED(hr) ? ERROR_FAILURE : ERROR_NONE;
+	}
+
+	DWORD DirectSoundDevice::PlayCursor()
+	{
+		DWORD play = 0;
+		DWORD write = 0;
+		m_DSBuffer->GetCurrentPosition(&play, &write);
+
+		return play;
+	}
+}
+
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+
+#ifdef _WIN32
+
+#pragma comment(lib,"winmm.lib")
+#pragma comment(lib,"dsound.lib")
+#pragma comment(lib,"dxguid.lib")
+
+#include "OutputDevice.h"
+
+namespace sound {
+
+	// CLASS:		DirectSoundDevice
+	//
+	// PURPOSE:		Output device that plays a DirectSound secondary buffer.
+	//				Notifications are Windows events set by DirectSound.
+	//				An extra event is used to interrupt a wait.
+	//
+	class DirectSoundDevice : public OutputDevice {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(DirectSoundDevice);
+
+		// The constructor creates the DirectSound object and the primary buffer.
+		// Throws if an error occured.
+		DirectSoundDevice(HWND window);
+
+		~DirectSoundDevice() override;
+
+		void CreateBuffer(const WAVEFORMATEX &format, DWORD capacity, const std::vector<DWORD> &notifyOffsets) override;
+
+		void Play() override;
+		void Stop() override;
+		void Resume() override;
+
+		bool WaitForNotification(DWORD timeoutMs, int *pos) override;
+		void Interrupt() override;
+
+		Error Lock(DWORD offset, DWORD size, DeviceMemoryRegion *memory) override;
+		Error Unlock(const DeviceMemoryRegion &memory) override;
+
+		DWORD PlayCursor() override;
+
+	private:
+		// These functions are only called by CreateBuffer.
+		// They all throw if an error occured.
+		void CreateUnderlyingDirectSoundBuffer(DWORD capacity);
+		void CreateEvents(size_t count);
+		void SendNotificationPositions(const std::vector<DWORD> &notifyOffsets);
+
+	private:
+		HWND					m_window{ nullptr };
+		LPDIRECTSOUND8			m_directSound{ nullptr };
+		LPDIRECTSOUNDBUFFER		m_primaryBuffer{ nullptr };
+
+		// The underlying DirectSound buffer.
+		LPDIRECTSOUNDBUFFER		m_DSBuffer{ nullptr };
+
+		WAVEFORMATEX			m_wavFormat;
+		DSBUFFERDESC			m_desc;
+
+		// One event per notification offset, followed by the interrupt event.
+		std::vector<HANDLE>		m_events;
+		size_t					m_numNotifications{ 0 };
+	};
+}
+
+#endif
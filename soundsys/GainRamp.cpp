@@ -0,0 +1,71 @@
+#include "pch.h"
+#include "GainRamp.h"
+#include "MixKernels.h"
+#include <algorithm>
+#include <cmath>
+
+namespace sound {
+
+	// -60 dB: where the exponential ramps from or to zero start or stop.
+	static const float kSilentGain = 0.001f;
+
+	void GainRamp::Set(float gain)
+	{
+		m_gain = gain;
+		m_target = gain;
+		m_numFramesLeft = 0;
+	}
+
+	void GainRamp::Start(float target, size_t numFrames, FADE_CURVE curve)
+	{
+		if (numFrames == 0 || target == m_gain) {
+			Set(target);
+			return;
+		}
+
+		m_target = target;
+		m_curve = curve;
+		m_numFrames = numFrames;
+		m_numFramesLeft = numFrames;
+
+		if (curve == FADE_CURVE_LINEAR) {
+			m_start = m_gain;
+			m_step = (target - m_gain) / static_cast<float>(numFrames);
+		}
+		else {
+			m_start = std::max(m_gain, kSilentGain);
+			m_factor = std::pow(static_cast<double>(std::max(target, kSilentGain)) / m_start, 1. / numFrames);
+		}
+	}
+
+	bool GainRamp::Next(size_t numFrames, float *gains)
+	{
+		if (m_numFramesLeft == 0 || numFrames == 0) {
+			return false;
+		}
+
+		const auto n = std::min(numFrames, m_numFramesLeft);
+		const auto elapsed = m_numFrames - m_numFramesLeft;
+
+		// Every chunk starts from the gain computed from the start of the ramp,
+		// so that rounding errors do not add up from chunk to chunk.
+		if (m_curve == FADE_CURVE_LINEAR) {
+			FillLinearRamp(gains, n, m_start + m_step * static_cast<float>(elapsed), m_step);
+		}
+		else {
+			auto base = static_cast<float>(m_start * std::pow(m_factor, static_cast<double>(elapsed)));
+			FillExponentialRamp(gains, n, base, static_cast<float>(m_factor));
+		}
+
+		m_numFramesLeft -= n;
+
+		// The last frame of the ramp is exactly at the target.
+		if (m_numFramesLeft == 0) {
+			gains[n - 1] = m_target;
+			std::fill(gains + n, gains + numFrames, m_target);
+		}
+
+		m_gain = gains[numFrames - 1];
+		return true;
+	}
+}
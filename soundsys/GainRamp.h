@@ -0,0 +1,68 @@
+#pragma once
+
+#include "framework.h"
+
+namespace sound {
+
+	// How the gain moves from its value to the target of a ramp.
+	enum FADE_CURVE {
+		// The gain changes by the same amount every frame.
+		FADE_CURVE_LINEAR,
+
+		// The gain changes by the same number of decibels every frame, which sounds even
+		// to the ear. Ramps from or to zero go through -60 dB instead, then jump to zero.
+		FADE_CURVE_EXPONENTIAL
+	};
+
+	// CLASS:		GainRamp
+	//
+	// PURPOSE:		The gain of a voice, which can move to a target over a number of frames.
+	//				The gain of every frame is computed, so that a ramp ends on the exact
+	//				frame asked, whatever the size of the chunks it is spread over.
+	//
+	class GainRamp {
+	public:
+		GainRamp(float gain = 1.f) : m_gain(gain), m_target(gain) {}
+
+		//				ACCESSORS
+		//
+
+		// Gain returns the gain of the last frame computed, or the constant gain.
+		float Gain() const { return m_gain; }
+
+		// Target returns the gain at the end of the ramp.
+		float Target() const { return m_target; }
+
+		// IsRamping returns true iff the gain has not reached the target yet.
+		bool IsRamping() const { return m_numFramesLeft > 0; }
+
+		//				MANIPULATORS
+		//
+
+		// Set sets the gain at once and cancels the ramp.
+		void Set(float gain);
+
+		// Start starts a ramp from the current gain to target over numFrames frames.
+		// If numFrames == 0, the gain is set at once.
+		void Start(float target, size_t numFrames, FADE_CURVE curve);
+
+		// Next computes the gains of the next numFrames frames.
+		// If the gain is constant over these frames, gains is left untouched and the function
+		// returns false: the gain of every frame is Gain().
+		// Otherwise the function fills gains with numFrames values and returns true.
+		bool Next(size_t numFrames, float *gains);
+
+	private:
+		float		m_gain;
+		float		m_target;
+
+		// The gain of the ramp after n frames is m_start + n * m_step (linear)
+		// or m_start * m_factor^n (exponential), for 1 <= n <= m_numFrames.
+		FADE_CURVE	m_curve{ FADE_CURVE_LINEAR };
+		float		m_start{ 0.f };
+		float		m_step{ 0.f };
+		double		m_factor{ 1. };
+		size_t		m_numFrames{ 0 };
+		size_t		m_numFramesLeft{ 0 };
+	};
+}
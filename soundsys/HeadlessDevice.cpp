@@ -0,0 +1,334 @@
+#include "pch.h"
+#include "HeadlessDevice.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace sound {
+
+	//					SIMULATED DEVICE
+	//
+
+	SimulatedDevice::SimulatedDevice(DEVICE_CLOCK clock)
+		: m_clock(clock)
+		, m_format{}
+	{}
+
+	void SimulatedDevice::CreateBuffer(const WAVEFORMATEX &format, DWORD capacity, const std::vector<DWORD> &notifyOffsets)
+	{
+		assert(capacity >= 1);
+		assert(format.nAvgBytesPerSec >= 1);
+
+		m_format = format;
+		m_buffer.assign(capacity, 0);
+		if (m_clock == DEVICE_CLOCK_MANUAL) {
+			m_silence.assign(capacity, 0);
+		}
+
+		m_offsets = notifyOffsets;
+		m_signaled.assign(notifyOffsets.size(), false);
+
+		for (auto offset : m_offsets) {
+			if (offset >= capacity) {
+				throw std::runtime_error("sound::SimulatedDevice - Notification offset out of the buffer.");
+			}
+		}
+	}
+
+	void SimulatedDevice::Play()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_cursor = 0;
+		m_playing = true;
+
+		m_playStart = Clock::now();
+		m_bytesSincePlay = 0;
+
+		// A thread waiting for the device to play can now wait for the next offset.
+		m_wakeUp.notify_all();
+	}
+
+	void SimulatedDevice::Stop()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_playing && m_clock == DEVICE_CLOCK_REAL_TIME) {
+			UpdateRealTimeCursor();
+		}
+
+		m_playing = false;
+	}
+
+	void SimulatedDevice::Resume()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_playing = true;
+
+		// The real-time clock starts again from the cursor.
+		m_playStart = Clock::now();
+		m_bytesSincePlay = 0;
+
+		m_wakeUp.notify_all();
+	}
+
+	bool SimulatedDevice::WaitForNotification(DWORD timeoutMs, int *pos)
+	{
+		assert(pos != nullptr);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		const auto forever = (timeoutMs == kWaitForever);
+		const auto deadline = Clock::now() + std::chrono::milliseconds(forever ? 0 : timeoutMs);
+
+		while (true) {
+			const auto moving = m_playing && !m_offsets.empty();
+
+			if (moving && m_clock == DEVICE_CLOCK_REAL_TIME) {
+				UpdateRealTimeCursor();
+			}
+
+			if (PopNotification(pos)) {
+				return true;
+			}
+
+			if (m_interrupted) {
+				m_interrupted = false;
+				return false;
+			}
+
+			if (moving && m_clock == DEVICE_CLOCK_AS_FAST_AS_POSSIBLE) {
+				MoveCursor(DistanceToNextOffset());
+				continue;
+			}
+
+			auto now = Clock::now();
+			if (timeoutMs == 0 || (!forever && now >= deadline)) {
+				return false;
+			}
+
+			// Sleep until the cursor reaches the next offset, the timeout expires or
+			// the wait is interrupted.
+			auto wakeUpTime = deadline;
+			if (moving) {
+				auto untilNextOffset = std::chrono::microseconds(
+					(1000000ull * DistanceToNextOffset() + m_format.nAvgBytesPerSec - 1) / m_format.nAvgBytesPerSec
+				);
+				if (forever || now + untilNextOffset < deadline) {
+					wakeUpTime = now + untilNextOffset;
+				}
+			}
+			else if (forever) {
+				m_wakeUp.wait(lock);
+				continue;
+			}
+
+			m_wakeUp.wait_until(lock, wakeUpTime);
+		}
+	}
+
+	void SimulatedDevice::Interrupt()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_interrupted = true;
+		m_wakeUp.notify_all();
+	}
+
+	Error SimulatedDevice::Lock(DWORD offset, DWORD size, DeviceMemoryRegion *memory)
+	{
+		assert(memory != nullptr);
+
+		const auto capacity = static_cast<DWORD>(m_buffer.size());
+		if (offset >= capacity || size > capacity) {
+			return ERROR_FAILURE;
+		}
+
+		auto length0 = std::min(size, capacity - offset);
+
+		memory->span[0] = MemorySpan{ m_buffer.data() + offset, length0 };
+		memory->span[1] = MemorySpan{};
+
+		if (length0 < size) {
+			memory->span[1] = MemorySpan{ m_buffer.data(), size - length0 };
+		}
+
+		return ERROR_NONE;
+	}
+
+	Error SimulatedDevice::Unlock(const DeviceMemoryRegion & /*memory*/)
+	{
+		return ERROR_NONE;
+	}
+
+	DWORD SimulatedDevice::PlayCursor()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_playing && m_clock == DEVICE_CLOCK_REAL_TIME) {
+			UpdateRealTimeCursor();
+		}
+
+		return m_cursor;
+	}
+
+	uint64_t SimulatedDevice::PlayedBytes() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		return m_playedBytes;
+	}
+
+	DWORD SimulatedDevice::Advance(DWORD maxBytes)
+	{
+		assert(m_clock == DEVICE_CLOCK_MANUAL);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		const auto capacity = static_cast<DWORD>(m_buffer.size());
+		auto numBytes = std::min(maxBytes, capacity);
+		if (m_playing && !m_offsets.empty()) {
+			numBytes = std::min(numBytes, DistanceToNextOffset());
+		}
+		if (m_format.nBlockAlign > 1) {
+			numBytes -= numBytes % m_format.nBlockAlign;
+		}
+
+		if (m_playing) {
+			MoveCursor(numBytes);
+		}
+		else {
+			Consume(m_silence.data(), numBytes);
+		}
+
+		return numBytes;
+	}
+
+	void SimulatedDevice::MoveCursor(uint64_t numBytes)
+	{
+		const auto capacity = static_cast<DWORD>(m_buffer.size());
+
+		while (numBytes > 0) {
+			auto length = static_cast<DWORD>(std::min<uint64_t>(numBytes, capacity - m_cursor));
+			auto end = m_cursor + length;
+
+			// An offset is reached when the cursor moves onto it.
+			// The offset 0 is reached when the cursor wraps around.
+			for (size_t i = 0; i < m_offsets.size(); i++) {
+				auto offset = (m_offsets[i] == 0) ? capacity : m_offsets[i];
+				if (m_cursor < offset && offset <= end) {
+					m_signaled[i] = true;
+				}
+			}
+
+			Consume(m_buffer.data() + m_cursor, length);
+
+			m_cursor = end % capacity;
+			m_playedBytes += length;
+			numBytes -= length;
+		}
+	}
+
+	void SimulatedDevice::UpdateRealTimeCursor()
+	{
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - m_playStart);
+
+		// The cursor only moves by whole sample frames.
+		uint64_t target = elapsed.count() * m_format.nAvgBytesPerSec / 1000000ull;
+		if (m_format.nBlockAlign > 1) {
+			target -= target % m_format.nBlockAlign;
+		}
+
+		if (target > m_bytesSincePlay) {
+			MoveCursor(target - m_bytesSincePlay);
+			m_bytesSincePlay = target;
+		}
+	}
+
+	DWORD SimulatedDevice::DistanceToNextOffset() const
+	{
+		const auto capacity = static_cast<DWORD>(m_buffer.size());
+
+		DWORD distance = capacity;
+		for (auto offset : m_offsets) {
+			auto d = (offset + capacity - m_cursor) % capacity;
+			if (d == 0) {
+				d = capacity;
+			}
+			distance = std::min(distance, d);
+		}
+
+		return distance;
+	}
+
+	bool SimulatedDevice::PopNotification(int *pos)
+	{
+		for (size_t i = 0; i < m_signaled.size(); i++) {
+			if (m_signaled[i]) {
+				m_signaled[i] = false;
+				*pos = static_cast<int>(i);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+
+	//					WAV FILE DEVICE
+	//
+
+	WavFileDevice::WavFileDevice(const char *filename, DEVICE_CLOCK clock)
+		: SimulatedDevice(clock)
+		, m_file(filename, std::ios::binary)
+	{
+		if (!m_file) {
+			throw std::runtime_error("sound::WavFileDevice - Cannot create the output file.");
+		}
+	}
+
+	WavFileDevice::~WavFileDevice()
+	{
+		// Complete the header now that the size of the audio data is known.
+		m_file.seekp(0);
+		WriteHeader(m_dataSize);
+	}
+
+	void WavFileDevice::CreateBuffer(const WAVEFORMATEX &format, DWORD capacity, const std::vector<DWORD> &notifyOffsets)
+	{
+		SimulatedDevice::CreateBuffer(format, capacity, notifyOffsets);
+
+		// Reserve the space of the header; it is rewritten at destruction.
+		WriteHeader(0);
+	}
+
+	void WavFileDevice::Consume(const byte *data, DWORD size)
+	{
+		m_file.write((const char *)data, size);
+		m_dataSize += size;
+	}
+
+	void WavFileDevice::WriteHeader(DWORD dataSize)
+	{
+		const auto &format = Format();
+
+		auto write32 = [this](uint32_t v) { m_file.write((const char *)&v, 4); };
+		auto write16 = [this](uint16_t v) { m_file.write((const char *)&v, 2); };
+
+		m_file.write("RIFF", 4);
+		write32(36 + dataSize);
+		m_file.write("WAVE", 4);
+
+		m_file.write("fmt ", 4);
+		write32(16);
+		write16(format.wFormatTag);
+		write16(format.nChannels);
+		write32(format.nSamplesPerSec);
+		write32(format.nAvgBytesPerSec);
+		write16(format.nBlockAlign);
+		write16(format.wBitsPerSample);
+
+		m_file.write("data", 4);
+		write32(dataSize);
+	}
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "OutputDevice.h"
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+
+namespace sound {
+
+	// How the play cursor of a headless device moves.
+	enum DEVICE_CLOCK {
+		// The cursor moves at the byte rate of the buffer format, like a sound card.
+		DEVICE_CLOCK_REAL_TIME,
+
+		// The cursor jumps to the next notification offset each time the device is waited on.
+		// Nothing sleeps: the stream is processed as fast as the CPU allows.
+		DEVICE_CLOCK_AS_FAST_AS_POSSIBLE,
+
+		// The cursor only moves when the owner of the device calls Advance.
+		// This is the virtual clock of the offline rendering.
+		DEVICE_CLOCK_MANUAL
+	};
+
+	// CLASS:		SimulatedDevice
+	//
+	// PURPOSE:		Output device without audio hardware.
+	//				The buffer lives in memory and the play cursor is simulated.
+	//				Derived classes receive the bytes the play cursor moves over.
+	//				A thread waiting for a notification sleeps on a condition variable.
+	//
+	class SimulatedDevice : public OutputDevice {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(SimulatedDevice);
+
+		SimulatedDevice(DEVICE_CLOCK clock);
+
+		void CreateBuffer(const WAVEFORMATEX &format, DWORD capacity, const std::vector<DWORD> &notifyOffsets) override;
+
+		void Play() override;
+		void Stop() override;
+		void Resume() override;
+
+		bool WaitForNotification(DWORD timeoutMs, int *pos) override;
+		void Interrupt() override;
+
+		Error Lock(DWORD offset, DWORD size, DeviceMemoryRegion *memory) override;
+		Error Unlock(const DeviceMemoryRegion &memory) override;
+
+		DWORD PlayCursor() override;
+
+		DEVICE_CLOCK ClockKind() const { return m_clock; }
+
+		// PlayedBytes returns the number of bytes the play cursor moved over
+		// since the creation of the device.
+		uint64_t PlayedBytes() const;
+
+		// Advance moves the play cursor of a device with a manual clock forward by up to
+		// maxBytes, and stops at the next notification offset. While the buffer is stopped,
+		// time passes in silence: the device consumes zeros instead.
+		// Returns the number of bytes played, a multiple of the frame size.
+		//
+		// PRECONDITIONS
+		//	The clock is DEVICE_CLOCK_MANUAL.
+		//
+		DWORD Advance(DWORD maxBytes);
+
+	protected:
+		// Consume is called with the bytes the play cursor moves over, in order.
+		virtual void Consume(const byte * /*data*/, DWORD /*size*/) {}
+
+		const WAVEFORMATEX &Format() const { return m_format; }
+
+	private:
+		// MoveCursor moves the play cursor forward by numBytes, wrapping around
+		// the end of the buffer, and marks the notification offsets that are reached.
+		void MoveCursor(uint64_t numBytes);
+
+		// UpdateRealTimeCursor moves the play cursor to where the clock says it should be.
+		void UpdateRealTimeCursor();
+
+		// DistanceToNextOffset returns the number of bytes between the play cursor
+		// and the next notification offset.
+		DWORD DistanceToNextOffset() const;
+
+		// PopNotification returns the smallest signaled index and clears it,
+		// the same way WaitForMultipleObjects reports auto-reset events.
+		bool PopNotification(int *pos);
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		// Protects the cursor state below against Interrupt and PlayCursor
+		// calls from other threads.
+		mutable std::mutex		m_mutex;
+		std::condition_variable	m_wakeUp;
+		bool					m_interrupted{ false };
+
+		DEVICE_CLOCK			m_clock;
+
+		WAVEFORMATEX			m_format;
+		std::vector<byte>		m_buffer;
+
+		// Manual clock: the silence consumed while the buffer is stopped.
+		std::vector<byte>		m_silence;
+
+		std::vector<DWORD>		m_offsets;
+		std::vector<bool>		m_signaled;
+
+		bool					m_playing{ false };
+		DWORD					m_cursor{ 0 };
+		uint64_t				m_playedBytes{ 0 };
+
+		// Real-time clock: the time of the last call to Play or Resume and the number
+		// of bytes played since then.
+		Clock::time_point		m_playStart;
+		uint64_t				m_bytesSincePlay{ 0 };
+	};
+
+	// CLASS:		NullDevice
+	//
+	// PURPOSE:		Simulated device that discards the audio.
+	//
+	class NullDevice : public SimulatedDevice {
+	public:
+		NullDevice(DEVICE_CLOCK clock = DEVICE_CLOCK_AS_FAST_AS_POSSIBLE)
+			: SimulatedDevice(clock)
+		{}
+	};
+
+	// CLASS:		WavFileDevice
+	//
+	// PURPOSE:		Simulated device that records the audio played into a WAV file.
+	//				The file header is completed when the device is destroyed.
+	//
+	class WavFileDevice : public SimulatedDevice {
+	public:
+		// Throws if the file cannot be created.
+		WavFileDevice(const char *filename, DEVICE_CLOCK clock = DEVICE_CLOCK_AS_FAST_AS_POSSIBLE);
+
+		~WavFileDevice() override;
+
+		void CreateBuffer(const WAVEFORMATEX &format, DWORD capacity, const std::vector<DWORD> &notifyOffsets) override;
+
+	protected:
+		void Consume(const byte *data, DWORD size) override;
+
+	private:
+		// WriteHeader writes the RIFF header of a file containing dataSize bytes of audio.
+		void WriteHeader(DWORD dataSize);
+
+	private:
+		std::ofstream	m_file;
+		DWORD			m_dataSize{ 0 };
+	};
+}
@@ -0,0 +1,88 @@
+#include "pch.h"
+#include "HealthMetrics.h"
+
+namespace sound {
+
+	static int BucketOf(uint64_t microseconds)
+	{
+		int bucket = 0;
+		while (microseconds > 0 && bucket < kNumHistogramBuckets - 1) {
+			microseconds >>= 1;
+			bucket++;
+		}
+
+		return bucket;
+	}
+
+
+	//					HISTOGRAM
+	//
+
+	void HealthMetrics::Histogram::Record(uint64_t microseconds)
+	{
+		Increment(m_buckets[BucketOf(microseconds)]);
+		Increment(m_count);
+
+		const auto relaxed = std::memory_order_relaxed;
+		m_totalMicroseconds.store(m_totalMicroseconds.load(relaxed) + microseconds, relaxed);
+		if (microseconds > m_maxMicroseconds.load(relaxed)) {
+			m_maxMicroseconds.store(microseconds, relaxed);
+		}
+	}
+
+	void HealthMetrics::Histogram::CopyTo(DurationHistogram *histogram) const
+	{
+		const auto relaxed = std::memory_order_relaxed;
+		for (int i = 0; i < kNumHistogramBuckets; i++) {
+			histogram->buckets[i] = m_buckets[i].load(relaxed);
+		}
+		histogram->count = m_count.load(relaxed);
+		histogram->totalMicroseconds = m_totalMicroseconds.load(relaxed);
+		histogram->maxMicroseconds = m_maxMicroseconds.load(relaxed);
+	}
+
+
+	//					METRICS
+	//
+
+	HealthSnapshot HealthMetrics::Snapshot() const
+	{
+		const auto relaxed = std::memory_order_relaxed;
+
+		HealthSnapshot snapshot;
+		snapshot.numRefills = m_numRefills.load(relaxed);
+		snapshot.numUnderruns = m_numUnderruns.load(relaxed);
+		snapshot.numNearMisses = m_numNearMisses.load(relaxed);
+
+		m_refillDuration.CopyTo(&snapshot.refillDuration);
+		m_readLatency.CopyTo(&snapshot.readLatency);
+		m_wakeupJitter.CopyTo(&snapshot.wakeupJitter);
+
+		return snapshot;
+	}
+
+	void HealthMetrics::RecordRefill(uint64_t durationNs, uint64_t readNs, bool underrun, bool nearMiss)
+	{
+		Increment(m_numRefills);
+		if (underrun) {
+			Increment(m_numUnderruns);
+		}
+		else if (nearMiss) {
+			Increment(m_numNearMisses);
+		}
+
+		m_refillDuration.Record(durationNs / 1000);
+		m_readLatency.Record(readNs / 1000);
+	}
+
+	void HealthMetrics::RecordWakeup(uint64_t jitterNs)
+	{
+		m_wakeupJitter.Record(jitterNs / 1000);
+	}
+
+	void HealthMetrics::Increment(std::atomic<uint64_t> &counter)
+	{
+		// A single writer needs no read-modify-write instruction.
+		counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "framework.h"
+#include <array>
+#include <atomic>
+
+namespace sound {
+
+	// Number of buckets of a duration histogram. Bucket 0 counts the durations under 1 us,
+	// bucket k the durations in [2^(k-1), 2^k) us, and the last one all the longer ones.
+	const int kNumHistogramBuckets = 24;
+
+	// DurationHistogram is a copy of the distribution of a duration, in microseconds.
+	struct DurationHistogram {
+		std::array<uint64_t, kNumHistogramBuckets>	buckets{};
+		uint64_t	count{ 0 };
+		uint64_t	totalMicroseconds{ 0 };
+		uint64_t	maxMicroseconds{ 0 };
+	};
+
+	// HealthSnapshot is a copy of the streaming health metrics.
+	struct HealthSnapshot {
+		uint64_t	numRefills{ 0 };
+
+		// Refills that the play cursor reached before they were written: stale audio was heard.
+		uint64_t	numUnderruns{ 0 };
+
+		// Refills written with less than half a region to spare.
+		uint64_t	numNearMisses{ 0 };
+
+		// Time to mix and write the regions of a refill.
+		DurationHistogram	refillDuration;
+
+		// Time the voices spent reading their files during a refill.
+		DurationHistogram	readLatency;
+
+		// Time between the play cursor crossing a notification position and the
+		// streaming thread waking up.
+		DurationHistogram	wakeupJitter;
+	};
+
+	// CLASS:		HealthMetrics
+	//
+	// PURPOSE:		Counters and histograms written by the streaming thread and read from
+	//				any thread. Recording takes no lock and allocates nothing: each value is
+	//				a relaxed atomic with a single writer. A snapshot copies them one by one,
+	//				so it can mix values from consecutive refills.
+	//
+	class HealthMetrics {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(HealthMetrics);
+
+		HealthMetrics() = default;
+
+		//				ACCESSORS
+		//
+
+		// Snapshot copies the metrics. It can be called from any thread.
+		HealthSnapshot Snapshot() const;
+
+		//				MANIPULATORS
+		//
+		// Only one thread records the metrics.
+
+		// RecordRefill records the outcome of a refill, with its durations in nanoseconds.
+		void RecordRefill(uint64_t durationNs, uint64_t readNs, bool underrun, bool nearMiss);
+
+		// RecordWakeup records how late the streaming thread woke up, in nanoseconds.
+		void RecordWakeup(uint64_t jitterNs);
+
+	private:
+		class Histogram {
+		public:
+			void Record(uint64_t microseconds);
+			void CopyTo(DurationHistogram *histogram) const;
+
+		private:
+			std::array<std::atomic<uint64_t>, kNumHistogramBuckets>	m_buckets{};
+			std::atomic<uint64_t>	m_count{ 0 };
+			std::atomic<uint64_t>	m_totalMicroseconds{ 0 };
+			std::atomic<uint64_t>	m_maxMicroseconds{ 0 };
+		};
+
+		// Increment adds one to a counter that only the recording thread writes.
+		static void Increment(std::atomic<uint64_t> &counter);
+
+	private:
+		std::atomic<uint64_t>	m_numRefills{ 0 };
+		std::atomic<uint64_t>	m_numUnderruns{ 0 };
+		std::atomic<uint64_t>	m_numNearMisses{ 0 };
+
+		Histogram				m_refillDuration;
+		Histogram				m_readLatency;
+		Histogram				m_wakeupJitter;
+	};
+}
@@ -0,0 +1,53 @@
+#include "pch.h"
+#include "LatencyController.h"
+#include <algorithm>
+
+namespace sound {
+
+	LatencyController::LatencyController(int minLead, int maxLead, int initialLead, int numStableRefills)
+		: m_minLead(minLead)
+		, m_maxLead(maxLead)
+		, m_lead(std::min(std::max(initialLead, minLead), maxLead))
+		, m_numStableRefills(numStableRefills)
+	{
+		assert(1 <= minLead && minLead <= maxLead);
+		assert(numStableRefills >= 1);
+
+		StartPeriod();
+	}
+
+	void LatencyController::OnRefill(DWORD slack, DWORD regionSize, bool underrun)
+	{
+		// An underrun was heard: leave a margin that two late refills in a row do not eat.
+		if (underrun) {
+			m_lead = std::min(m_lead + 2, m_maxLead);
+			StartPeriod();
+			return;
+		}
+
+		// A near miss: the next late wakeup would be heard.
+		if (IsNearMiss(slack, regionSize)) {
+			m_lead = std::min(m_lead + 1, m_maxLead);
+			StartPeriod();
+			return;
+		}
+
+		m_minSlack = std::min(m_minSlack, slack);
+		m_numRefills++;
+		if (m_numRefills < m_numStableRefills) {
+			return;
+		}
+
+		// One region less would have kept every slack of the period above half a region.
+		if (m_minSlack >= 2 * regionSize) {
+			m_lead = std::max(m_lead - 1, m_minLead);
+		}
+		StartPeriod();
+	}
+
+	void LatencyController::StartPeriod()
+	{
+		m_numRefills = 0;
+		m_minSlack = 0xFFFFFFFF;
+	}
+}
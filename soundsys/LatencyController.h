@@ -0,0 +1,52 @@
+#pragma once
+
+#include "framework.h"
+
+namespace sound {
+
+	// CLASS:		LatencyController
+	//
+	// PURPOSE:		Picks the lead of the refills: how many regions ahead of the play cursor
+	//				the streaming thread writes. The lead is the latency of the sounds.
+	//				Each refill reports its slack, the bytes the play cursor still had to play
+	//				before reaching the refilled region. An underrun, or a slack below half a
+	//				region, makes the lead grow at once. A whole stable period in which every
+	//				slack kept two regions to spare makes it shrink by one region.
+	//
+	class LatencyController {
+	public:
+		// The lead stays in [minLead, maxLead]. It shrinks after numStableRefills refills
+		// without a near miss.
+		LatencyController(int minLead = 1, int maxLead = 1, int initialLead = 1, int numStableRefills = 1);
+
+		//				ACCESSORS
+		//
+
+		// Lead returns the number of regions between the play cursor and the next refill.
+		int Lead() const { return m_lead; }
+
+		// IsNearMiss returns true iff a refill with this slack nearly missed its deadline.
+		static bool IsNearMiss(DWORD slack, DWORD regionSize) { return slack < regionSize / 2; }
+
+		//				MANIPULATORS
+		//
+
+		// OnRefill records the deadline slack of a refill, in bytes, and updates the lead.
+		// underrun is true iff the play cursor was already inside the refilled region.
+		void OnRefill(DWORD slack, DWORD regionSize, bool underrun);
+
+	private:
+		// StartPeriod forgets the refills recorded so far.
+		void StartPeriod();
+
+	private:
+		int		m_minLead;
+		int		m_maxLead;
+		int		m_lead;
+		int		m_numStableRefills;
+
+		// Stable period: number of refills recorded and smallest slack.
+		int		m_numRefills{ 0 };
+		DWORD	m_minSlack{ 0 };
+	};
+}
@@ -0,0 +1,158 @@
+#include "pch.h"
+#include "MappedFile.h"
+#include <algorithm>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sound {
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	void MappedFile::Swap(MappedFile &other)
+	{
+		std::swap(m_isOpen, other.m_isOpen);
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+#ifdef _WIN32
+		std::swap(m_file, other.m_file);
+		std::swap(m_mapping, other.m_mapping);
+#endif
+	}
+
+#ifdef _WIN32
+	Error MappedFile::Open(const char *filename)
+	{
+		Close();
+
+		m_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (m_file == INVALID_HANDLE_VALUE) {
+			return ERROR_FAILURE;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size)) {
+			Close();
+			return ERROR_FAILURE;
+		}
+		m_size = static_cast<size_t>(size.QuadPart);
+
+		// An empty file cannot be mapped but it is still a valid audio file.
+		if (m_size > 0) {
+			m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (!m_mapping) {
+				Close();
+				return ERROR_FAILURE;
+			}
+
+			m_data = (const byte *)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+			if (!m_data) {
+				Close();
+				return ERROR_FAILURE;
+			}
+		}
+
+		m_isOpen = true;
+		return ERROR_NONE;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_data) {
+			UnmapViewOfFile(m_data);
+		}
+		if (m_mapping) {
+			CloseHandle(m_mapping);
+		}
+		if (m_file != INVALID_HANDLE_VALUE) {
+			CloseHandle(m_file);
+		}
+
+		m_mapping = nullptr;
+		m_file = INVALID_HANDLE_VALUE;
+		m_data = nullptr;
+		m_size = 0;
+		m_isOpen = false;
+	}
+
+	void MappedFile::Prefetch(size_t offset, size_t size) const
+	{
+		if (!m_data || offset >= m_size) {
+			return;
+		}
+
+		WIN32_MEMORY_RANGE_ENTRY range;
+		range.VirtualAddress = (PVOID)(m_data + offset);
+		range.NumberOfBytes = std::min(size, m_size - offset);
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	Error MappedFile::Open(const char *filename)
+	{
+		Close();
+
+		int fd = open(filename, O_RDONLY);
+		if (fd < 0) {
+			return ERROR_FAILURE;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			close(fd);
+			return ERROR_FAILURE;
+		}
+		m_size = static_cast<size_t>(st.st_size);
+
+		// An empty file cannot be mapped but it is still a valid audio file.
+		if (m_size > 0) {
+			void *addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (addr == MAP_FAILED) {
+				close(fd);
+				m_size = 0;
+				return ERROR_FAILURE;
+			}
+
+			// The audio is read from start to end: let the kernel read ahead.
+			madvise(addr, m_size, MADV_SEQUENTIAL);
+			m_data = (const byte *)addr;
+		}
+
+		// The mapping stays valid after the descriptor is closed.
+		close(fd);
+
+		m_isOpen = true;
+		return ERROR_NONE;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_data) {
+			munmap((void *)m_data, m_size);
+		}
+
+		m_data = nullptr;
+		m_size = 0;
+		m_isOpen = false;
+	}
+
+	void MappedFile::Prefetch(size_t offset, size_t size) const
+	{
+		if (!m_data || offset >= m_size) {
+			return;
+		}
+
+		// madvise wants an address aligned on a page.
+		const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		const auto begin = offset - offset % pageSize;
+		const auto end = std::min(offset + size, m_size);
+		madvise((void *)(m_data + begin), end - begin, MADV_WILLNEED);
+	}
+#endif
+}
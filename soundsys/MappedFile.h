@@ -0,0 +1,57 @@
+#pragma once
+
+#include "framework.h"
+
+namespace sound {
+
+	// CLASS:		MappedFile
+	//
+	// PURPOSE:		Maps a whole file in memory, read-only.
+	//				Pages are loaded by the OS when they are first accessed.
+	//
+	class MappedFile {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(MappedFile);
+
+		MappedFile() {}
+		~MappedFile();
+
+		//				ACCESSORS
+		//
+
+		bool IsOpen() const { return m_isOpen; }
+
+		// Data returns the address of the first byte of the file.
+		// It is nullptr if the file is empty.
+		const byte *Data() const { return m_data; }
+
+		size_t Size() const { return m_size; }
+
+		//				MANIPULATORS
+		//
+
+		// Open maps the file. The previously mapped file, if any, is closed.
+		Error Open(const char *filename);
+
+		// Prefetch asks the OS to load size bytes from offset in the background,
+		// so that reading them later does not wait for the disk.
+		void Prefetch(size_t offset, size_t size) const;
+
+		// Close unmaps the file. Pointers returned by Data become invalid.
+		void Close();
+
+		// Swap exchanges the mappings of two objects. The mappings do not move:
+		// pointers returned by Data stay valid, and point into the other object's file.
+		void Swap(MappedFile &other);
+
+	private:
+		bool		m_isOpen{ false };
+		const byte	*m_data{ nullptr };
+		size_t		m_size{ 0 };
+
+#ifdef _WIN32
+		HANDLE		m_file{ INVALID_HANDLE_VALUE };
+		HANDLE		m_mapping{ nullptr };
+#endif
+	};
+}
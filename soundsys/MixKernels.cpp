@@ -0,0 +1,241 @@
+#include "pch.h"
+#include "MixKernels.h"
+
+#ifdef SOUND_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace sound {
+
+	static const float kS16InvScale = 1.f / 32768.f;
+
+	//					SCALAR
+	//
+
+	void AccumulateS16_Scalar(float *acc, const int16_t *src, size_t n, float gain)
+	{
+		const auto scale = gain * kS16InvScale;
+
+		for (size_t i = 0; i < n; i++) {
+			acc[i] = acc[i] + static_cast<float>(src[i]) * scale;
+		}
+	}
+
+	void AccumulateF32_Scalar(float *acc, const float *src, size_t n, float gain)
+	{
+		for (size_t i = 0; i < n; i++) {
+			acc[i] = acc[i] + src[i] * gain;
+		}
+	}
+
+	void AccumulateS16Ramp_Scalar(float *acc, const int16_t *src, size_t numFrames, int numChannels, const float *gains)
+	{
+		for (size_t f = 0; f < numFrames; f++) {
+			for (int c = 0; c < numChannels; c++) {
+				auto i = f * numChannels + c;
+				acc[i] = acc[i] + (static_cast<float>(src[i]) * kS16InvScale) * gains[f];
+			}
+		}
+	}
+
+	void AccumulateF32Ramp_Scalar(float *acc, const float *src, size_t numFrames, int numChannels, const float *gains)
+	{
+		for (size_t f = 0; f < numFrames; f++) {
+			for (int c = 0; c < numChannels; c++) {
+				auto i = f * numChannels + c;
+				acc[i] = acc[i] + src[i] * gains[f];
+			}
+		}
+	}
+
+	void FillLinearRamp_Scalar(float *gains, size_t n, float start, float step)
+	{
+		for (size_t k = 0; k < n; k++) {
+			gains[k] = start + step * static_cast<float>(k + 1);
+		}
+	}
+
+	// The gains are computed 4 at a time from powers of the factor, the way the SIMD
+	// version does, rather than by multiplying the previous gain by the factor.
+	void FillExponentialRamp_Scalar(float *gains, size_t n, float start, float factor)
+	{
+		const float f2 = factor * factor;
+		const float powers[4] = { factor, f2, f2 * factor, f2 * f2 };
+
+		auto base = start;
+		for (size_t k = 0; k < n; k += 4) {
+			for (size_t j = 0; j < 4 && k + j < n; j++) {
+				gains[k + j] = base * powers[j];
+			}
+			base = base * powers[3];
+		}
+	}
+
+
+
+	//					SSE2
+	//
+
+#ifdef SOUND_HAS_SSE2
+	void AccumulateS16(float *acc, const int16_t *src, size_t n, float gain)
+	{
+		const auto scale = _mm_set1_ps(gain * kS16InvScale);
+
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8) {
+			auto s = _mm_loadu_si128((const __m128i *)(src + i));
+
+			// Sign-extend the 16-bit samples to 32 bits.
+			auto lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+			auto hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+
+			auto a0 = _mm_loadu_ps(acc + i);
+			auto a1 = _mm_loadu_ps(acc + i + 4);
+			a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+			a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+			_mm_storeu_ps(acc + i, a0);
+			_mm_storeu_ps(acc + i + 4, a1);
+		}
+
+		AccumulateS16_Scalar(acc + i, src + i, n - i, gain);
+	}
+
+	void AccumulateF32(float *acc, const float *src, size_t n, float gain)
+	{
+		const auto g = _mm_set1_ps(gain);
+
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			auto a = _mm_loadu_ps(acc + i);
+			a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+			_mm_storeu_ps(acc + i, a);
+		}
+
+		AccumulateF32_Scalar(acc + i, src + i, n - i, gain);
+	}
+
+	// LoadFrameGains returns the gains of the 4 samples starting at frame f:
+	// 4 frames in mono, 2 frames in stereo.
+	static inline __m128 LoadFrameGains(const float *gains, size_t f, int numChannels)
+	{
+		if (numChannels == 1) {
+			return _mm_loadu_ps(gains + f);
+		}
+
+		auto g = _mm_castpd_ps(_mm_load_sd((const double *)(gains + f)));
+		return _mm_unpacklo_ps(g, g);
+	}
+
+	void AccumulateS16Ramp(float *acc, const int16_t *src, size_t numFrames, int numChannels, const float *gains)
+	{
+		const auto scale = _mm_set1_ps(kS16InvScale);
+		const size_t framesPerStep = 8 / numChannels;
+
+		size_t f = 0;
+		for (; f + framesPerStep <= numFrames; f += framesPerStep) {
+			const auto i = f * numChannels;
+			auto s = _mm_loadu_si128((const __m128i *)(src + i));
+
+			auto lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+			auto hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+
+			auto g0 = LoadFrameGains(gains, f, numChannels);
+			auto g1 = LoadFrameGains(gains, f + framesPerStep / 2, numChannels);
+
+			auto a0 = _mm_loadu_ps(acc + i);
+			auto a1 = _mm_loadu_ps(acc + i + 4);
+			a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo), scale), g0));
+			a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), scale), g1));
+			_mm_storeu_ps(acc + i, a0);
+			_mm_storeu_ps(acc + i + 4, a1);
+		}
+
+		const auto i = f * numChannels;
+		AccumulateS16Ramp_Scalar(acc + i, src + i, numFrames - f, numChannels, gains + f);
+	}
+
+	void AccumulateF32Ramp(float *acc, const float *src, size_t numFrames, int numChannels, const float *gains)
+	{
+		const size_t framesPerStep = 4 / numChannels;
+
+		size_t f = 0;
+		for (; f + framesPerStep <= numFrames; f += framesPerStep) {
+			const auto i = f * numChannels;
+			auto g = LoadFrameGains(gains, f, numChannels);
+
+			auto a = _mm_loadu_ps(acc + i);
+			a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+			_mm_storeu_ps(acc + i, a);
+		}
+
+		const auto i = f * numChannels;
+		AccumulateF32Ramp_Scalar(acc + i, src + i, numFrames - f, numChannels, gains + f);
+	}
+
+	void FillLinearRamp(float *gains, size_t n, float start, float step)
+	{
+		const auto vstart = _mm_set1_ps(start);
+		const auto vstep = _mm_set1_ps(step);
+		const auto four = _mm_set1_epi32(4);
+
+		auto k = _mm_setr_epi32(1, 2, 3, 4);
+
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			_mm_storeu_ps(gains + i, _mm_add_ps(vstart, _mm_mul_ps(vstep, _mm_cvtepi32_ps(k))));
+			k = _mm_add_epi32(k, four);
+		}
+
+		for (; i < n; i++) {
+			gains[i] = start + step * static_cast<float>(i + 1);
+		}
+	}
+
+	void FillExponentialRamp(float *gains, size_t n, float start, float factor)
+	{
+		const float f2 = factor * factor;
+		const auto powers = _mm_setr_ps(factor, f2, f2 * factor, f2 * f2);
+		const auto f4 = _mm_set1_ps(f2 * f2);
+
+		auto base = _mm_set1_ps(start);
+
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			_mm_storeu_ps(gains + i, _mm_mul_ps(base, powers));
+			base = _mm_mul_ps(base, f4);
+		}
+
+		FillExponentialRamp_Scalar(gains + i, n - i, _mm_cvtss_f32(base), factor);
+	}
+#else
+	void AccumulateS16(float *acc, const int16_t *src, size_t n, float gain)
+	{
+		AccumulateS16_Scalar(acc, src, n, gain);
+	}
+
+	void AccumulateF32(float *acc, const float *src, size_t n, float gain)
+	{
+		AccumulateF32_Scalar(acc, src, n, gain);
+	}
+
+	void AccumulateS16Ramp(float *acc, const int16_t *src, size_t numFrames, int numChannels, const float *gains)
+	{
+		AccumulateS16Ramp_Scalar(acc, src, numFrames, numChannels, gains);
+	}
+
+	void AccumulateF32Ramp(float *acc, const float *src, size_t numFrames, int numChannels, const float *gains)
+	{
+		AccumulateF32Ramp_Scalar(acc, src, numFrames, numChannels, gains);
+	}
+
+	void FillLinearRamp(float *gains, size_t n, float start, float step)
+	{
+		FillLinearRamp_Scalar(gains, n, start, step);
+	}
+
+	void FillExponentialRamp(float *gains, size_t n, float start, float factor)
+	{
+		FillExponentialRamp_Scalar(gains, n, start, factor);
+	}
+#endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "framework.h"
+#include "Cpu.h"
+
+namespace sound {
+
+	// The mixer accumulates samples as normalized floats: 1.0 is the full scale
+	// of a 16-bit sample, that is 32768. Sums can go beyond [-1, 1]; they are
+	// only saturated when converted to the output format (see SampleConversion.h).
+
+	// AccumulateS16 adds n 16-bit samples, multiplied by gain, to n accumulated samples.
+	void AccumulateS16(float *acc, const int16_t *src, size_t n, float gain);
+
+	// AccumulateF32 adds n normalized float samples, multiplied by gain, to n accumulated samples.
+	void AccumulateF32(float *acc, const float *src, size_t n, float gain);
+
+	// The Ramp versions multiply each frame by its own gain: gains has numFrames values,
+	// the samples are interleaved frames of numChannels (1 or 2) channels.
+	void AccumulateS16Ramp(float *acc, const int16_t *src, size_t numFrames, int numChannels, const float *gains);
+	void AccumulateF32Ramp(float *acc, const float *src, size_t numFrames, int numChannels, const float *gains);
+
+	// FillLinearRamp sets gains[k] to start + step * (k + 1), for k < n.
+	void FillLinearRamp(float *gains, size_t n, float start, float step);
+
+	// FillExponentialRamp sets gains[k] to start * factor^(k + 1), for k < n.
+	void FillExponentialRamp(float *gains, size_t n, float start, float factor);
+
+	// The scalar versions compute the same results, bit for bit.
+	// They are also used for the samples left after the SIMD loops.
+	void AccumulateS16_Scalar(float *acc, const int16_t *src, size_t n, float gain);
+	void AccumulateF32_Scalar(float *acc, const float *src, size_t n, float gain);
+	void AccumulateS16Ramp_Scalar(float *acc, const int16_t *src, size_t numFrames, int numChannels, const float *gains);
+	void AccumulateF32Ramp_Scalar(float *acc, const float *src, size_t numFrames, int numChannels, const float *gains);
+	void FillLinearRamp_Scalar(float *gains, size_t n, float start, float step);
+	void FillExponentialRamp_Scalar(float *gains, size_t n, float start, float factor);
+}
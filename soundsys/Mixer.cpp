@@ -0,0 +1,249 @@
+#include "pch.h"
+#include "Mixer.h"
+#include "MixKernels.h"
+#include "SampleConversion.h"
+#include <algorithm>
+#include <chrono>
+
+namespace sound {
+
+	// Voices and the output have at most 2 channels.
+	static const size_t kMaxChannels = 2;
+
+	Mixer::Mixer(int numVoices, const WAVEFORMATEX &format, size_t maxFrames, RESAMPLER_QUALITY quality)
+		: m_voices(std::max(numVoices, 1) + 1)
+		, m_format(format)
+		, m_sampleType(SampleTypeOf(format))
+		, m_maxFrames(maxFrames)
+		, m_acc(maxFrames * format.nChannels, 0.f)
+		, m_converted(maxFrames * kMaxChannels, 0.f)
+		, m_remixed(maxFrames * kMaxChannels, 0.f)
+		, m_out(maxFrames * format.nBlockAlign, 0)
+	{
+		assert(numVoices >= 1);
+		assert(IsSupportedFormat(format));
+
+		// The voices are allocated once: the files in the output format play without an allocation.
+		for (auto &voice : m_voices) {
+			voice.SetOutputRate(format.nSamplesPerSec, quality);
+			voice.Reserve(maxFrames, format);
+		}
+	}
+
+	void Mixer::SetAssetPack(const AssetPack *pack)
+	{
+		for (auto &voice : m_voices) {
+			voice.SetAssetPack(pack);
+		}
+	}
+
+	bool Mixer::HasPlayingVoices() const
+	{
+		for (const auto &voice : m_voices) {
+			if (voice.IsPlaying()) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	Voice *Mixer::FindFreeVoice()
+	{
+		for (size_t i = 2; i < m_voices.size(); i++) {
+			if (!m_voices[i].IsPlaying()) {
+				return &m_voices[i];
+			}
+		}
+
+		return nullptr;
+	}
+
+	const byte *Mixer::Mix(size_t size, OUT bool *silent)
+	{
+		assert(size <= ChunkCapacity());
+		assert(size % m_format.nBlockAlign == 0);
+		assert(silent != nullptr);
+
+		// The last chunk of a finished voice was written by now.
+		for (auto &voice : m_voices) {
+			if (voice.IsOpen() && !voice.IsPlaying()) {
+				voice.Close();
+			}
+		}
+
+		const auto numFrames = size / m_format.nBlockAlign;
+		const auto numSamples = numFrames * m_format.nChannels;
+
+		Voice *first = nullptr;
+		int numPlaying = 0;
+		m_readNanoseconds = 0;
+
+		for (auto &voice : m_voices) {
+			if (!voice.IsPlaying() || IsNextMusic(voice)) {
+				continue;
+			}
+
+			ReadVoice(voice, numFrames);
+
+			// The accumulator is only cleared when a second voice shows up,
+			// so that a voice playing alone is not mixed at all.
+			if (numPlaying == 0) {
+				first = &voice;
+			}
+			else {
+				if (numPlaying == 1) {
+					std::fill(m_acc.begin(), m_acc.begin() + numSamples, 0.f);
+					Accumulate(*first, numFrames);
+				}
+				Accumulate(voice, numFrames);
+			}
+
+			numPlaying++;
+		}
+
+		// The next music starts on the frame that follows the end of the current one:
+		// in this chunk if the music ended in it, at the start of the chunk if it ended before.
+		auto &music = MusicVoice();
+		const auto offset = music.IsOpen() ? music.AudioFrames() : 0;
+		if (m_nextQueued && !music.IsPlaying() && offset < numFrames) {
+			SwapMusicVoices();
+			auto &next = MusicVoice();
+			ReadVoice(next, numFrames - offset);
+
+			if (numPlaying == 0) {
+				first = &next;
+			}
+			else {
+				if (numPlaying == 1) {
+					std::fill(m_acc.begin(), m_acc.begin() + numSamples, 0.f);
+					Accumulate(*first, numFrames);
+				}
+				Accumulate(next, numFrames - offset, offset);
+			}
+
+			numPlaying++;
+		}
+
+		*silent = (numPlaying == 0);
+
+		if (numPlaying == 0) {
+			std::fill(m_out.begin(), m_out.begin() + size, (byte)0);
+			return m_out.data();
+		}
+
+		if (numPlaying == 1) {
+			if (!first->Gains() && first->Gain() == 1.f && HasOutputLayout(*first)) {
+				return first->Data().ptr;
+			}
+
+			std::fill(m_acc.begin(), m_acc.begin() + numSamples, 0.f);
+			Accumulate(*first, numFrames);
+		}
+
+		switch (m_sampleType) {
+		case SAMPLE_TYPE_S16: {
+			ConvertF32ToS16(reinterpret_cast<int16_t *>(m_out.data()), m_acc.data(), numSamples);
+		}break;
+
+		case SAMPLE_TYPE_S24: {
+			ConvertF32ToS24(m_out.data(), m_acc.data(), numSamples);
+		}break;
+
+		default: {
+			// Floats are not saturated: the device clips them.
+			return reinterpret_cast<const byte *>(m_acc.data());
+		}break;
+		}
+
+		return m_out.data();
+	}
+
+	void Mixer::StopAll()
+	{
+		for (auto &voice : m_voices) {
+			voice.Close();
+		}
+	}
+
+	void Mixer::ReadVoice(Voice &voice, size_t numFrames)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		// A read error leaves zeros in the chunk: it can be mixed anyway.
+		voice.Read(numFrames);
+
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		m_readNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	}
+
+	void Mixer::Accumulate(const Voice &voice, size_t numFrames, size_t offset)
+	{
+		auto *acc = m_acc.data() + offset * m_format.nChannels;
+
+		const auto &format = voice.Format();
+		const auto *data = voice.Data().ptr;
+		const auto numSamples = numFrames * format.nChannels;
+
+		// The most common case needs no conversion.
+		auto type = SampleTypeOf(format);
+		const auto *gains = voice.Gains();
+		if (type == SAMPLE_TYPE_S16 && format.nChannels == m_format.nChannels) {
+			const auto *src = reinterpret_cast<const int16_t *>(data);
+			if (gains) {
+				AccumulateS16Ramp(acc, src, numFrames, format.nChannels, gains);
+			}
+			else {
+				AccumulateS16(acc, src, numSamples, voice.Gain());
+			}
+			return;
+		}
+
+		// Convert to floats...
+		const float *samples = nullptr;
+		switch (type) {
+		case SAMPLE_TYPE_S16: {
+			ConvertS16ToF32(m_converted.data(), reinterpret_cast<const int16_t *>(data), numSamples);
+			samples = m_converted.data();
+		}break;
+
+		case SAMPLE_TYPE_S24: {
+			ConvertS24ToF32(m_converted.data(), data, numSamples);
+			samples = m_converted.data();
+		}break;
+
+		case SAMPLE_TYPE_F32: {
+			samples = reinterpret_cast<const float *>(data);
+		}break;
+
+		default: {
+			assert(false && "Voices are opened in supported formats only");
+			return;
+		}break;
+		}
+
+		// ... then to the output channels.
+		if (format.nChannels == 1 && m_format.nChannels == 2) {
+			MonoToStereo(m_remixed.data(), samples, numFrames);
+			samples = m_remixed.data();
+		}
+		else if (format.nChannels == 2 && m_format.nChannels == 1) {
+			StereoToMono(m_remixed.data(), samples, numFrames);
+			samples = m_remixed.data();
+		}
+
+		if (gains) {
+			AccumulateF32Ramp(acc, samples, numFrames, m_format.nChannels, gains);
+		}
+		else {
+			AccumulateF32(acc, samples, numFrames * m_format.nChannels, voice.Gain());
+		}
+	}
+
+	bool Mixer::HasOutputLayout(const Voice &voice) const
+	{
+		const auto &format = voice.Format();
+
+		return SampleTypeOf(format) == m_sampleType && format.nChannels == m_format.nChannels;
+	}
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "framework.h"
+#include <vector>
+
+#include "AudioFormat.h"
+#include "Voice.h"
+
+namespace sound {
+
+	// CLASS:		Mixer
+	//
+	// PURPOSE:		Sums a fixed number of voices into chunks of the output format.
+	//				The music has two voices: the current music and either, during a
+	//				crossfade, the previous music fading out, or the next music queued.
+	//				The next music starts on the frame where the current one ends,
+	//				in the same chunk. The other voices play one-shot sounds.
+	//				Voices are converted to the sample type and the channels of the
+	//				output, and resampled to its sample rate.
+	//
+	//				All the memory is allocated by the constructor: mixing a chunk
+	//				allocates nothing, whatever the number of voices playing.
+	//				When a single voice plays at full gain in the output format,
+	//				its data is handed out as is, without being mixed.
+	//
+	class Mixer {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(Mixer);
+
+		// INPUT
+		//	numVoices:		number of voices, including the music voice. At least 1.
+		//					The voice of the music fading out comes on top of them.
+		//	format:			output format. It must be supported (see IsSupportedFormat).
+		//	maxFrames:		number of frames of the largest chunk that Mix will be asked.
+		//	quality:		quality of the resampling of the voices not at the output rate.
+		//
+		Mixer(int numVoices, const WAVEFORMATEX &format, size_t maxFrames, RESAMPLER_QUALITY quality = RESAMPLER_QUALITY_MEDIUM);
+
+		//				ACCESSORS
+		//
+
+		int NumVoices() const { return static_cast<int>(m_voices.size()); }
+
+		const WAVEFORMATEX &Format() const { return m_format; }
+
+		size_t MaxFrames() const { return m_maxFrames; }
+
+		// ChunkCapacity returns the size in bytes of the largest chunk.
+		size_t ChunkCapacity() const { return m_maxFrames * m_format.nBlockAlign; }
+
+		// HasPlayingVoices returns true iff at least one voice has data left to mix.
+		bool HasPlayingVoices() const;
+
+		// ReadNanoseconds returns the time the voices spent reading their files
+		// during the last call to Mix.
+		uint64_t ReadNanoseconds() const { return m_readNanoseconds; }
+
+		//				MANIPULATORS
+		//
+
+		Voice &MusicVoice() { return m_voices[m_music]; }
+
+		// FadingMusicVoice returns the voice that plays the previous music during a crossfade.
+		Voice &FadingMusicVoice() { return m_voices[1 - m_music]; }
+
+		// NextMusicVoice returns the voice where the next music is opened before it is queued.
+		// It is the voice of the fading music: a crossfade and a queued music exclude each other.
+		Voice &NextMusicVoice() { return FadingMusicVoice(); }
+
+		// SwapMusicVoices makes the current music the fading one, and the other voice
+		// the one of the next music.
+		void SwapMusicVoices() { m_music = 1 - m_music; m_nextQueued = false; }
+
+		// QueueNextMusic makes the music opened in NextMusicVoice start when the current one ends.
+		// It is not mixed until then.
+		void QueueNextMusic() { m_nextQueued = true; }
+
+		// SetAssetPack makes all the voices look the files up in the pack first (see Voice).
+		void SetAssetPack(const AssetPack *pack);
+
+		// StopOtherMusic closes the music fading out or the next music queued, if any.
+		void StopOtherMusic() { FadingMusicVoice().Close(); m_nextQueued = false; }
+
+		// FindFreeVoice returns a sound voice that is not playing, or nullptr if they all are.
+		Voice *FindFreeVoice();
+
+		// Mix reads the next frames of every playing voice and sums them.
+		// Voices that finished during the previous call are closed first.
+		//
+		// PRECONDITIONS
+		//	size <= ChunkCapacity() and size is a whole number of output frames.
+		//
+		// OUTPUT
+		//	silent:		true iff no voice was playing. The chunk is then filled with zeros.
+		//
+		// RETURN VALUE
+		//	The address of size bytes of mixed audio in the output format.
+		//	It is valid until the next call to Mix or StopAll.
+		//
+		const byte *Mix(size_t size, OUT bool *silent);
+
+		// StopAll closes all the voices.
+		void StopAll();
+
+	private:
+		// ReadVoice reads the next frames of a voice and adds the time it took to m_readNanoseconds.
+		void ReadVoice(Voice &voice, size_t numFrames);
+
+		// Accumulate adds the chunk just read by the voice to the sum, from the frame offset on.
+		void Accumulate(const Voice &voice, size_t numFrames, size_t offset = 0);
+
+		// IsNextMusic returns true iff the voice holds the next music, waiting for the current one to end.
+		bool IsNextMusic(const Voice &voice) const { return m_nextQueued && &voice == &m_voices[1 - m_music]; }
+
+		// HasOutputLayout returns true iff the voice data is in the output format.
+		bool HasOutputLayout(const Voice &voice) const;
+
+	private:
+		// Voices 0 and 1 are the music voices, the next ones play sounds.
+		std::vector<Voice>		m_voices;
+		int						m_music{ 0 };
+		bool					m_nextQueued{ false };
+
+		WAVEFORMATEX			m_format;
+		SAMPLE_TYPE				m_sampleType;
+		size_t					m_maxFrames;
+
+		// Sum of the voices, in normalized floats and output channels.
+		std::vector<float>		m_acc;
+
+		// A voice converted to floats, then to the output channels.
+		std::vector<float>		m_converted;
+		std::vector<float>		m_remixed;
+
+		// The sum converted to the output sample type.
+		std::vector<byte>		m_out;
+
+		uint64_t				m_readNanoseconds{ 0 };
+	};
+}
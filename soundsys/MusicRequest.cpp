@@ -1,2 +1,68 @@
 #include "pch.h"
 #include "MusicRequest.h"
+
+namespace sound {
+
+	// Supersedes returns true iff the request later makes the request earlier pointless.
+	static bool Supersedes(const MusicRequest &later, const MusicRequest &earlier)
+	{
+		switch (later.type) {
+		case MUSIC_REQUEST_TYPE_PLAY: {
+			// The music is stopped first: whatever happened to it before does not matter.
+			// The new music is heard: a pause ends.
+			// A crossfade starts from the current music: it must not bring back a stopped one.
+			return earlier.type == MUSIC_REQUEST_TYPE_PLAY
+				|| earlier.type == MUSIC_REQUEST_TYPE_PLAY_NEXT
+				|| earlier.type == MUSIC_REQUEST_TYPE_PAUSE
+				|| earlier.type == MUSIC_REQUEST_TYPE_RESUME
+				|| (earlier.type == MUSIC_REQUEST_TYPE_STOP && later.fadeMs == 0);
+		}
+
+		case MUSIC_REQUEST_TYPE_STOP: {
+			// A pause also freezes the sounds, which a stop leaves playing.
+			return earlier.type == MUSIC_REQUEST_TYPE_PLAY
+				|| earlier.type == MUSIC_REQUEST_TYPE_PLAY_NEXT
+				|| earlier.type == MUSIC_REQUEST_TYPE_STOP;
+		}
+
+		case MUSIC_REQUEST_TYPE_PLAY_NEXT: {
+			// Only one music is queued at a time.
+			return earlier.type == MUSIC_REQUEST_TYPE_PLAY_NEXT;
+		}
+
+		case MUSIC_REQUEST_TYPE_PAUSE:
+		case MUSIC_REQUEST_TYPE_RESUME: {
+			// Only the last one tells whether the output is paused.
+			return earlier.type == MUSIC_REQUEST_TYPE_PAUSE
+				|| earlier.type == MUSIC_REQUEST_TYPE_RESUME;
+		}
+
+		case MUSIC_REQUEST_TYPE_PLAY_SOUND: {
+			// Sounds overlap each other: none makes another pointless.
+			return false;
+		}
+		}
+
+		return false;
+	}
+
+	size_t CoalesceMusicRequests(MusicRequest *reqs, size_t count)
+	{
+		assert(reqs != nullptr || count == 0);
+
+		size_t numKept = 0;
+
+		for (size_t i = 0; i < count; i++) {
+			auto superseded = false;
+			for (size_t j = i + 1; j < count && !superseded; j++) {
+				superseded = Supersedes(reqs[j], reqs[i]);
+			}
+
+			if (!superseded) {
+				reqs[numKept++] = reqs[i];
+			}
+		}
+
+		return numKept;
+	}
+}
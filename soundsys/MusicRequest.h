@@ -1,31 +1,102 @@
 #pragma once
 
+#include <cstddef>
+#include "AssetRegistry.h"
+#include "GainRamp.h"
+
 namespace sound {
 
 	enum MUSIC_REQUEST_TYPE {
 		MUSIC_REQUEST_TYPE_PLAY,
+
+		// Queues a music to play right after the current one.
+		MUSIC_REQUEST_TYPE_PLAY_NEXT,
+
+		// Freezes the whole output, music and sounds, where it is.
 		MUSIC_REQUEST_TYPE_PAUSE,
-		MUSIC_REQUEST_TYPE_STOP
+		MUSIC_REQUEST_TYPE_STOP,
+
+		// Plays a one-shot sound over the music.
+		MUSIC_REQUEST_TYPE_PLAY_SOUND,
+
+		// Plays the output frozen by a PAUSE from where it stopped.
+		MUSIC_REQUEST_TYPE_RESUME
 	};
 
 	struct MusicRequest {
 		MUSIC_REQUEST_TYPE	type;
 
-		const char	*filename;
+		// PLAY, PLAY_NEXT, PLAY_SOUND: the asset played. A request is a plain value:
+		// it holds no string, and copying it allocates nothing.
+		AssetHandle	asset;
+
+		// PLAY: duration of the crossfade from the current music to the new one.
+		// Zero cuts the current music.
+		DWORD		fadeMs;
+		FADE_CURVE	fadeCurve;
+
+		// PLAY, PLAY_NEXT: the music loops from loopEnd back to loopStart, in frames.
+		// If loopEnd == 0, the music does not loop.
+		DWORD		loopStart;
+		DWORD		loopEnd;
 	};
 
-	static MusicRequest MakeMusicRequest_Play(const char *filename)
+	inline MusicRequest MakeMusicRequest_Play(AssetHandle asset)
+	{
+		return MusicRequest{ MUSIC_REQUEST_TYPE_PLAY, asset, 0, FADE_CURVE_LINEAR, 0, 0 };
+	}
+
+	inline MusicRequest MakeMusicRequest_PlayCrossfade(AssetHandle asset, DWORD fadeMs, FADE_CURVE curve)
 	{
-		return MusicRequest{ MUSIC_REQUEST_TYPE_PLAY, filename };
+		return MusicRequest{ MUSIC_REQUEST_TYPE_PLAY, asset, fadeMs, curve, 0, 0 };
 	}
 
-	static MusicRequest MakeMusicRequest_Pause()
+	inline MusicRequest MakeMusicRequest_PlayLooped(AssetHandle asset, DWORD loopStart, DWORD loopEnd)
 	{
-		return MusicRequest{ MUSIC_REQUEST_TYPE_PAUSE, "" };
+		return MusicRequest{ MUSIC_REQUEST_TYPE_PLAY, asset, 0, FADE_CURVE_LINEAR, loopStart, loopEnd };
 	}
 
-	static MusicRequest MakeMusicRequest_Stop()
+	inline MusicRequest MakeMusicRequest_PlayNext(AssetHandle asset)
 	{
-		return MusicRequest{ MUSIC_REQUEST_TYPE_STOP, "" };
+		return MusicRequest{ MUSIC_REQUEST_TYPE_PLAY_NEXT, asset, 0, FADE_CURVE_LINEAR, 0, 0 };
 	}
+
+	inline MusicRequest MakeMusicRequest_Pause()
+	{
+		return MusicRequest{ MUSIC_REQUEST_TYPE_PAUSE, kInvalidAssetHandle, 0, FADE_CURVE_LINEAR, 0, 0 };
+	}
+
+	inline MusicRequest MakeMusicRequest_Stop()
+	{
+		return MusicRequest{ MUSIC_REQUEST_TYPE_STOP, kInvalidAssetHandle, 0, FADE_CURVE_LINEAR, 0, 0 };
+	}
+
+	inline MusicRequest MakeMusicRequest_PlaySound(AssetHandle asset)
+	{
+		return MusicRequest{ MUSIC_REQUEST_TYPE_PLAY_SOUND, asset, 0, FADE_CURVE_LINEAR, 0, 0 };
+	}
+
+	inline MusicRequest MakeMusicRequest_Resume()
+	{
+		return MusicRequest{ MUSIC_REQUEST_TYPE_RESUME, kInvalidAssetHandle, 0, FADE_CURVE_LINEAR, 0, 0 };
+	}
+
+	// CoalesceMusicRequests removes from a batch of requests the ones that are made
+	// pointless by a later request of the same batch. The others keep their order.
+	// EXAMPLES
+	//	PLAY a, PLAY b, PLAY c	->	PLAY c
+	//	PLAY a, STOP			->	STOP
+	//	STOP, PLAY a			->	PLAY a
+	//	STOP, PLAY a with a crossfade	->	STOP, PLAY a		(nothing to fade from)
+	//	PLAY a, PLAY_NEXT b		->	PLAY a, PLAY_NEXT b
+	//	PLAY_NEXT a, PLAY_NEXT b	->	PLAY_NEXT b
+	//	PLAY_SOUND a, STOP		->	PLAY_SOUND a, STOP	(sounds are not music)
+	//	PAUSE, RESUME, PAUSE		->	PAUSE
+	//	PAUSE, PLAY a			->	PLAY a			(a new music ends the pause)
+	//	PAUSE, STOP			->	PAUSE, STOP		(the sounds stay paused)
+	//
+	// RETURN VALUE
+	//	The number of requests left at the beginning of the array.
+	//
+	size_t CoalesceMusicRequests(MusicRequest *reqs, size_t count);
 }
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "framework.h"
+#include <array>
+#include <vector>
+
+namespace sound {
+
+	// Timeout value to wait without time limit. Same value as the Windows INFINITE constant.
+	const DWORD kWaitForever = 0xFFFFFFFF;
+
+	// A span of memory inside the buffer of an output device.
+	struct MemorySpan {
+		LPVOID	begin{ nullptr };
+		DWORD	length{ 0 };
+	};
+
+	// DeviceMemoryRegion is the memory returned when locking a span of a device buffer.
+	// Because the buffer is circular, the locked span may wrap around its end:
+	// in that case the second part is not empty.
+	struct DeviceMemoryRegion {
+		std::array<MemorySpan, 2>	span;
+	};
+
+	// CLASS:		OutputDevice
+	//
+	// PURPOSE:		Interface to the circular audio buffer that a StreamingBuffer fills.
+	//				A device owns the buffer memory, moves a play cursor over it in a loop
+	//				and signals when the cursor reaches one of the notification offsets.
+	//
+	class OutputDevice {
+	public:
+		virtual ~OutputDevice() {}
+
+		//				MANIPULATORS
+		//
+
+		// CreateBuffer creates the looping buffer.
+		// It must be called once before any other function.
+		// Throws if an error occured.
+		//
+		// INPUT
+		//	format:			format of the audio data written in the buffer.
+		//	capacity:		size of the buffer in bytes.
+		//	notifyOffsets:	byte offsets that are signaled when the play cursor reaches them.
+		//
+		virtual void CreateBuffer(const WAVEFORMATEX &format, DWORD capacity, const std::vector<DWORD> &notifyOffsets) = 0;
+
+		// Play moves the play cursor to the beginning of the buffer and starts to play it in a loop.
+		virtual void Play() = 0;
+
+		// Stop stops the play cursor.
+		virtual void Stop() = 0;
+
+		// Resume starts to play the buffer in a loop from the play cursor, where Stop left it.
+		virtual void Resume() = 0;
+
+		// WaitForNotification waits up to timeoutMs milliseconds for the play cursor
+		// to reach a notification offset. timeoutMs can be kWaitForever.
+		// Returns true iff an offset was reached. In that case *pos is the index of the offset
+		// in the notifyOffsets vector given to CreateBuffer.
+		// Returns false on timeout or if the wait was interrupted.
+		virtual bool WaitForNotification(DWORD timeoutMs, int *pos) = 0;
+
+		// Interrupt wakes up the thread waiting in WaitForNotification, or makes its next
+		// call return immediately if no thread is waiting.
+		// Unlike the other functions, it can be called from any thread.
+		virtual void Interrupt() = 0;
+
+		// Lock gives access to size bytes of the buffer starting at offset.
+		// Every successful call must be matched by a call to Unlock.
+		virtual Error Lock(DWORD offset, DWORD size, DeviceMemoryRegion *memory) = 0;
+
+		virtual Error Unlock(const DeviceMemoryRegion &memory) = 0;
+
+		//				ACCESSORS
+		//
+
+		// PlayCursor returns the byte offset of the play cursor in the buffer.
+		virtual DWORD PlayCursor() = 0;
+	};
+}
@@ -0,0 +1,197 @@
+#include "pch.h"
+#include "ReadAheadQueue.h"
+#include <algorithm>
+#include <chrono>
+
+namespace sound {
+
+	ReadAheadQueue::ReadAheadQueue()
+	{
+		// Start the thread last: it uses all the members above.
+		m_thread = std::thread(&ReadAheadQueue::IOProcedure, this);
+	}
+
+	ReadAheadQueue::ReadAheadQueue(ByteSource *source, size_t firstChunkSize, size_t chunkSize, int numChunks)
+		: ReadAheadQueue()
+	{
+		Start(source, firstChunkSize, chunkSize, numChunks);
+	}
+
+	ReadAheadQueue::~ReadAheadQueue()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_chunkFree.notify_one();
+
+		m_thread.join();
+	}
+
+	void ReadAheadQueue::Start(ByteSource *source, size_t firstChunkSize, size_t chunkSize, int numChunks)
+	{
+		assert(!m_reading);
+		assert(source != nullptr);
+		assert(firstChunkSize >= 1 && chunkSize >= 1);
+		assert(numChunks >= 1);
+
+		{
+			// The I/O thread is waiting for a source: the members are not shared until m_reading is set.
+			std::lock_guard<std::mutex> lock(m_mutex);
+			assert(!m_busy);
+
+			m_source = source;
+			m_firstChunkSize = firstChunkSize;
+			m_chunkSize = chunkSize;
+
+			m_numChunks = static_cast<size_t>(numChunks);
+			if (m_chunks.size() < m_numChunks) {
+				m_chunks.resize(m_numChunks);
+			}
+
+			// Within their capacity, the chunks are resized without an allocation.
+			for (size_t i = 0; i < m_numChunks; i++) {
+				m_chunks[i].data.assign(std::max(firstChunkSize, chunkSize), 0);
+			}
+
+			m_produced.store(0, std::memory_order_relaxed);
+			m_consumed.store(0, std::memory_order_relaxed);
+			m_stats = ReadStats{};
+
+			m_reading = true;
+			m_generation++;
+		}
+		m_chunkFree.notify_one();
+	}
+
+	void ReadAheadQueue::Stop()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (!m_reading) {
+				return;
+			}
+
+			m_reading = false;
+			m_chunkFree.notify_one();
+
+			// The source must not be read anymore once Stop returns.
+			m_sourceDone.wait(lock, [this]() { return !m_busy; });
+		}
+
+		m_source = nullptr;
+	}
+
+	const ReadAheadQueue::Chunk &ReadAheadQueue::Front()
+	{
+		const auto i = m_consumed.load(std::memory_order_relaxed);
+
+		if (m_produced.load(std::memory_order_acquire) <= i) {
+			// Stall: the I/O thread is late.
+			auto start = std::chrono::steady_clock::now();
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_chunkReady.wait(lock, [this, i]() {
+					return m_produced.load(std::memory_order_acquire) > i;
+				});
+			}
+			auto ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start
+			).count());
+
+			m_stats.numStalls++;
+			m_stats.stallNanoseconds += ns;
+			m_stats.maxStallNanoseconds = std::max(m_stats.maxStallNanoseconds, ns);
+		}
+
+		m_stats.numChunks++;
+		return m_chunks[i % m_numChunks];
+	}
+
+	void ReadAheadQueue::PopFront()
+	{
+		assert(m_consumed.load() < m_produced.load());
+
+		// Taking the lock avoids a lost wake-up if the I/O thread is about to wait.
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_consumed.fetch_add(1, std::memory_order_release);
+		}
+		m_chunkFree.notify_one();
+	}
+
+	void ReadAheadQueue::IOProcedure()
+	{
+		uint64_t generation = 0;
+
+		for (;;) {
+			// Wait for a source that was not read yet.
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_chunkFree.wait(lock, [this, generation]() {
+					return m_quit || (m_reading && m_generation != generation);
+				});
+
+				if (m_quit) {
+					return;
+				}
+
+				generation = m_generation;
+				m_busy = true;
+			}
+
+			ReadSource();
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_busy = false;
+			}
+			m_sourceDone.notify_one();
+		}
+	}
+
+	void ReadAheadQueue::ReadSource()
+	{
+		const auto N = m_numChunks;
+
+		for (uint64_t i = 0; ; i++) {
+			// Wait for a free chunk.
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_chunkFree.wait(lock, [this, i, N]() {
+					return m_quit || !m_reading || i - m_consumed.load(std::memory_order_acquire) < N;
+				});
+
+				if (m_quit || !m_reading) {
+					return;
+				}
+			}
+
+			auto &chunk = m_chunks[i % N];
+			auto more = ReadChunk(&chunk, (i == 0) ? m_firstChunkSize : m_chunkSize);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_produced.store(i + 1, std::memory_order_release);
+			}
+			m_chunkReady.notify_one();
+
+			if (!more) {
+				return;
+			}
+		}
+	}
+
+	bool ReadAheadQueue::ReadChunk(Chunk *chunk, size_t size)
+	{
+		chunk->size = m_source->Read(chunk->data.data(), size);
+
+		// Pad with zeros so that the whole capacity of the chunk can be used as is.
+		std::fill(chunk->data.begin() + chunk->size, chunk->data.end(), (byte)0);
+
+		chunk->failure = m_source->Failure();
+		chunk->eof = !chunk->failure && chunk->size < size;
+
+		return !chunk->eof && !chunk->failure;
+	}
+}
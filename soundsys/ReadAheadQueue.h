@@ -0,0 +1,132 @@
+#pragma once
+
+#include "framework.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ByteSource.h"
+
+namespace sound {
+
+	// ReadStats counts how often the consumer of a read-ahead queue had to wait
+	// for the I/O worker.
+	struct ReadStats {
+		uint64_t	numChunks{ 0 };				// chunks delivered to the consumer
+		uint64_t	numStalls{ 0 };				// chunks that were not ready when asked for
+		uint64_t	stallNanoseconds{ 0 };		// total time spent waiting for them
+		uint64_t	maxStallNanoseconds{ 0 };	// longest single wait
+	};
+
+	// CLASS:		ReadAheadQueue
+	//
+	// PURPOSE:		Reads a source into a ring of chunks from a background I/O thread,
+	//				ahead of the consumer.
+	//				The first chunk can have a different size from the following ones.
+	//				The chunk that reaches EOF holds fewer bytes than asked and is followed by zeros.
+	//
+	//				The queue reads one source after another: the I/O thread waits between
+	//				them, and the chunks keep their memory. Reading a source no larger
+	//				than the previous ones neither allocates nor creates a thread.
+	//
+	class ReadAheadQueue {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(ReadAheadQueue);
+
+		struct Chunk {
+			std::vector<byte>	data;			// capacity of the largest chunk, zero padded
+			size_t				size{ 0 };		// number of bytes read from the source
+			bool				eof{ false };	// the source ended in this chunk
+			bool				failure{ false };	// an error occured while reading this chunk
+		};
+
+		// The constructor starts the I/O thread, which waits for a source.
+		// Throws if the thread cannot be created.
+		ReadAheadQueue();
+
+		// This constructor starts reading a source right away (see Start).
+		ReadAheadQueue(ByteSource *source, size_t firstChunkSize, size_t chunkSize, int numChunks);
+
+		// The destructor stops the I/O thread.
+		~ReadAheadQueue();
+
+		// IsReading returns true iff a source was started and not stopped.
+		bool IsReading() const { return m_reading; }
+
+		// Start makes the I/O thread read a source.
+		// The chunks only grow: it allocates only if they are larger or more than before.
+		//
+		// PRECONDITIONS
+		//	!IsReading()
+		//	source stays valid until Stop, and nothing else reads it meanwhile.
+		//	numChunks >= 1
+		//
+		void Start(ByteSource *source, size_t firstChunkSize, size_t chunkSize, int numChunks);
+
+		// Stop waits for the I/O thread to be done with the source, and forgets it.
+		// It does nothing if no source is read.
+		void Stop();
+
+		// Front returns the oldest chunk that was not popped.
+		// It waits for the I/O thread if the chunk is not ready yet and records the stall.
+		//
+		// PRECONDITIONS
+		//	IsReading()
+		//	The chunk that reached EOF or failed was not popped.
+		const Chunk &Front();
+
+		// PopFront gives the oldest chunk back to the I/O thread.
+		void PopFront();
+
+		// Stats returns the stalls of the source being read.
+		const ReadStats &Stats() const { return m_stats; }
+
+	private:
+		// IOProcedure is the body of the I/O thread.
+		void IOProcedure();
+
+		// ReadSource reads the chunks of the current source until its end, or until Stop.
+		void ReadSource();
+
+		// ReadChunk fills a chunk with the next bytes of the source.
+		// Returns false iff the source cannot provide more chunks.
+		bool ReadChunk(Chunk *chunk, size_t size);
+
+	private:
+		ByteSource				*m_source{ nullptr };
+		size_t					m_firstChunkSize{ 0 };
+		size_t					m_chunkSize{ 0 };
+
+		// Only the first m_numChunks chunks are used by the current source.
+		std::vector<Chunk>		m_chunks;
+		size_t					m_numChunks{ 0 };
+
+		// Number of chunks filled by the I/O thread and popped by the consumer.
+		// The chunk i is stored at m_chunks[i % m_numChunks].
+		std::atomic<uint64_t>	m_produced{ 0 };
+		std::atomic<uint64_t>	m_consumed{ 0 };
+
+		std::mutex				m_mutex;
+		std::condition_variable	m_chunkReady;
+
+		// The I/O thread waits on it for a free chunk, and for a source between two.
+		std::condition_variable	m_chunkFree;
+
+		// Signaled when the I/O thread is done with a source.
+		std::condition_variable	m_sourceDone;
+
+		bool					m_quit{ false };
+
+		// m_reading is set from Start to Stop. Each Start is a new generation, and the I/O
+		// thread is busy while it reads the source of a generation.
+		bool					m_reading{ false };
+		uint64_t				m_generation{ 0 };
+		bool					m_busy{ false };
+
+		ReadStats				m_stats;
+
+		std::thread				m_thread;
+	};
+}
@@ -0,0 +1,238 @@
+#include "pch.h"
+#include "Resampler.h"
+#include "SampleConversion.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef SOUND_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace sound {
+
+	static const double kPi = 3.14159265358979323846;
+
+	// Frequencies above cutoff * Nyquist are attenuated. Longer filters have a
+	// sharper transition band, so they can keep more of the spectrum.
+	struct QualityPreset {
+		int		numTaps;
+		int		phaseBits;
+		double	cutoff;
+	};
+
+	static const QualityPreset kPresets[] = {
+		{ 8, 6, 0.80 },		// RESAMPLER_QUALITY_LOW
+		{ 16, 8, 0.90 },	// RESAMPLER_QUALITY_MEDIUM
+		{ 32, 10, 0.95 }	// RESAMPLER_QUALITY_HIGH
+	};
+	static const int kMaxTaps = 32;
+
+	static double Sinc(double x)
+	{
+		return (x == 0.) ? 1. : std::sin(kPi * x) / (kPi * x);
+	}
+
+	// Blackman window over [-1, 1].
+	static double Blackman(double x)
+	{
+		return 0.42 + 0.5 * std::cos(kPi * x) + 0.08 * std::cos(2. * kPi * x);
+	}
+
+
+	//					KERNELS
+	//
+	// The number of taps is a multiple of 4.
+	// The scalar dot product adds the products in 4 partial sums, in the order of
+	// the SSE2 lanes: both versions compute the same results, bit for bit.
+
+#ifdef SOUND_HAS_SSE2
+	static void InterpolateCoefs(float *coefs, const float *row0, const float *row1, float t, int numTaps)
+	{
+		const auto vt = _mm_set1_ps(t);
+
+		for (int k = 0; k < numTaps; k += 4) {
+			auto r0 = _mm_loadu_ps(row0 + k);
+			auto r1 = _mm_loadu_ps(row1 + k);
+			_mm_storeu_ps(coefs + k, _mm_add_ps(r0, _mm_mul_ps(_mm_sub_ps(r1, r0), vt)));
+		}
+	}
+
+	static float Dot(const float *coefs, const float *x, int numTaps)
+	{
+		auto s = _mm_setzero_ps();
+		for (int k = 0; k < numTaps; k += 4) {
+			s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(coefs + k), _mm_loadu_ps(x + k)));
+		}
+
+		// (s0 + s2) + (s1 + s3)
+		s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+		s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+		return _mm_cvtss_f32(s);
+	}
+#else
+	static void InterpolateCoefs(float *coefs, const float *row0, const float *row1, float t, int numTaps)
+	{
+		for (int k = 0; k < numTaps; k++) {
+			coefs[k] = row0[k] + (row1[k] - row0[k]) * t;
+		}
+	}
+
+	static float Dot(const float *coefs, const float *x, int numTaps)
+	{
+		float s[4] = { 0.f, 0.f, 0.f, 0.f };
+		for (int k = 0; k < numTaps; k += 4) {
+			s[0] = s[0] + coefs[k] * x[k];
+			s[1] = s[1] + coefs[k + 1] * x[k + 1];
+			s[2] = s[2] + coefs[k + 2] * x[k + 2];
+			s[3] = s[3] + coefs[k + 3] * x[k + 3];
+		}
+
+		return (s[0] + s[2]) + (s[1] + s[3]);
+	}
+#endif
+
+
+	//					RESAMPLER
+	//
+
+	void Resampler::Init(DWORD inRate, DWORD outRate, int numChannels, RESAMPLER_QUALITY quality, size_t maxOutFrames)
+	{
+		assert(inRate >= 1 && outRate >= 1);
+		assert(numChannels == 1 || numChannels == 2);
+		assert(0 <= quality && quality <= RESAMPLER_QUALITY_HIGH);
+
+		const auto &preset = kPresets[quality];
+
+		m_inRate = inRate;
+		m_outRate = outRate;
+		m_numChannels = numChannels;
+		m_numTaps = preset.numTaps;
+		m_phaseBits = preset.phaseBits;
+
+		// When the rate goes down, the filter also removes what the output cannot represent.
+		// A voice reopened at the same rates keeps its table.
+		auto cutoff = preset.cutoff * std::min(1., static_cast<double>(outRate) / inRate);
+		if (cutoff != m_cutoff || m_table.size() != static_cast<size_t>((1 << m_phaseBits) + 1) * m_numTaps) {
+			CreateTable(cutoff);
+		}
+		m_coefs.assign(m_numTaps, 0.f);
+
+		m_step = (static_cast<uint64_t>(inRate) << 32) / outRate;
+		m_pos = 0;
+
+		// The output frame at position p needs the input frames from p - numTaps / 2 + 1
+		// to p + numTaps / 2. Before the first frame of the stream there is silence.
+		m_maxInFrames = static_cast<size_t>((maxOutFrames * m_step) >> 32) + m_numTaps + 1;
+		m_numBuffered = m_numTaps / 2 - 1;
+		for (int c = 0; c < m_numChannels; c++) {
+			m_history[c].assign(m_maxInFrames, 0.f);
+		}
+	}
+
+	void Resampler::CreateTable(double cutoff)
+	{
+		const int numPhases = 1 << m_phaseBits;
+		const auto halfTaps = m_numTaps / 2;
+		assert(m_numTaps <= kMaxTaps);
+
+		m_cutoff = cutoff;
+
+		m_table.assign(static_cast<size_t>(numPhases + 1) * m_numTaps, 0.f);
+
+		for (int phase = 0; phase <= numPhases; phase++) {
+			const auto frac = static_cast<double>(phase) / numPhases;
+			auto *row = &m_table[static_cast<size_t>(phase) * m_numTaps];
+
+			// Tap k multiplies the input frame at distance k - halfTaps + 1 - frac
+			// from the output frame.
+			double sum = 0.;
+			double h[kMaxTaps];
+			for (int k = 0; k < m_numTaps; k++) {
+				auto x = k - halfTaps + 1 - frac;
+				h[k] = cutoff * Sinc(cutoff * x) * Blackman(x / halfTaps);
+				sum += h[k];
+			}
+
+			// A constant signal keeps its level.
+			for (int k = 0; k < m_numTaps; k++) {
+				row[k] = static_cast<float>(h[k] / sum);
+			}
+		}
+	}
+
+	size_t Resampler::InputFramesNeeded(size_t numOutFrames) const
+	{
+		if (numOutFrames == 0) {
+			return 0;
+		}
+
+		auto lastPos = m_pos + (numOutFrames - 1) * m_step;
+		auto numFrames = static_cast<size_t>(lastPos >> 32) + m_numTaps;
+
+		return (numFrames > m_numBuffered) ? numFrames - m_numBuffered : 0;
+	}
+
+	size_t Resampler::OutputFramesBefore(size_t numInFrames, size_t numOutFrames) const
+	{
+		// The output frame at position p is before the end iff the input frame
+		// p + numTaps / 2 - 1 is, where the end is after the history and the chunk.
+		auto end = static_cast<uint64_t>(m_numBuffered + numInFrames);
+		auto offset = static_cast<uint64_t>(m_numTaps / 2 - 1);
+		if (end <= offset) {
+			return 0;
+		}
+
+		auto limit = (end - offset) << 32;
+		if (m_pos >= limit) {
+			return 0;
+		}
+
+		auto numFrames = static_cast<size_t>((limit - m_pos + m_step - 1) / m_step);
+		return std::min(numFrames, numOutFrames);
+	}
+
+	void Resampler::Process(const float *in, size_t numInFrames, float *out, size_t numOutFrames)
+	{
+		assert(numInFrames == InputFramesNeeded(numOutFrames));
+		assert(m_numBuffered + numInFrames <= m_maxInFrames);
+
+		// Append the chunk to the history.
+		if (m_numChannels == 1) {
+			std::memcpy(m_history[0].data() + m_numBuffered, in, numInFrames * sizeof(float));
+		}
+		else {
+			Deinterleave(m_history[0].data() + m_numBuffered, m_history[1].data() + m_numBuffered, in, numInFrames);
+		}
+		const auto numFrames = m_numBuffered + numInFrames;
+
+		const auto fracBits = 32 - m_phaseBits;
+		const auto fracMask = (static_cast<uint64_t>(1) << fracBits) - 1;
+		const auto fracScale = 1.f / static_cast<float>(static_cast<uint64_t>(1) << fracBits);
+
+		for (size_t n = 0; n < numOutFrames; n++) {
+			const auto first = static_cast<size_t>(m_pos >> 32);
+			const auto frac = m_pos & 0xFFFFFFFFull;
+			const auto phase = static_cast<size_t>(frac >> fracBits);
+			const auto t = static_cast<float>(frac & fracMask) * fracScale;
+
+			const auto *row0 = &m_table[phase * m_numTaps];
+			InterpolateCoefs(m_coefs.data(), row0, row0 + m_numTaps, t, m_numTaps);
+
+			for (int c = 0; c < m_numChannels; c++) {
+				out[n * m_numChannels + c] = Dot(m_coefs.data(), m_history[c].data() + first, m_numTaps);
+			}
+
+			m_pos += m_step;
+		}
+
+		// Forget the frames that no output frame needs anymore.
+		auto consumed = std::min(static_cast<size_t>(m_pos >> 32), numFrames);
+		for (int c = 0; c < m_numChannels; c++) {
+			auto *history = m_history[c].data();
+			std::memmove(history, history + consumed, (numFrames - consumed) * sizeof(float));
+		}
+		m_numBuffered = numFrames - consumed;
+		m_pos -= static_cast<uint64_t>(consumed) << 32;
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "framework.h"
+#include <vector>
+
+namespace sound {
+
+	// Trade-offs between cost and quality of a Resampler.
+	enum RESAMPLER_QUALITY {
+		RESAMPLER_QUALITY_LOW,		// 8 taps, audible aliasing on bright sounds
+		RESAMPLER_QUALITY_MEDIUM,	// 16 taps
+		RESAMPLER_QUALITY_HIGH		// 32 taps
+	};
+
+	// CLASS:		Resampler
+	//
+	// PURPOSE:		Converts the sample rate of a stream of float frames, chunk by chunk,
+	//				with a windowed-sinc filter.
+	//				The filter is stored as a table of phases: the coefficients for a
+	//				position between two input frames are interpolated between the two
+	//				nearest phases.
+	//				The last input frames are kept between chunks, so that a stream cut
+	//				in chunks gives the same output as in one piece.
+	//
+	//				Output frame n is input frame n * inRate / outRate:
+	//				the resampler adds no delay.
+	//
+	class Resampler {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(Resampler);
+
+		Resampler() {}
+
+		//				ACCESSORS
+		//
+
+		DWORD InputRate() const { return m_inRate; }
+
+		DWORD OutputRate() const { return m_outRate; }
+
+		int NumChannels() const { return m_numChannels; }
+
+		int NumTaps() const { return m_numTaps; }
+
+		// InputFramesNeeded returns the number of input frames that Process needs
+		// to produce numOutFrames frames, given the frames it kept from the previous chunks.
+		size_t InputFramesNeeded(size_t numOutFrames) const;
+
+		// OutputFramesBefore returns how many of the next numOutFrames frames are before
+		// the end of the stream, if the stream ends after the first numInFrames frames
+		// of the next chunk.
+		size_t OutputFramesBefore(size_t numInFrames, size_t numOutFrames) const;
+
+		// MaxInputFrames returns the largest number of input frames that Process can be given.
+		size_t MaxInputFrames() const { return m_maxInFrames; }
+
+		//				MANIPULATORS
+		//
+
+		// Init prepares the conversion of a new stream.
+		// It allocates the memory; the other functions allocate nothing.
+		//
+		// INPUT
+		//	numChannels:	1 or 2.
+		//	maxOutFrames:	the largest number of frames that Process will be asked.
+		//
+		void Init(DWORD inRate, DWORD outRate, int numChannels, RESAMPLER_QUALITY quality, size_t maxOutFrames);
+
+		// Process converts the next chunk of the stream.
+		// Frames are interleaved.
+		//
+		// PRECONDITIONS
+		//	numOutFrames <= maxOutFrames given to Init
+		//	numInFrames == InputFramesNeeded(numOutFrames)
+		//
+		void Process(const float *in, size_t numInFrames, float *out, size_t numOutFrames);
+
+	private:
+		// CreateTable fills the table of phases.
+		void CreateTable(double cutoff);
+
+	private:
+		DWORD		m_inRate{ 0 };
+		DWORD		m_outRate{ 0 };
+		int			m_numChannels{ 0 };
+		int			m_numTaps{ 0 };
+		int			m_phaseBits{ 0 };
+
+		// Rows of m_numTaps coefficients. There is one more row than phases,
+		// so that the last phase can be interpolated with the next one.
+		// m_cutoff is the cutoff the table was made for.
+		std::vector<float>	m_table;
+		double				m_cutoff{ 0. };
+
+		// Coefficients of the current output frame.
+		std::vector<float>	m_coefs;
+
+		// Distance between two output frames, in input frames, as 32.32 fixed point.
+		uint64_t	m_step{ 0 };
+
+		// Position of the next output frame in the input history, as 32.32 fixed point.
+		uint64_t	m_pos{ 0 };
+
+		// Last input frames, one array per channel.
+		std::vector<float>	m_history[2];
+		size_t		m_numBuffered{ 0 };
+		size_t		m_maxInFrames{ 0 };
+	};
+}
@@ -0,0 +1,493 @@
+#include "pch.h"
+#include "SampleConversion.h"
+#include <cmath>
+
+#ifdef SOUND_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef SOUND_HAS_AVX2
+#include <immintrin.h>
+#endif
+
+namespace sound {
+
+	static const float kS16Scale = 32768.f;
+	static const float kS16InvScale = 1.f / 32768.f;
+	static const float kS24Scale = 8388608.f;
+	static const float kS24InvScale = 1.f / 8388608.f;
+
+	// Load24 reads a packed 24-bit sample and sign-extends it.
+	static inline int32_t Load24(const byte *src)
+	{
+		auto u = static_cast<uint32_t>(src[0]) | (static_cast<uint32_t>(src[1]) << 8) | (static_cast<uint32_t>(src[2]) << 16);
+		return static_cast<int32_t>(u << 8) >> 8;
+	}
+
+	static inline void Store24(byte *dst, int32_t v)
+	{
+		dst[0] = static_cast<byte>(v);
+		dst[1] = static_cast<byte>(v >> 8);
+		dst[2] = static_cast<byte>(v >> 16);
+	}
+
+	// Clamp saturates v the way the SIMD min and max instructions do:
+	// NaN becomes lo.
+	static inline float Clamp(float v, float lo, float hi)
+	{
+		v = (v > lo) ? v : lo;
+		return (v < hi) ? v : hi;
+	}
+
+
+	//					SCALAR
+	//
+
+	static void S16ToF32_Scalar(float *dst, const int16_t *src, size_t n)
+	{
+		for (size_t i = 0; i < n; i++) {
+			dst[i] = static_cast<float>(src[i]) * kS16InvScale;
+		}
+	}
+
+	static void F32ToS16_Scalar(int16_t *dst, const float *src, size_t n)
+	{
+		for (size_t i = 0; i < n; i++) {
+			// Round half to even, like the default SSE rounding mode.
+			dst[i] = static_cast<int16_t>(std::nearbyint(Clamp(src[i] * kS16Scale, -32768.f, 32767.f)));
+		}
+	}
+
+	static void S24ToF32_Scalar(float *dst, const byte *src, size_t n)
+	{
+		for (size_t i = 0; i < n; i++) {
+			dst[i] = static_cast<float>(Load24(src + 3 * i)) * kS24InvScale;
+		}
+	}
+
+	static void F32ToS24_Scalar(byte *dst, const float *src, size_t n)
+	{
+		for (size_t i = 0; i < n; i++) {
+			auto v = std::nearbyint(Clamp(src[i] * kS24Scale, -8388608.f, 8388607.f));
+			Store24(dst + 3 * i, static_cast<int32_t>(v));
+		}
+	}
+
+	static void MonoToStereo_Scalar(float *dst, const float *src, size_t numFrames)
+	{
+		for (size_t i = 0; i < numFrames; i++) {
+			dst[2 * i] = src[i];
+			dst[2 * i + 1] = src[i];
+		}
+	}
+
+	static void StereoToMono_Scalar(float *dst, const float *src, size_t numFrames)
+	{
+		for (size_t i = 0; i < numFrames; i++) {
+			dst[i] = (src[2 * i] + src[2 * i + 1]) * 0.5f;
+		}
+	}
+
+	static void Interleave_Scalar(float *dst, const float *left, const float *right, size_t numFrames)
+	{
+		for (size_t i = 0; i < numFrames; i++) {
+			dst[2 * i] = left[i];
+			dst[2 * i + 1] = right[i];
+		}
+	}
+
+	static void Deinterleave_Scalar(float *left, float *right, const float *src, size_t numFrames)
+	{
+		for (size_t i = 0; i < numFrames; i++) {
+			left[i] = src[2 * i];
+			right[i] = src[2 * i + 1];
+		}
+	}
+
+	static const ConversionKernels kScalarKernels = {
+		SIMD_LEVEL_SCALAR,
+		S16ToF32_Scalar,
+		F32ToS16_Scalar,
+		S24ToF32_Scalar,
+		F32ToS24_Scalar,
+		MonoToStereo_Scalar,
+		StereoToMono_Scalar,
+		Interleave_Scalar,
+		Deinterleave_Scalar,
+	};
+
+
+	//					SSE2
+	//
+	// Each kernel handles the samples left after its SIMD loop with the scalar kernel.
+
+#ifdef SOUND_HAS_SSE2
+	static void S16ToF32_SSE2(float *dst, const int16_t *src, size_t n)
+	{
+		const auto scale = _mm_set1_ps(kS16InvScale);
+
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8) {
+			auto s = _mm_loadu_si128((const __m128i *)(src + i));
+
+			// Sign-extend the 16-bit samples to 32 bits.
+			auto lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+			auto hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+			_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+		}
+
+		S16ToF32_Scalar(dst + i, src + i, n - i);
+	}
+
+	static void F32ToS16_SSE2(int16_t *dst, const float *src, size_t n)
+	{
+		const auto scale = _mm_set1_ps(kS16Scale);
+		const auto lo = _mm_set1_ps(-32768.f);
+		const auto hi = _mm_set1_ps(32767.f);
+
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8) {
+			auto v0 = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+			auto v1 = _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale);
+
+			// _mm_cvtps_epi32 does not saturate: clamp first.
+			v0 = _mm_min_ps(_mm_max_ps(v0, lo), hi);
+			v1 = _mm_min_ps(_mm_max_ps(v1, lo), hi);
+
+			auto packed = _mm_packs_epi32(_mm_cvtps_epi32(v0), _mm_cvtps_epi32(v1));
+			_mm_storeu_si128((__m128i *)(dst + i), packed);
+		}
+
+		F32ToS16_Scalar(dst + i, src + i, n - i);
+	}
+
+	static void S24ToF32_SSE2(float *dst, const byte *src, size_t n)
+	{
+		const auto scale = _mm_set1_ps(kS24InvScale);
+
+		// SSE2 has no byte shuffle: only the conversion is vectorized.
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			const auto *s = src + 3 * i;
+			auto v = _mm_set_epi32(Load24(s + 9), Load24(s + 6), Load24(s + 3), Load24(s));
+
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+		}
+
+		S24ToF32_Scalar(dst + i, src + 3 * i, n - i);
+	}
+
+	static void F32ToS24_SSE2(byte *dst, const float *src, size_t n)
+	{
+		const auto scale = _mm_set1_ps(kS24Scale);
+		const auto lo = _mm_set1_ps(-8388608.f);
+		const auto hi = _mm_set1_ps(8388607.f);
+
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			auto v = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+			v = _mm_min_ps(_mm_max_ps(v, lo), hi);
+
+			alignas(16) int32_t ints[4];
+			_mm_store_si128((__m128i *)ints, _mm_cvtps_epi32(v));
+
+			auto *d = dst + 3 * i;
+			Store24(d, ints[0]);
+			Store24(d + 3, ints[1]);
+			Store24(d + 6, ints[2]);
+			Store24(d + 9, ints[3]);
+		}
+
+		F32ToS24_Scalar(dst + 3 * i, src + i, n - i);
+	}
+
+	static void MonoToStereo_SSE2(float *dst, const float *src, size_t numFrames)
+	{
+		size_t i = 0;
+		for (; i + 4 <= numFrames; i += 4) {
+			auto m = _mm_loadu_ps(src + i);
+
+			_mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(m, m));
+			_mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(m, m));
+		}
+
+		MonoToStereo_Scalar(dst + 2 * i, src + i, numFrames - i);
+	}
+
+	static void StereoToMono_SSE2(float *dst, const float *src, size_t numFrames)
+	{
+		const auto half = _mm_set1_ps(0.5f);
+
+		size_t i = 0;
+		for (; i + 4 <= numFrames; i += 4) {
+			auto s0 = _mm_loadu_ps(src + 2 * i);
+			auto s1 = _mm_loadu_ps(src + 2 * i + 4);
+
+			auto left = _mm_shuffle_ps(s0, s1, _MM_SHUFFLE(2, 0, 2, 0));
+			auto right = _mm_shuffle_ps(s0, s1, _MM_SHUFFLE(3, 1, 3, 1));
+
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_add_ps(left, right), half));
+		}
+
+		StereoToMono_Scalar(dst + i, src + 2 * i, numFrames - i);
+	}
+
+	static void Interleave_SSE2(float *dst, const float *left, const float *right, size_t numFrames)
+	{
+		size_t i = 0;
+		for (; i + 4 <= numFrames; i += 4) {
+			auto l = _mm_loadu_ps(left + i);
+			auto r = _mm_loadu_ps(right + i);
+
+			_mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(l, r));
+			_mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+		}
+
+		Interleave_Scalar(dst + 2 * i, left + i, right + i, numFrames - i);
+	}
+
+	static void Deinterleave_SSE2(float *left, float *right, const float *src, size_t numFrames)
+	{
+		size_t i = 0;
+		for (; i + 4 <= numFrames; i += 4) {
+			auto s0 = _mm_loadu_ps(src + 2 * i);
+			auto s1 = _mm_loadu_ps(src + 2 * i + 4);
+
+			_mm_storeu_ps(left + i, _mm_shuffle_ps(s0, s1, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(right + i, _mm_shuffle_ps(s0, s1, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+
+		Deinterleave_Scalar(left + i, right + i, src + 2 * i, numFrames - i);
+	}
+
+	static const ConversionKernels kSSE2Kernels = {
+		SIMD_LEVEL_SSE2,
+		S16ToF32_SSE2,
+		F32ToS16_SSE2,
+		S24ToF32_SSE2,
+		F32ToS24_SSE2,
+		MonoToStereo_SSE2,
+		StereoToMono_SSE2,
+		Interleave_SSE2,
+		Deinterleave_SSE2,
+	};
+#endif
+
+
+	//					AVX2
+	//
+	// Most AVX2 instructions work on two independent 128-bit lanes:
+	// results are put back in order with a permutation of the lanes.
+
+#ifdef SOUND_HAS_AVX2
+	SOUND_TARGET_AVX2 static void S16ToF32_AVX2(float *dst, const int16_t *src, size_t n)
+	{
+		const auto scale = _mm256_set1_ps(kS16InvScale);
+
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8) {
+			auto s = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+
+			_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(s), scale));
+		}
+
+		S16ToF32_Scalar(dst + i, src + i, n - i);
+	}
+
+	SOUND_TARGET_AVX2 static void F32ToS16_AVX2(int16_t *dst, const float *src, size_t n)
+	{
+		const auto scale = _mm256_set1_ps(kS16Scale);
+		const auto lo = _mm256_set1_ps(-32768.f);
+		const auto hi = _mm256_set1_ps(32767.f);
+
+		size_t i = 0;
+		for (; i + 16 <= n; i += 16) {
+			auto v0 = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+			auto v1 = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale);
+
+			v0 = _mm256_min_ps(_mm256_max_ps(v0, lo), hi);
+			v1 = _mm256_min_ps(_mm256_max_ps(v1, lo), hi);
+
+			// packs interleaves the lanes of its operands: 0-3, 8-11, 4-7, 12-15.
+			auto packed = _mm256_packs_epi32(_mm256_cvtps_epi32(v0), _mm256_cvtps_epi32(v1));
+			packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+
+			_mm256_storeu_si256((__m256i *)(dst + i), packed);
+		}
+
+		F32ToS16_Scalar(dst + i, src + i, n - i);
+	}
+
+	SOUND_TARGET_AVX2 static void S24ToF32_AVX2(float *dst, const byte *src, size_t n)
+	{
+		const auto scale = _mm256_set1_ps(kS24InvScale);
+
+		// Moves the 3 bytes of each sample to the top of a 32-bit integer.
+		const auto shuffle = _mm256_setr_epi8(
+			-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+			-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+
+		// Each lane loads 16 bytes for 4 samples: stop early enough
+		// not to read past the end of the source.
+		size_t i = 0;
+		for (; i + 10 <= n; i += 8) {
+			const auto *s = src + 3 * i;
+			auto lo = _mm_loadu_si128((const __m128i *)s);
+			auto hi = _mm_loadu_si128((const __m128i *)(s + 12));
+			auto bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+			// The arithmetic shift sign-extends the samples.
+			auto v = _mm256_srai_epi32(_mm256_shuffle_epi8(bytes, shuffle), 8);
+
+			_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+		}
+
+		S24ToF32_Scalar(dst + i, src + 3 * i, n - i);
+	}
+
+	SOUND_TARGET_AVX2 static void F32ToS24_AVX2(byte *dst, const float *src, size_t n)
+	{
+		const auto scale = _mm256_set1_ps(kS24Scale);
+		const auto lo = _mm256_set1_ps(-8388608.f);
+		const auto hi = _mm256_set1_ps(8388607.f);
+
+		// Packs the 3 low bytes of each 32-bit integer at the beginning of the lane.
+		const auto shuffle = _mm256_setr_epi8(
+			0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+			0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+		// Each lane stores 16 bytes for 4 samples; the last 4 bytes are overwritten
+		// by the next store. Stop early enough not to write past the end of the destination.
+		size_t i = 0;
+		for (; i + 10 <= n; i += 8) {
+			auto v = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+			v = _mm256_min_ps(_mm256_max_ps(v, lo), hi);
+
+			auto bytes = _mm256_shuffle_epi8(_mm256_cvtps_epi32(v), shuffle);
+
+			auto *d = dst + 3 * i;
+			_mm_storeu_si128((__m128i *)d, _mm256_castsi256_si128(bytes));
+			_mm_storeu_si128((__m128i *)(d + 12), _mm256_extracti128_si256(bytes, 1));
+		}
+
+		F32ToS24_Scalar(dst + 3 * i, src + i, n - i);
+	}
+
+	SOUND_TARGET_AVX2 static void MonoToStereo_AVX2(float *dst, const float *src, size_t numFrames)
+	{
+		size_t i = 0;
+		for (; i + 8 <= numFrames; i += 8) {
+			auto m = _mm256_loadu_ps(src + i);
+
+			auto lo = _mm256_unpacklo_ps(m, m);
+			auto hi = _mm256_unpackhi_ps(m, m);
+
+			_mm256_storeu_ps(dst + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+			_mm256_storeu_ps(dst + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+		}
+
+		MonoToStereo_Scalar(dst + 2 * i, src + i, numFrames - i);
+	}
+
+	SOUND_TARGET_AVX2 static void StereoToMono_AVX2(float *dst, const float *src, size_t numFrames)
+	{
+		const auto half = _mm256_set1_ps(0.5f);
+
+		size_t i = 0;
+		for (; i + 8 <= numFrames; i += 8) {
+			auto s0 = _mm256_loadu_ps(src + 2 * i);
+			auto s1 = _mm256_loadu_ps(src + 2 * i + 8);
+
+			auto left = _mm256_shuffle_ps(s0, s1, _MM_SHUFFLE(2, 0, 2, 0));
+			auto right = _mm256_shuffle_ps(s0, s1, _MM_SHUFFLE(3, 1, 3, 1));
+			auto mono = _mm256_mul_ps(_mm256_add_ps(left, right), half);
+
+			// The lanes hold frames 0-1, 4-5, 2-3, 6-7.
+			mono = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(mono), _MM_SHUFFLE(3, 1, 2, 0)));
+
+			_mm256_storeu_ps(dst + i, mono);
+		}
+
+		StereoToMono_Scalar(dst + i, src + 2 * i, numFrames - i);
+	}
+
+	SOUND_TARGET_AVX2 static void Interleave_AVX2(float *dst, const float *left, const float *right, size_t numFrames)
+	{
+		size_t i = 0;
+		for (; i + 8 <= numFrames; i += 8) {
+			auto l = _mm256_loadu_ps(left + i);
+			auto r = _mm256_loadu_ps(right + i);
+
+			auto lo = _mm256_unpacklo_ps(l, r);
+			auto hi = _mm256_unpackhi_ps(l, r);
+
+			_mm256_storeu_ps(dst + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+			_mm256_storeu_ps(dst + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+		}
+
+		Interleave_Scalar(dst + 2 * i, left + i, right + i, numFrames - i);
+	}
+
+	SOUND_TARGET_AVX2 static void Deinterleave_AVX2(float *left, float *right, const float *src, size_t numFrames)
+	{
+		size_t i = 0;
+		for (; i + 8 <= numFrames; i += 8) {
+			auto s0 = _mm256_loadu_ps(src + 2 * i);
+			auto s1 = _mm256_loadu_ps(src + 2 * i + 8);
+
+			auto l = _mm256_shuffle_ps(s0, s1, _MM_SHUFFLE(2, 0, 2, 0));
+			auto r = _mm256_shuffle_ps(s0, s1, _MM_SHUFFLE(3, 1, 3, 1));
+
+			// The lanes hold frames 0-1, 4-5, 2-3, 6-7.
+			l = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0)));
+			r = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0)));
+
+			_mm256_storeu_ps(left + i, l);
+			_mm256_storeu_ps(right + i, r);
+		}
+
+		Deinterleave_Scalar(left + i, right + i, src + 2 * i, numFrames - i);
+	}
+
+	static const ConversionKernels kAVX2Kernels = {
+		SIMD_LEVEL_AVX2,
+		S16ToF32_AVX2,
+		F32ToS16_AVX2,
+		S24ToF32_AVX2,
+		F32ToS24_AVX2,
+		MonoToStereo_AVX2,
+		StereoToMono_AVX2,
+		Interleave_AVX2,
+		Deinterleave_AVX2,
+	};
+#endif
+
+
+	//					DISPATCH
+	//
+
+	const ConversionKernels &GetConversionKernels(SIMD_LEVEL level)
+	{
+#ifdef SOUND_HAS_AVX2
+		if (level >= SIMD_LEVEL_AVX2) {
+			return kAVX2Kernels;
+		}
+#endif
+
+#ifdef SOUND_HAS_SSE2
+		if (level >= SIMD_LEVEL_SSE2) {
+			return kSSE2Kernels;
+		}
+#endif
+
+		return kScalarKernels;
+	}
+
+	const ConversionKernels &BestConversionKernels()
+	{
+		static const ConversionKernels &s_kernels = GetConversionKernels(DetectSimdLevel());
+		return s_kernels;
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "framework.h"
+#include "Cpu.h"
+
+namespace sound {
+
+	// Sample formats:
+	//	- S16: signed 16-bit integers.
+	//	- S24: signed 24-bit integers packed in 3 bytes, little endian.
+	//	- F32: floats, where 1.0 is the full scale of the integer formats.
+	//
+	// Conversions to integers saturate the samples out of range and round the others
+	// to the nearest integer, ties to even.
+	// Channel functions work on float frames. Stereo frames are interleaved: left, right.
+	// Destinations must not overlap sources.
+	//
+	// All the implementations of a kernel compute the same results, bit for bit.
+
+	// ConversionKernels holds the implementation of every kernel for one instruction set.
+	struct ConversionKernels {
+		SIMD_LEVEL	level;
+
+		void(*s16ToF32)(float *dst, const int16_t *src, size_t n);
+		void(*f32ToS16)(int16_t *dst, const float *src, size_t n);
+		void(*s24ToF32)(float *dst, const byte *src, size_t n);
+		void(*f32ToS24)(byte *dst, const float *src, size_t n);
+
+		// The mono sample is copied in both channels.
+		void(*monoToStereo)(float *dst, const float *src, size_t numFrames);
+		// The mono sample is the average of both channels.
+		void(*stereoToMono)(float *dst, const float *src, size_t numFrames);
+
+		void(*interleave)(float *dst, const float *left, const float *right, size_t numFrames);
+		void(*deinterleave)(float *left, float *right, const float *src, size_t numFrames);
+	};
+
+	// GetConversionKernels returns the kernels of an instruction set.
+	// If they are not compiled in, the kernels of the most capable set below are returned.
+	// The caller must make sure that the CPU supports the instruction set.
+	const ConversionKernels &GetConversionKernels(SIMD_LEVEL level);
+
+	// BestConversionKernels returns the kernels picked for the CPU the first time it is called.
+	const ConversionKernels &BestConversionKernels();
+
+	//			KERNELS PICKED FOR THE CPU
+	//
+
+	inline void ConvertS16ToF32(float *dst, const int16_t *src, size_t n) { BestConversionKernels().s16ToF32(dst, src, n); }
+	inline void ConvertF32ToS16(int16_t *dst, const float *src, size_t n) { BestConversionKernels().f32ToS16(dst, src, n); }
+	inline void ConvertS24ToF32(float *dst, const byte *src, size_t n) { BestConversionKernels().s24ToF32(dst, src, n); }
+	inline void ConvertF32ToS24(byte *dst, const float *src, size_t n) { BestConversionKernels().f32ToS24(dst, src, n); }
+
+	inline void MonoToStereo(float *dst, const float *src, size_t numFrames) { BestConversionKernels().monoToStereo(dst, src, numFrames); }
+	inline void StereoToMono(float *dst, const float *src, size_t numFrames) { BestConversionKernels().stereoToMono(dst, src, numFrames); }
+
+	inline void Interleave(float *dst, const float *left, const float *right, size_t numFrames) { BestConversionKernels().interleave(dst, left, right, numFrames); }
+	inline void Deinterleave(float *left, float *right, const float *src, size_t numFrames) { BestConversionKernels().deinterleave(left, right, src, numFrames); }
+}
@@ -1,27 +1,122 @@
 #include "pch.h"
 #include "SoundSystem.h"
+#include "DirectSoundDevice.h"
+#include "HeadlessDevice.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
 #include <stdexcept>
 
 namespace sound {
 
-	// File static pointer to the unique SoundSystem.
-	// We need a global variable so that the streaming procedure can call functions of the class.
-	static SoundSystem	*s_system;
+#ifdef _WIN32
+	Error CreateSoundSystem(IN HWND window, OUT SoundSystem **system, IN const SoundSystemDesc &desc)
+	{
+		assert(system != nullptr);
 
-	Error CreateSoundSystem(IN HWND window, OUT SoundSystem **system)
+		OutputDevice *device = nullptr;
+		try {
+			device = new DirectSoundDevice(window);
+		}
+		catch (const std::exception &e) {
+			return ERROR_FAILURE;
+		}
+
+		return CreateSoundSystem(device, system, desc);
+	}
+#endif
+
+	Error CreateSoundSystem(IN OutputDevice *device, OUT SoundSystem **system, IN const SoundSystemDesc &desc)
 	{
+		assert(device != nullptr);
 		assert(system != nullptr);
 
 		try {
-			*system = new sound::SoundSystem(window);
+			*system = new sound::SoundSystem(device, desc);
+		}
+		catch (const std::exception &e) {
+			return ERROR_FAILURE;
+		}
+
+		try {
+			(*system)->StartStreamingThread();
+		}
+		catch (const std::exception &e) {
+			DestroySoundSystem(system);
+			return ERROR_FAILURE;
+		}
+
+		return ERROR_NONE;
+	}
+
+	Error CreateOfflineSoundSystem(IN SimulatedDevice *device, OUT SoundSystem **system, IN const SoundSystemDesc &desc)
+	{
+		assert(device != nullptr);
+		assert(system != nullptr);
+
+		if (device->ClockKind() != DEVICE_CLOCK_MANUAL) {
+			delete device;
+			return ERROR_FAILURE;
+		}
+
+		try {
+			*system = new sound::SoundSystem(device, desc);
+		}
+		catch (const std::exception &e) {
+			return ERROR_FAILURE;
+		}
+
+		(*system)->m_offlineDevice = device;
+
+		return ERROR_NONE;
+	}
+
+	Error RenderOffline(IN const char *wavFilename, IN const char *const *assetPaths, IN size_t numAssets,
+		IN const RenderCommand *commands, IN size_t numCommands,
+		IN DWORD numFrames, IN const SoundSystemDesc &desc)
+	{
+		assert(assetPaths != nullptr || numAssets == 0);
+		assert(commands != nullptr || numCommands == 0);
+
+		SimulatedDevice *device = nullptr;
+		try {
+			device = new WavFileDevice(wavFilename, DEVICE_CLOCK_MANUAL);
 		}
 		catch (const std::exception &e) {
 			return ERROR_FAILURE;
 		}
 
-		// Save the created instance in the file static variable.
-		assert(s_system == nullptr);
-		s_system = *system;
+		SoundSystem *system = nullptr;
+		auto err = CreateOfflineSoundSystem(device, &system, desc);
+		if (err) {
+			return err;
+		}
+
+		for (size_t i = 0; i < numAssets; i++) {
+			AssetHandle asset;
+			if (system->Register(assetPaths[i], &asset)) {
+				DestroySoundSystem(&system);
+				return ERROR_FAILURE;
+			}
+			assert(asset == i + 1);
+		}
+
+		DWORD frame = 0;
+		for (size_t i = 0; i < numCommands && commands[i].frame < numFrames; i++) {
+			assert(commands[i].frame >= frame);
+
+			system->Render(commands[i].frame - frame);
+			frame = commands[i].frame;
+
+			// A full queue is emptied before the frame goes on.
+			if (system->PushRequest(commands[i].request)) {
+				system->Render(0);
+				system->PushRequest(commands[i].request);
+			}
+		}
+		system->Render(numFrames - frame);
+
+		DestroySoundSystem(&system);
 
 		return ERROR_NONE;
 	}
@@ -30,262 +125,624 @@ namespace sound {
 	{
 		// I cannot use SafeDelete here because the SoundSystem destructor is private.
 		if (*system) {
+			(*system)->StopStreamingThread();
+
 			delete *system;
 			*system = nullptr;
 		}
-
-		// Clear the file static pointer to the system.
-		s_system = nullptr;
 	}
 
-	SoundSystem::SoundSystem(HWND window)
-		: m_window(window)
+	SoundSystem::SoundSystem(OutputDevice *device, const SoundSystemDesc &desc)
+		: m_device(device)
+		, m_cache(desc.cacheBudgetBytes, desc.maxAssets)
+		, m_assets(desc.maxAssets)
 	{
-		HRESULT hr = S_OK;
+		//					Streaming
+		//
 
-		hr = DirectSoundCreate8(NULL, &m_directSound, NULL);
-		if (FAILED(hr)) {
-			throw std::runtime_error("sound: DirectSoundCreate8() failed.");
+		// Create the streaming buffer: it holds latencyMs of sound, refilled one region at a time.
+		// With an adaptive latency, it holds up to maxLatencyMs, in regions of the same duration.
+		auto latencyMs = desc.latencyMs;
+		auto numRegions = desc.numRegions;
+		if (desc.adaptiveLatency && desc.numRegions >= 1) {
+			auto regionMs = std::max<DWORD>(desc.latencyMs / desc.numRegions, 1);
+			numRegions = std::max(std::min(static_cast<int>(desc.maxLatencyMs / regionMs), StreamingBuffer::kMaxRegions), desc.numRegions);
+			latencyMs = regionMs * numRegions;
 		}
 
-		hr = m_directSound->SetCooperativeLevel(m_window, DSSCL_PRIORITY);
-		if (FAILED(hr)) {
-			throw std::runtime_error("sound: SetCooperativeLevel() failed.");
+		try {
+			m_streamingBuffer = new StreamingBuffer(m_device, desc.format, latencyMs, numRegions);
+		}
+		catch (...) {
+			SafeDelete(&m_device);
+			throw;
 		}
 
-		// Create the primary buffer.
-		DSBUFFERDESC desc{ 0 };
-		ZeroMemory(&desc, sizeof(DSBUFFERDESC));
-		desc.dwSize = sizeof(DSBUFFERDESC);
-		desc.dwFlags = DSBCAPS_PRIMARYBUFFER | DSBCAPS_CTRLVOLUME;
-		desc.dwBufferBytes = 0;
-		desc.lpwfxFormat = NULL;
-
-		hr = m_directSound->CreateSoundBuffer(&desc, &m_primaryBuffer, NULL);
-		if (FAILED(hr)) {
-			throw std::runtime_error("sound: CreateSoundBuffer() failed.");
+		// The refills start desc.numRegions - 1 regions ahead of the play cursor. A fixed
+		// latency keeps this lead, an adaptive one moves it between 2 regions and the whole buffer.
+		const auto maxLead = m_streamingBuffer->NumRegions() - 1;
+		const auto initialLead = std::min(desc.numRegions - 1, maxLead);
+		if (desc.adaptiveLatency) {
+			auto regionsPerSecond = desc.format.nAvgBytesPerSec / m_streamingBuffer->RegionSize();
+			auto numStableRefills = std::max<int>(static_cast<int>(regionsPerSecond * kStablePeriodMs / 1000), 1);
+			m_latency = LatencyController(std::min(2, initialLead), maxLead, initialLead, numStableRefills);
+		}
+		else {
+			m_latency = LatencyController(initialLead, initialLead, initialLead, 1);
 		}
+		m_lead = m_latency.Lead();
+		UpdateLatencyMs();
 
-		//m_primaryBuffer->Release();
+		//					Mixing
+		//
 
+		// The largest chunk is the one that fills the buffer up to the start of the last region.
+		auto maxFrames = m_streamingBuffer->RegionStart(maxLead) / desc.format.nBlockAlign;
+		try {
+			m_mixer = new Mixer(1 + std::max(desc.maxSounds, 0), desc.format, maxFrames, desc.resamplerQuality);
+		}
+		catch (...) {
+			SafeDelete(&m_streamingBuffer);
+			SafeDelete(&m_device);
+			throw;
+		}
 
-		//					Streaming
+		//					Assets
 		//
 
-		// Create a ticking timer to call the streaming procedure every 300 milliseconds.
-		if (0 == SetTimer(window, kTimerId, 300, &SoundSystem::StreamingProcedure)) {
-			throw std::runtime_error("sound: (streaming) SetTimer() failed.");
+		// The pack is mapped once: its assets are then played without a system call.
+		if (desc.packFilename) {
+			if (m_pack.Open(desc.packFilename)) {
+				SafeDelete(&m_mixer);
+				SafeDelete(&m_streamingBuffer);
+				SafeDelete(&m_device);
+				throw std::runtime_error("sound::SoundSystem - Cannot open the asset pack.");
+			}
+			m_mixer->SetAssetPack(&m_pack);
 		}
-
-		// Create the streaming buffer:
-		//	- big enough to hold 2 seconds of sound and,
-		//	- two notification positions at 25% and 75%.
-		m_streamingBuffer = new StreamingBuffer(m_directSound, 2, { 25, 75 });
 	}
 
 	SoundSystem::~SoundSystem()
 	{
+		assert(!m_streamingThread.joinable());
+
+		SafeDelete(&m_mixer);
 		SafeDelete(&m_streamingBuffer);
+		SafeDelete(&m_device);
+	}
+
+	void SoundSystem::StartStreamingThread()
+	{
+		m_quit = false;
+		m_streamingThread = std::thread(&SoundSystem::StreamingProcedure, this);
 
-		KillTimer(m_window, kTimerId);
+#ifdef _WIN32
+		// Refills have a deadline: the play cursor reaching the region.
+		SetThreadPriority(m_streamingThread.native_handle(), THREAD_PRIORITY_TIME_CRITICAL);
+#endif
+	}
+
+	void SoundSystem::StopStreamingThread()
+	{
+		// An offline system has no thread.
+		if (m_streamingThread.joinable()) {
+			m_quit = true;
+			m_device->Interrupt();
+
+			m_streamingThread.join();
+		}
+
+		// The thread may have quit while a music was playing.
+		if (m_playing) {
+			StopPlaying();
+		}
+	}
 
-		m_primaryBuffer->Release();
-		m_directSound->Release();
+	Error SoundSystem::Register(const char *filename, OUT AssetHandle *asset)
+	{
+		return m_assets.Register(filename, m_pack.IsOpen() ? &m_pack : nullptr, asset);
+	}
+
+	Error SoundSystem::Play(AssetHandle asset)
+	{
+		return PushAssetRequest(MakeMusicRequest_Play(asset));
+	}
+
+	Error SoundSystem::PlayWithCrossfade(AssetHandle asset, DWORD fadeMs, FADE_CURVE curve)
+	{
+		return PushAssetRequest(MakeMusicRequest_PlayCrossfade(asset, fadeMs, curve));
+	}
+
+	Error SoundSystem::PlayLooped(AssetHandle asset, DWORD loopStartFrame, DWORD loopEndFrame)
+	{
+		return PushAssetRequest(MakeMusicRequest_PlayLooped(asset, loopStartFrame, loopEndFrame));
+	}
+
+	Error SoundSystem::PlayNext(AssetHandle asset)
+	{
+		return PushAssetRequest(MakeMusicRequest_PlayNext(asset));
+	}
+
+	Error SoundSystem::PlaySound(AssetHandle asset)
+	{
+		return PushAssetRequest(MakeMusicRequest_PlaySound(asset));
 	}
 
 	Error SoundSystem::Play(const char *filename)
 	{
-		m_requests.push(MakeMusicRequest_Play(filename));
+		AssetHandle asset;
+		return Register(filename, &asset) ? ERROR_FAILURE : Play(asset);
+	}
+
+	Error SoundSystem::PlayWithCrossfade(const char *filename, DWORD fadeMs, FADE_CURVE curve)
+	{
+		AssetHandle asset;
+		return Register(filename, &asset) ? ERROR_FAILURE : PlayWithCrossfade(asset, fadeMs, curve);
+	}
+
+	Error SoundSystem::PlayLooped(const char *filename, DWORD loopStartFrame, DWORD loopEndFrame)
+	{
+		AssetHandle asset;
+		return Register(filename, &asset) ? ERROR_FAILURE : PlayLooped(asset, loopStartFrame, loopEndFrame);
+	}
+
+	Error SoundSystem::PlayNext(const char *filename)
+	{
+		AssetHandle asset;
+		return Register(filename, &asset) ? ERROR_FAILURE : PlayNext(asset);
+	}
+
+	Error SoundSystem::PlaySound(const char *filename)
+	{
+		AssetHandle asset;
+		return Register(filename, &asset) ? ERROR_FAILURE : PlaySound(asset);
+	}
+
+	Error SoundSystem::Stop()
+	{
+		return PushRequest(MakeMusicRequest_Stop());
+	}
+
+	Error SoundSystem::Pause()
+	{
+		return PushRequest(MakeMusicRequest_Pause());
+	}
+
+	Error SoundSystem::Resume()
+	{
+		return PushRequest(MakeMusicRequest_Resume());
+	}
+
+	Error SoundSystem::Render(DWORD numFrames)
+	{
+		if (!m_offlineDevice) {
+			return ERROR_FAILURE;
+		}
+
+		// The cursor stops at each notification position, so that the region is refilled
+		// before the cursor gets there, like with a streaming thread that is never late.
+		auto numBytes = static_cast<uint64_t>(numFrames) * m_streamingBuffer->Format().nBlockAlign;
+		while (true) {
+			while (StreamingStep(0)) {}
+
+			if (numBytes == 0) {
+				break;
+			}
+			numBytes -= m_offlineDevice->Advance(static_cast<DWORD>(std::min<uint64_t>(numBytes, 0xFFFFFFFF)));
+		}
+
+		return ERROR_NONE;
+	}
+
+	Error SoundSystem::PushRequest(const MusicRequest &req)
+	{
+		if (!m_requests.Push(req)) {
+			return ERROR_FAILURE;
+		}
+
+		m_device->Interrupt();
 
 		return ERROR_NONE;
 	}
 
-	bool SoundSystem::CheckMusicRequest()
+	Error SoundSystem::PushAssetRequest(const MusicRequest &req)
 	{
-		// Pop one...
-		MusicRequest req;
-		auto gotOne = m_requests.try_pop(OUT req);
-		if (!gotOne) {
+		if (!m_assets.Find(req.asset)) {
+			return ERROR_FAILURE;
+		}
+
+		return PushRequest(req);
+	}
+
+	bool SoundSystem::CheckMusicRequests()
+	{
+		// Pop all...
+		MusicRequest reqs[kMaxPendingRequests];
+		auto count = m_requests.PopAll(reqs, kMaxPendingRequests);
+		if (count == 0) {
 			return false;
 		}
 
-		// ... and handle it.
-		DebugPrintfA("\tHandling a request\n");
+		// ... forget the ones that a later request makes pointless...
+		count = CoalesceMusicRequests(reqs, count);
+
+		// ... and handle the others.
+		auto restarted = false;
+		for (size_t i = 0; i < count; i++) {
+			restarted |= HandleMusicRequest(reqs[i]);
+		}
+
+		return restarted;
+	}
+
+	bool SoundSystem::HandleMusicRequest(const MusicRequest &req)
+	{
+		SOUND_TRACE_INFO(TRACE_EVENT_REQUEST, req.type, 0, 0);
 		switch (req.type) {
 		case MUSIC_REQUEST_TYPE_PLAY: {
-			HandlePlayRequest(req.filename);
+			return HandlePlayRequest(req);
+		}break;
+
+		case MUSIC_REQUEST_TYPE_PLAY_NEXT: {
+			return HandlePlayNextRequest(req);
 		}break;
 
 		case MUSIC_REQUEST_TYPE_STOP: {
-			StopPlaying();
+			return HandleStopRequest();
+		}break;
+
+		case MUSIC_REQUEST_TYPE_PLAY_SOUND: {
+			return HandlePlaySoundRequest(req.asset);
+		}break;
+
+		case MUSIC_REQUEST_TYPE_PAUSE: {
+			return HandlePauseRequest();
+		}break;
+
+		case MUSIC_REQUEST_TYPE_RESUME: {
+			return HandleResumeRequest();
 		}break;
 
 		default: {
 			assert(false && "Unknwon request or not yet implemented");
+			return false;
 		}break;
 		}
 
 		return true;
 	}
 
-	void SoundSystem::CheckSoundBufferUpdate()
+	void SoundSystem::CheckSoundBufferUpdate(int sigPos)
 	{
-		// There is nothing to do if is no song playing.
+		// There is nothing to do if the buffer is not playing.
 		if (!m_playing) {
 			return;
 		}
 
-		int sigPos;
-		auto signaled = m_streamingBuffer->APositionWasSignaled(&sigPos);
-		if (!signaled) {
-			return;
-		}
+		// How far the play cursor went past the notification position.
+		const auto capacity = m_streamingBuffer->Capacity();
+		auto late = (capacity - m_streamingBuffer->DistanceToRegion(sigPos)) % capacity;
+		m_health.RecordWakeup(BytesToNanoseconds(late));
 
-		auto mustStopPlaying = m_atEOF && (sigPos == m_sigPosAtEOF);
+		// The regions ahead were filled with silence by now:
+		// the last region that had data was entirely played.
+		auto mustStopPlaying = !m_mixer->HasPlayingVoices() && (m_numSilentRefills >= m_lead);
 		if (mustStopPlaying) {
 			StopPlaying();
 			return;
 		}
-		// NOTE
-		// If we're at EOF and sigPos != sigPos,
-		// the call below to transfer_one_data_chuck() will transfer a block of zeros to the sound buffer.
 
-		TransferOneDataChuck(sigPos);
+		// A shorter lead skips a refill: the region at the new lead was written by the previous one.
+		const auto lead = m_latency.Lead();
+		if (lead < m_lead) {
+			m_lead--;
+			UpdateLatencyMs();
+			return;
+		}
+
+		// A longer lead writes the regions up to the new lead in a row.
+		const auto start = std::chrono::steady_clock::now();
+		const auto numRegions = m_streamingBuffer->NumRegions();
+		const auto closest = RegionToUpdate(sigPos);
+		auto silent = true;
+		uint64_t readNs = 0;
+		for (auto ahead = m_lead; ahead <= lead; ahead++) {
+			silent &= TransferOneDataChuck((sigPos + ahead) % numRegions);
+			readNs += m_mixer->ReadNanoseconds();
+		}
+		m_numSilentRefills = silent ? m_numSilentRefills + 1 : 0;
+
+		if (m_lead != lead) {
+			m_lead = lead;
+			UpdateLatencyMs();
+		}
+
+		// The refill completed too late if the play cursor is already inside the closest region.
+		const auto regionSize = m_streamingBuffer->RegionSize();
+		auto distance = m_streamingBuffer->DistanceToRegion(closest);
+		auto underrun = distance > capacity - regionSize;
+		auto slack = underrun ? 0 : distance;
+		m_latency.OnRefill(slack, regionSize, underrun);
+
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		auto durationNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+		m_health.RecordRefill(durationNs, readNs, underrun, LatencyController::IsNearMiss(slack, regionSize));
+		if (underrun) {
+			SOUND_TRACE_WARNING(TRACE_EVENT_UNDERRUN, closest, distance, 0);
+		}
+		SOUND_TRACE_VERBOSE(TRACE_EVENT_REFILL, (sigPos + lead) % numRegions, lead, silent ? 1 : 0);
+	}
+
+	uint64_t SoundSystem::BytesToNanoseconds(DWORD numBytes) const
+	{
+		return static_cast<uint64_t>(numBytes) * 1000000000ull / m_streamingBuffer->Format().nAvgBytesPerSec;
 	}
 
 	void SoundSystem::StopPlaying()
 	{
-		DebugPrintfA("Stop\n");
+		SOUND_TRACE_INFO(TRACE_EVENT_STOP, 0, 0, 0);
 		m_streamingBuffer->Stop();
 
-		m_audioFile.close();
-		m_filename = "";
+		m_mixer->StopAll();
 
 		m_playing = false;
+		m_paused = false;
 	}
 
 	void SoundSystem::StartPlaying()
 	{
-		DebugPrintfA("Play\n");
+		m_streamingBuffer->Stop();
+
+		// Transfer a data chunk big enough to fill the sound buffer up to
+		// the start of the last region.
+		auto size = FirstChunkSize();
+		SOUND_TRACE_INFO(TRACE_EVENT_PLAY, 0, size, 0);
+		auto silent = false;
+		auto data = m_mixer->Mix(size, &silent);
+		m_streamingBuffer->Write(0, data, size);
+		m_numSilentRefills = 0;
+
 		m_streamingBuffer->Play();
 		m_playing = true;
+		m_paused = false;
 	}
 
-	void SoundSystem::TransferOneDataChuck(int sigPos)
+	bool SoundSystem::TransferOneDataChuck(int region)
 	{
-		auto region = RegionToUpdate(sigPos);
-
-		// Read a data chunk.
-		auto size = m_streamingBuffer->RegionSize(region);
-		auto err = m_fileReader.Read(size);
-		if (err) {
-			OnReadError(err, sigPos);
-		}
-
-		// TODO: Apply fading if enabled.
+		// Mix a data chunk.
+		auto size = m_streamingBuffer->RegionSize();
+		auto silent = false;
+		auto data = m_mixer->Mix(size, &silent);
 
 		// Write the data chunk.
 		// We do not need to pass the data size; the streaming buffer will fill the entire region.
-		m_streamingBuffer->WriteToRegion(region, m_fileReader.Data().ptr);
+		m_streamingBuffer->WriteToRegion(region, data);
+
+		return silent;
 	}
 
 	int SoundSystem::RegionToUpdate(int sigPos)
 	{
-		assert(sigPos == 0 || sigPos == 1);
+		const auto numRegions = m_streamingBuffer->NumRegions();
+		assert(0 <= sigPos && sigPos < numRegions);
+
+		// The play cursor entered the region sigPos: the region m_lead regions ahead is
+		// the one after the data already written.
+		return (sigPos + m_lead) % numRegions;
+	}
+
+	DWORD SoundSystem::FirstChunkSize() const
+	{
+		return m_streamingBuffer->RegionStart(m_lead);
+	}
+
+	void SoundSystem::UpdateLatencyMs()
+	{
+		const auto &format = m_streamingBuffer->Format();
+		auto numBytes = static_cast<uint64_t>(m_lead) * m_streamingBuffer->RegionSize();
+		m_latencyMs = static_cast<DWORD>(numBytes * 1000 / format.nAvgBytesPerSec);
+		SOUND_TRACE_INFO(TRACE_EVENT_LATENCY, m_lead, m_latencyMs.load(), 0);
+	}
 
-		if (0 == sigPos) {
-			return 1;
+	Error SoundSystem::OpenVoice(Voice *voice, AssetHandle asset, bool startsWithRefill)
+	{
+		// The Play functions check the handle, but a render script is pushed as is.
+		const auto *registered = m_assets.Find(asset);
+		if (!registered) {
+			return ERROR_FAILURE;
 		}
-		else {
-			return 0;
+
+		// The first read fills the sound buffer up to the start of the last region,
+		// or a region if the buffer is already playing. The next ones fill a region.
+		const auto &format = m_streamingBuffer->Format();
+		auto chunkFrames = static_cast<size_t>(m_streamingBuffer->RegionSize() / format.nBlockAlign);
+		auto firstChunkFrames = startsWithRefill ? chunkFrames : static_cast<size_t>(FirstChunkSize() / format.nBlockAlign);
+
+		// Only the music is read ahead: a sound is short.
+		auto isMusic = (voice == &m_mixer->MusicVoice()) || (voice == &m_mixer->NextMusicVoice());
+		auto numReadAheadChunks = isMusic ? kNumReadAheadChunks : 0;
+
+		// A file at another sample rate is resampled by the voice.
+		return voice->Open(*registered, &m_cache, m_mixer->MaxFrames(), firstChunkFrames, chunkFrames, numReadAheadChunks);
+	}
+
+	Error SoundSystem::OpenMusic(Voice *voice, const MusicRequest &req, bool startsWithRefill)
+	{
+		auto err = OpenVoice(voice, req.asset, startsWithRefill);
+		if (err || req.loopEnd == 0) {
+			return err;
 		}
+
+		// The loop is set before the first read. A loop that cannot be set leaves the music
+		// playing once.
+		if (voice->SetLoop(req.loopStart, req.loopEnd)) {
+			DebugPrintfA("WARNING: SoundSystem::OpenMusic() - Cannot loop %s!\n", m_assets.Find(req.asset)->path.c_str());
+		}
+
+		return ERROR_NONE;
 	}
 
-	void SoundSystem::OnReadError(Error err, int sigPos)
+	bool SoundSystem::HandlePlayRequest(const MusicRequest &req)
 	{
-		assert(err != ERROR_NONE);
+		auto &music = m_mixer->MusicVoice();
 
-		if (err == ERROR_EOF) {
-			if (!m_atEOF) {
-				m_sigPosAtEOF = sigPos;
-				m_atEOF = true;
+		if (req.fadeMs > 0 && m_playing && music.IsPlaying()) {
+			// The new music is heard: the crossfade goes on from where the output was paused.
+			HandleResumeRequest();
+			HandleCrossfade(req);
+			return false;
+		}
 
-				DebugPrintfA("EOF reached for the first time.\n");
-			}
-			return;
+		m_mixer->StopOtherMusic();
+
+		auto err = OpenMusic(&music, req, false);
+		if (err) {
+			// The previous music is stopped anyway.
+			return HandleStopRequest();
 		}
 
-		// Control flow reaching this part of the code means that
-		// there was an unrecoverable read error.
-		DebugPrintfA("ERROR: soundsys::read_next_audio_data() - Error while reading the audio file!\n");
+		// The buffer is restarted: the new music starts right away, instead of
+		// after the data already written in the buffer.
+		StartPlaying();
 
-		StopPlaying();
+		return true;
 	}
 
-	void SoundSystem::OnEOF(int sigPos)
+	void SoundSystem::HandleCrossfade(const MusicRequest &req)
 	{
-		m_sigPosAtEOF = sigPos;
-		m_atEOF = true;
+		const auto numFrames = static_cast<size_t>(static_cast<uint64_t>(req.fadeMs) * m_streamingBuffer->Format().nSamplesPerSec / 1000);
+
+		// A crossfade in progress is cut short, a queued music is forgotten.
+		m_mixer->StopOtherMusic();
+		m_mixer->SwapMusicVoices();
+
+		m_mixer->FadingMusicVoice().FadeOut(numFrames, req.fadeCurve);
+
+		// If the new music cannot be opened, the previous one fades out anyway.
+		auto &music = m_mixer->MusicVoice();
+		if (OpenMusic(&music, req, true)) {
+			return;
+		}
+
+		music.SetGain(0.f);
+		music.RampGain(1.f, numFrames, req.fadeCurve);
 	}
 
-	Error SoundSystem::HandlePlayRequest(const char *filename)
+	bool SoundSystem::HandlePlayNextRequest(const MusicRequest &req)
 	{
-		StopPlaying();
+		// Without a music to follow, the music starts right away.
+		// A music that ended in the data already written is still followed, from the next refill.
+		if (!m_mixer->MusicVoice().IsOpen()) {
+			auto play = req;
+			play.type = MUSIC_REQUEST_TYPE_PLAY;
+			return HandlePlayRequest(play);
+		}
 
-		// Open the audio file.
-		m_audioFile = std::ifstream(filename, std::ios::binary);
-		if (!m_audioFile) {
-			m_audioFile.close();
-			return ERROR_FAILURE;
+		// A previously queued music is replaced.
+		m_mixer->StopOtherMusic();
+
+		auto &next = m_mixer->NextMusicVoice();
+		if (OpenMusic(&next, req, true)) {
+			return false;
 		}
-		m_filename = filename;
 
-		// Transfer a data chunk big enough to fill the sound buffer up to
-		// the start of region 1.
-		// We also have to recreate the reader with the new audio file.
-		auto size = static_cast<size_t>(m_streamingBuffer->RegionStart(1));
-		m_fileReader = sound::AudioFileReader(size, &m_audioFile);
-		
-		auto err = m_fileReader.Read();
-		if (err == ERROR_NONE) {
-			m_atEOF = false;
-		}
-		else if (err == ERROR_EOF) {
-			OnEOF(1);// position 1 is signaled
+		// The first chunk is loaded while the current music plays.
+		next.Prefetch(m_mixer->MaxFrames());
+		m_mixer->QueueNextMusic();
+
+		return false;
+	}
+
+	bool SoundSystem::HandleStopRequest()
+	{
+		m_mixer->MusicVoice().Close();
+		m_mixer->StopOtherMusic();
+
+		if (m_playing && !m_mixer->HasPlayingVoices()) {
+			StopPlaying();
+			return true;
 		}
-		else {
-			m_audioFile.close();
-			return ERROR_FAILURE;
+
+		return false;
+	}
+
+	bool SoundSystem::HandlePlaySoundRequest(AssetHandle asset)
+	{
+		auto voice = m_mixer->FindFreeVoice();
+		if (!voice) {
+			SOUND_TRACE_WARNING(TRACE_EVENT_NO_FREE_VOICE, m_mixer->NumVoices(), 0, 0);
+			return false;
+		}
+
+		auto err = OpenVoice(voice, asset, m_playing);
+		if (err) {
+			return false;
 		}
 
-		m_streamingBuffer->Write(0, m_fileReader.Data().ptr, m_fileReader.Data().size);
+		// A playing buffer mixes the sound from the next refill on.
+		if (m_playing) {
+			return false;
+		}
 
 		StartPlaying();
+		return true;
+	}
+
+	bool SoundSystem::HandlePauseRequest()
+	{
+		if (!m_playing || m_paused) {
+			return false;
+		}
 
-		// TEST FADING OUT
-		/*s_fadingEnabled = 1;
-		sFadingEffect = sound::FadingEffect(sound::FADINGEFFECT_FADEOUT, 1000.0f);*/
+		SOUND_TRACE_INFO(TRACE_EVENT_PAUSE, 0, 0, 0);
+		m_streamingBuffer->Stop();
+		m_paused = true;
 
-		//DEBUG_fading_init();
+		return false;
+	}
 
-		return ERROR_NONE;
+	bool SoundSystem::HandleResumeRequest()
+	{
+		if (!m_paused) {
+			return false;
+		}
+
+		// The regions ahead of the cursor were written before the pause:
+		// the next refill is due when the cursor reaches the next position.
+		SOUND_TRACE_INFO(TRACE_EVENT_RESUME, 0, 0, 0);
+		m_streamingBuffer->Resume();
+		m_paused = false;
+
+		return false;
 	}
 
 
 	//					STREAMING PROCEDURE
 	//
 
-	void CALLBACK SoundSystem::StreamingProcedure(HWND unnamed1, UINT unnamed2, UINT_PTR unnamed3, DWORD unnamed4)
+	void SoundSystem::StreamingProcedure()
+	{
+		while (!m_quit) {
+			StreamingStep(kWaitForever);
+		}
+	}
+
+	bool SoundSystem::StreamingStep(DWORD timeoutMs)
 	{
-		assert(s_system != nullptr);
+		// Pushing a request interrupts the wait.
+		int sigPos;
+		auto signaled = m_streamingBuffer->WaitForPosition(timeoutMs, &sigPos);
 
-		OutputDebugStringA("Streaming procedure\n");
+		// Stopping or restarting the buffer makes the signaled position obsolete.
+		auto restarted = CheckMusicRequests();
+		if (restarted) {
+			return signaled;
+		}
 
-		auto handledOne = s_system->CheckMusicRequest();
-		if (handledOne) {
-			return;
+		if (signaled) {
+			CheckSoundBufferUpdate(sigPos);
 		}
 
-		s_system->CheckSoundBufferUpdate();
+		return signaled;
 	}
 }
\ No newline at end of file
@@ -1,25 +1,106 @@
 #pragma once
 
-#pragma comment(lib,"winmm.lib")
-#pragma comment(lib,"dsound.lib")
-#pragma comment(lib,"dxguid.lib")
-
 #include "framework.h"
 
 #include "StreamingBuffer.h"
+#include "OutputDevice.h"
+
+// Streaming thread
+#include <atomic>
+#include <thread>
 
 // Music Request Queue
-#include <ppl.h>
-#include <concurrent_queue.h>
+#include "CommandRing.h"
 #include "MusicRequest.h"
 
-#include "AudioFileReader.h"
+#include "AssetCache.h"
+#include "AssetPack.h"
+#include "AssetRegistry.h"
+#include "AudioFormat.h"
+#include "HealthMetrics.h"
+#include "LatencyController.h"
+#include "Mixer.h"
 
 namespace sound {
 
+	class SimulatedDevice;
 	class SoundSystem;
 
-	Error	CreateSoundSystem(IN HWND window, OUT SoundSystem **system);
+	// SoundSystemDesc holds the settings of a sound system.
+	struct SoundSystemDesc {
+		// Format of the streaming buffer. The files played are converted to it.
+		WAVEFORMATEX	format{ DefaultWaveFormat() };
+
+		// Budget of the cache that keeps the files of the assets played to their end mapped
+		// in memory, so that playing them again opens no file. Zero disables the cache.
+		size_t	cacheBudgetBytes{ 32 << 20 };
+
+		// Number of sounds that can play at the same time, on top of the music.
+		int		maxSounds{ 63 };
+
+		// Quality of the conversion of the files that are not at the sample rate of the buffer.
+		RESAMPLER_QUALITY	resamplerQuality{ RESAMPLER_QUALITY_MEDIUM };
+
+		// Duration of the streaming buffer, in milliseconds, and number of regions it is
+		// refilled by. A sound starts about latencyMs after PlaySound; a music starts
+		// right away. Shorter regions mean more frequent refills, each with a closer deadline.
+		DWORD	latencyMs{ 80 };
+		int		numRegions{ 4 };
+
+		// With an adaptive latency, the buffer holds up to maxLatencyMs, in regions of
+		// latencyMs / numRegions. The latency starts at latencyMs, grows after an underrun
+		// or a refill that nearly missed its deadline, and shrinks back after a stable period.
+		bool	adaptiveLatency{ false };
+		DWORD	maxLatencyMs{ 400 };
+
+		// Asset pack (see AssetPack.h) mapped at creation. The files it holds are played
+		// from it, under the names they were packed with; the others are read from the disk.
+		// The creation fails if the pack cannot be opened.
+		const char	*packFilename{ nullptr };
+
+		// Number of assets that can be registered (see SoundSystem::Register).
+		size_t	maxAssets{ 1024 };
+	};
+
+	// A sound system streams audio from a dedicated thread, started by CreateSoundSystem
+	// and stopped by DestroySoundSystem.
+
+#ifdef _WIN32
+	// CreateSoundSystem creates a sound system that plays through DirectSound.
+	Error	CreateSoundSystem(IN HWND window, OUT SoundSystem **system, IN const SoundSystemDesc &desc = SoundSystemDesc());
+#endif
+
+	// CreateSoundSystem creates a sound system that plays through the given device,
+	// for instance one of the headless devices.
+	// The system takes ownership of the device, even if the creation fails.
+	Error	CreateSoundSystem(IN OutputDevice *device, OUT SoundSystem **system, IN const SoundSystemDesc &desc = SoundSystemDesc());
+
+	// CreateOfflineSoundSystem creates a sound system without a streaming thread, that renders
+	// its requests as fast as the CPU allows when Render is called.
+	// The device must have a manual clock (DEVICE_CLOCK_MANUAL), which Render moves.
+	// The system takes ownership of the device, even if the creation fails.
+	Error	CreateOfflineSoundSystem(IN SimulatedDevice *device, OUT SoundSystem **system, IN const SoundSystemDesc &desc = SoundSystemDesc());
+
+	// A request of a render script and the frame it takes effect at.
+	struct RenderCommand {
+		DWORD			frame;
+		MusicRequest	request;
+	};
+
+	// RenderOffline renders a script of requests into a WAV file of numFrames frames
+	// in desc.format, as fast as the CPU allows. The output only depends on the script
+	// and the files played: the same script renders the same file.
+	// The assets are registered before the first command, in order: the handle of
+	// assetPaths[i] is i + 1. Fails if one of them cannot be registered.
+	//
+	// PRECONDITIONS
+	//	The asset paths are distinct.
+	//	The commands are sorted by frame.
+	//
+	Error	RenderOffline(IN const char *wavFilename, IN const char *const *assetPaths, IN size_t numAssets,
+		IN const RenderCommand *commands, IN size_t numCommands,
+		IN DWORD numFrames, IN const SoundSystemDesc &desc = SoundSystemDesc());
+
 	void	DestroySoundSystem(IN OUT SoundSystem **system);
 
 	class SoundSystem {
@@ -29,84 +110,281 @@ namespace sound {
 		//			MANIPULATORS
 		//
 
+		// Register resolves an audio file once and returns the handle that the Play
+		// functions take: it is looked up in the asset pack, or its header is checked.
+		// Registering a file again returns the same handle.
+		// It can be called from any thread, but it reads the disk: register the assets
+		// up front, rather than right before playing them.
+		// Returns ERROR_FAILURE if the file is neither in the pack nor a supported audio file,
+		// or if desc.maxAssets assets are registered already.
+		Error Register(const char *filename, OUT AssetHandle *asset);
+
 		// Play tries to opens a music file and play its content.
+		// The file is a WAV file or a headerless file in the DefaultWaveFormat.
+		// It is resampled if its sample rate is not the one of the buffer.
+		// The request is handled asynchronously by the streaming thread.
+		// Returns ERROR_FAILURE if the request queue is full or the handle is invalid.
+		Error Play(AssetHandle asset);
+
+		// PlayWithCrossfade plays a music file like Play, but the current music goes on
+		// and fades out while the new one fades in, over fadeMs milliseconds.
+		// The buffer is not restarted: the crossfade starts with the next refill.
+		// If no music is playing, the new music starts like with Play.
+		Error PlayWithCrossfade(AssetHandle asset, DWORD fadeMs, FADE_CURVE curve = FADE_CURVE_EXPONENTIAL);
+
+		// PlayLooped plays a music file like Play, but the music loops forever from
+		// loopEndFrame back to loopStartFrame, without a gap and without reading the file again.
+		// The frames are frames of the file. An end past the audio data is the end of the data.
+		// If the loop is empty, the music plays once.
+		// Returns ERROR_FAILURE if the request queue is full or the handle is invalid.
+		Error PlayLooped(AssetHandle asset, DWORD loopStartFrame, DWORD loopEndFrame);
+
+		// PlayNext queues a music file to play right after the current music, without a gap:
+		// it starts on the frame that follows the last frame of the current music.
+		// The file is opened and its first chunk loaded while the current music plays.
+		// A music queued earlier is replaced. If the current music ended already, the file starts
+		// with the next refill. Without a current music, the file plays like with Play.
+		// Returns ERROR_FAILURE if the request queue is full or the handle is invalid.
+		Error PlayNext(AssetHandle asset);
+
+		// PlaySound plays a sound file once, mixed with the music and the other sounds.
+		// The sound starts with the next refill of the streaming buffer.
+		// If all the sound voices are playing, the request is ignored.
+		// Returns ERROR_FAILURE if the request queue is full or the handle is invalid.
+		Error PlaySound(AssetHandle asset);
+
+		// These versions register the file first (see Register), then play it.
+		// They also fail if the file cannot be registered.
 		Error Play(const char *filename);
+		Error PlayWithCrossfade(const char *filename, DWORD fadeMs, FADE_CURVE curve = FADE_CURVE_EXPONENTIAL);
+		Error PlayLooped(const char *filename, DWORD loopStartFrame, DWORD loopEndFrame);
+		Error PlayNext(const char *filename);
+		Error PlaySound(const char *filename);
+
+		// Stop stops the music. The sounds playing go on.
+		// Returns ERROR_FAILURE if the request queue is full.
+		Error Stop();
+
+		// Pause freezes the whole output, the music and the sounds: the buffer stops where
+		// its play cursor is, with the data written ahead and the voices kept as they are.
+		// Nothing is read or mixed while the output is paused. The requests are still handled:
+		// a sound played meanwhile is heard after Resume, and a new music ends the pause.
+		// Pausing a system that plays nothing does nothing.
+		// Returns ERROR_FAILURE if the request queue is full.
+		Error Pause();
+
+		// Resume plays the paused output from where it stopped, without a gap and without
+		// reading a file: the data written before the pause comes first.
+		// Returns ERROR_FAILURE if the request queue is full.
+		Error Resume();
+
+		// Render plays numFrames frames of an offline system: it handles the requests pushed
+		// since the last call, then moves the play cursor of the device and refills the buffer
+		// each time the cursor reaches a notification position, as the streaming thread would.
+		// The requests therefore take effect at the first frame rendered by the next call.
+		// Returns ERROR_FAILURE if the system is not an offline one.
+		Error Render(DWORD numFrames);
+
+		//			ACCESSORS
+		//
+
+		// IsPlaying returns true iff the streaming buffer is playing music or sounds.
+		bool IsPlaying() const { return m_playing; }
+
+		// IsPaused returns true iff the streaming thread handled a Pause, and the output
+		// did not play again since then.
+		bool IsPaused() const { return m_paused; }
+
+		// LatencyMs returns the current latency target: the time between the refill
+		// that mixes a new sound and the moment it is heard, in milliseconds.
+		// It can be called from any thread.
+		DWORD LatencyMs() const { return m_latencyMs; }
+
+		// Health returns a copy of the streaming health metrics: underruns, near misses,
+		// and the histograms of the refill durations, read latencies and wakeup jitter.
+		// It can be called from any thread; the streaming thread never waits for it.
+		HealthSnapshot Health() const { return m_health.Snapshot(); }
+
+		// CacheStats returns the counters of the asset cache.
+		// It can be called from any thread.
+		AssetCacheStats CacheStats() const { return m_cache.Stats(); }
 
 
 	private:
 		// Creation and destruction is managed by the CreateSoundSystem and DestroySoundSystem functions.
-		friend Error	CreateSoundSystem(IN HWND window, OUT SoundSystem **system);
+#ifdef _WIN32
+		friend Error	CreateSoundSystem(IN HWND window, OUT SoundSystem **system, IN const SoundSystemDesc &desc);
+#endif
+		friend Error	CreateSoundSystem(IN OutputDevice *device, OUT SoundSystem **system, IN const SoundSystemDesc &desc);
+		friend Error	CreateOfflineSoundSystem(IN SimulatedDevice *device, OUT SoundSystem **system, IN const SoundSystemDesc &desc);
+		friend Error	RenderOffline(IN const char *wavFilename, IN const char *const *assetPaths, IN size_t numAssets,
+			IN const RenderCommand *commands, IN size_t numCommands,
+			IN DWORD numFrames, IN const SoundSystemDesc &desc);
 		friend void		DestroySoundSystem(IN OUT SoundSystem **system);
-		SoundSystem(HWND window);
+		SoundSystem(OutputDevice *device, const SoundSystemDesc &desc);
 		~SoundSystem();
 
-		// CheckMusicRequest looks if the music request queue is not empty and
-		// handles one request.
+		// StartStreamingThread creates the thread that runs the streaming procedure.
+		// Throws if the thread cannot be created.
+		void StartStreamingThread();
+
+		// StopStreamingThread asks the streaming thread to quit and waits for it.
+		void StopStreamingThread();
+
+		// PushRequest adds a request to the queue and wakes up the streaming thread.
+		// It can be called from any thread.
+		Error PushRequest(const MusicRequest &req);
+
+		// PushAssetRequest pushes a request that plays an asset, if its handle is valid.
+		Error PushAssetRequest(const MusicRequest &req);
+
+		// CheckMusicRequests empties the music request queue and handles the requests
+		// that are not superseded by a later one.
 		//
 		// RETURN VALUE
-		//	Returns true iff a request was handled. If that is the case then there is
-		// no need to check for an update in the sound buffer.
+		//	Returns true iff the streaming buffer was stopped or restarted. If that is the case
+		// then the signaled notification position is obsolete.
 		//
-		bool CheckMusicRequest();
+		bool CheckMusicRequests();
 
-		// CheckSoundBufferUpdate looks if a notification position in the streaming buffer
-		// was signaled. If so, the function transfers audio data from the file to the buffer.
-		// The function does nothing if there is no music playing.
-		void CheckSoundBufferUpdate();
+		// HandleMusicRequest handles one request.
+		// Returns true iff the streaming buffer was stopped or restarted.
+		bool HandleMusicRequest(const MusicRequest &req);
 
-		// StopPlaying stops the current music being played by the sound buffer and
-		// closes the associated audio file.
+		// CheckSoundBufferUpdate mixes the voices into the buffer
+		// after the notification position sigPos was signaled.
+		// Once no voice is playing and the last data mixed was played, the buffer is stopped.
+		// The deadline slack of the refill is reported to the latency controller.
+		// The function does nothing if the buffer is not playing.
+		void CheckSoundBufferUpdate(int sigPos);
+
+		// StopPlaying stops the streaming buffer and all the voices.
 		void StopPlaying();
 
+		// StartPlaying fills the buffer up to the start of the region m_lead with the mix of the
+		// playing voices and starts to play it from the beginning.
 		void StartPlaying();
 
-		// TransferOneDataChuck process a next audio data chunk that will be written
-		// in a buffer region.
-		// The data is first read from the file, then some fading effect can be applied
-		// if fading is enabled and, finally, the data is copied into a buffer's region.
-		// The region depends on the signaled position parameter.
-		void TransferOneDataChuck(int sigPos);
+		// TransferOneDataChuck mixes the next chunk of the voices into a buffer region.
+		// Returns true iff no voice was playing, in which case the region is filled with silence.
+		bool TransferOneDataChuck(int region);
 
-		// RegionToUpdate returns the region that can safely receives a data chunk
-		// based on which notification position was signaled.
+		// RegionToUpdate returns the region that receives the next data chunk
+		// based on which notification position was signaled: it is m_lead regions ahead.
 		int RegionToUpdate(int sigPos);
 
-		// OnReadError handles an read error from the audio file reader.
-		// EOF is considered as a read error.
-		// If the error is not EOF, this function will stop the music.
-		void OnReadError(Error err, int sigPos);
+		// FirstChunkSize returns the size of the chunk that starts the buffer:
+		// it fills the buffer up to the start of the region m_lead.
+		DWORD FirstChunkSize() const;
+
+		// UpdateLatencyMs publishes the latency of the current lead.
+		void UpdateLatencyMs();
 
-		void OnEOF(int sigPos);
+		// BytesToNanoseconds returns the time the buffer takes to play numBytes.
+		uint64_t BytesToNanoseconds(DWORD numBytes) const;
+
+		// OpenVoice opens a registered asset in a voice.
+		// startsWithRefill is true iff the first chunk read is a refill of a region,
+		// rather than the chunk that starts the buffer.
+		Error OpenVoice(Voice *voice, AssetHandle asset, bool startsWithRefill);
+
+		// OpenMusic opens the music file of a request in a music voice,
+		// and sets the loop of the request, if any.
+		Error OpenMusic(Voice *voice, const MusicRequest &req, bool startsWithRefill);
 
 		// HandlePlayRequest handles a MusicRequest of type PLAY.
-		Error HandlePlayRequest(const char *filename);
+		// Without a crossfade, the buffer is restarted with the new music.
+		// The sounds playing go on.
+		// Returns true iff the buffer was stopped or restarted.
+		bool HandlePlayRequest(const MusicRequest &req);
+
+		// HandleCrossfade starts to play a music while the current one fades out.
+		// The buffer keeps playing.
+		void HandleCrossfade(const MusicRequest &req);
+
+		// HandlePlayNextRequest handles a MusicRequest of type PLAY_NEXT.
+		// Returns true iff the buffer was restarted, because no music was playing.
+		bool HandlePlayNextRequest(const MusicRequest &req);
+
+		// HandleStopRequest handles a MusicRequest of type STOP.
+		// The sounds playing go on.
+		// Returns true iff the buffer was stopped, because no sound was playing.
+		bool HandleStopRequest();
+
+		// HandlePlaySoundRequest handles a MusicRequest of type PLAY_SOUND.
+		// Returns true iff the buffer was started, because it was not playing.
+		bool HandlePlaySoundRequest(AssetHandle asset);
+
+		// HandlePauseRequest handles a MusicRequest of type PAUSE.
+		// The buffer stops but keeps its play cursor and its data: a position signaled
+		// before the pause is still refilled.
+		// Returns false.
+		bool HandlePauseRequest();
+
+		// HandleResumeRequest handles a MusicRequest of type RESUME.
+		// The buffer plays on from its play cursor: nothing is read or mixed.
+		// Returns false.
+		bool HandleResumeRequest();
 
 	private:
 		//					STREAMING PROCEDURE
 		//
 
-		// A Windows timer to constantly call the streaming procedure.
-		static const UINT_PTR	kTimerId = 1;
-		static void CALLBACK	StreamingProcedure(HWND unnamed1, UINT unnamed2, UINT_PTR unnamed3, DWORD unnamed4);
+		// StreamingProcedure is the body of the streaming thread.
+		// It sleeps until the play cursor crosses a notification position or
+		// a request is pushed, and handles whichever happened.
+		void StreamingProcedure();
+
+		// StreamingStep runs one iteration of the streaming procedure.
+		// It waits at most timeoutMs for something to do.
+		// Returns true iff a notification position was signaled.
+		bool StreamingStep(DWORD timeoutMs);
+
+		std::thread				m_streamingThread;
+		std::atomic<bool>		m_quit{ false };
 
+		OutputDevice			*m_device{ nullptr };
 
-		HWND					m_window{ nullptr };
-		LPDIRECTSOUND8			m_directSound{ nullptr };
-		LPDIRECTSOUNDBUFFER		m_primaryBuffer{ nullptr };
+		// The device of an offline system, whose clock Render moves, or nullptr.
+		SimulatedDevice			*m_offlineDevice{ nullptr };
 
 		//		Streaming
 		//
 		
 		StreamingBuffer		*m_streamingBuffer{ nullptr };
-		bool				m_playing{ false };
-		int					m_sigPosAtEOF{ 0 };
-		bool				m_atEOF{ false };
+		std::atomic<bool>	m_playing{ false };
 
-		using MusicRequestQueue = concurrency::concurrent_queue<MusicRequest>;
+		// The buffer is stopped by a pause: m_playing stays true.
+		std::atomic<bool>	m_paused{ false };
+
+		// Number of refills in a row in which no voice was playing.
+		int					m_numSilentRefills{ 0 };
+
+		// Number of regions between the play cursor and the refills, picked by m_latency.
+		// It is only touched by the streaming thread, and shrinks by one region per refill at most.
+		static const DWORD		kStablePeriodMs = 2000;
+		LatencyController		m_latency;
+		int						m_lead{ 1 };
+		std::atomic<DWORD>		m_latencyMs{ 0 };
+
+		// Written by the streaming thread, read by any thread.
+		HealthMetrics			m_health;
+
+		// Requests are pushed by any thread and popped by the streaming thread.
+		static const size_t kMaxPendingRequests = 64;
+		using MusicRequestQueue = CommandRing<MusicRequest, kMaxPendingRequests>;
 		MusicRequestQueue	m_requests;
 
-		std::string				m_filename;
-		std::ifstream			m_audioFile;
-		sound::AudioFileReader	m_fileReader;
+		// Number of chunks the file reader keeps ready ahead of the refills.
+		static const int		kNumReadAheadChunks = 2;
+
+		AssetCache				m_cache;
+		AssetPack				m_pack;
+
+		// Filled by Register, read by the streaming thread.
+		AssetRegistry			m_assets;
+
+		// Allocated by the constructor, once the size of the refills is known.
+		Mixer					*m_mixer{ nullptr };
 	};
 }
\ No newline at end of file
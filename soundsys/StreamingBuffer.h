@@ -1,9 +1,10 @@
 #pragma once
 
 #include "framework.h"
-#include <array>
+#include <vector>
 
 #include "Range.h"
+#include "OutputDevice.h"
 
 // TOOD: replace code that uses Result with Error.
 using Result = int;
@@ -17,33 +18,55 @@ namespace sound {
 	public:
 		DISALLOW_COPY_AND_ASSIGN(StreamingBuffer);
 
-		StreamingBuffer(LPDIRECTSOUND8 directSound, int numSeconds, std::array<int, 2> notifyPositions);
+		// Maximum number of regions: DirectSound waits on one event per region, plus one.
+		static constexpr int kMaxRegions = 32;
 
-		~StreamingBuffer();
+		// The streaming buffer creates its looping buffer in the device.
+		// The buffer holds latencyMs milliseconds of audio, split in numRegions regions
+		// of the same size. A region holds at least 2 frames.
+		// The device must outlive the streaming buffer.
+		// Throws if the format is not supported (see IsSupportedFormat), or if
+		// numRegions is not in [2, kMaxRegions].
+		StreamingBuffer(OutputDevice *device, const WAVEFORMATEX &format, DWORD latencyMs, int numRegions);
 
 
 		//					ACCESSORS
 		//
 
 		// Capacity returns the maximum number of bytes that can be stored in the buffer.
-		DWORD Capacity() const { return m_desc.dwBufferBytes; }
+		DWORD Capacity() const { return m_capacity; }
+
+		// Format returns the format of the audio data written in the buffer.
+		const WAVEFORMATEX &Format() const { return m_wavFormat; }
+
+		// NumRegions returns the number of regions, and of notification positions.
+		int NumRegions() const { return static_cast<int>(m_regions.size()); }
 
 		// RegionSize returns the number of bytes occupied by a region.
-		//
-		// PRECONDTIONS
-		//	region == 0 or 1
-		//
-		DWORD RegionSize(int region);
+		// All the regions have the same size, a whole number of frames.
+		DWORD RegionSize() const { return m_regionSize; }
 
 		// RegionStart returns the byte offset of the region from the start of the buffer.
+		// The last region wraps around the end of the buffer.
 		//
 		// PRECONDTIONS
-		//	region == 0 or 1
+		//	0 <= region < NumRegions()
 		//
-		DWORD RegionStart(int region);
+		DWORD RegionStart(int region) const;
+
+		// DistanceToRegion returns the number of bytes the play cursor has to play before
+		// reaching the start of the region. It is larger than Capacity() - RegionSize()
+		// iff the cursor is inside the region.
+		DWORD DistanceToRegion(int region);
+
+		// WaitForPosition blocks until the play cursor crosses a notification position,
+		// the timeout expires or the device wait is interrupted.
+		// Returns true iff a position was crossed; *pos is then the region whose start was crossed.
+		bool WaitForPosition(DWORD timeoutMs, int *pos);
 
-		// 
-		bool APositionWasSignaled(int *pos);
+		// APositionWasSignaled returns true iff a notification position was crossed,
+		// without blocking.
+		bool APositionWasSignaled(int *pos) { return WaitForPosition(0, pos); }
 
 
 		//					MANIPULATORS
@@ -55,10 +78,14 @@ namespace sound {
 		// Stops to generate sound from the audio data.
 		void Stop();
 
-		// WriteToRegion fills either region 0 or 1 with bytes.
+		// Generates sound again from where Stop left the play cursor.
+		// The audio data is played as it was written.
+		void Resume();
+
+		// WriteToRegion fills a region with bytes.
 		//
 		// PRECONDITIONS
-		//	region == 0 || region == 1
+		//	0 <= region < NumRegions()
 		//
 		// INPUT
 		//	void *src:
@@ -75,66 +102,40 @@ namespace sound {
 
 		// These functions are only called by the constructor.
 		// They all throw if an error occured.
-		void CreateWAVFormat();
-		void CreateDesc();
-		void CreateRegions();
-		void CreateUnderlyingDirectSoundBuffer(LPDIRECTSOUND8 directSound);
-		void CreateEvents();
-		void SendNotificationPositions();
+		void CreateWAVFormat(const WAVEFORMATEX &format);
+		void CreateRegions(DWORD latencyMs, int numRegions);
+		void CreateDeviceBuffer();
 		
 
 		//					REGIONS
 		//
 
-		//
-		struct MemorySpan {
-			LPVOID	begin{ nullptr };
-			DWORD	length{ 0 };
-		};
-
-		struct DSBufferMemoryRegion {
-			std::array<MemorySpan, 2>	span;
-		};
-
-		//// LockRegion locks a region of memory in the DirectSound buffer
-		//// in order to write to it.
-		//Result LockRegion(IN int region, OUT DSBufferMemoryRegion *memory);
-
 		// LockMemory locks a span of memory in the buffer.
-		Result LockMemory(IN DWORD offset, IN DWORD size, DSBufferMemoryRegion *memory);
+		Result LockMemory(IN DWORD offset, IN DWORD size, DeviceMemoryRegion *memory);
 
-		Result UnlockMemory(const DSBufferMemoryRegion &memory);
+		Result UnlockMemory(const DeviceMemoryRegion &memory);
 
 	private:
-		// The underlying DirectSound buffer.
-		LPDIRECTSOUNDBUFFER		m_DSBuffer{ nullptr };
+		// The device that owns the underlying looping buffer.
+		OutputDevice	*m_device;
 
-		// Number of seconds that corresponds to the buffer capacity.
-		int				m_numSeconds;
-		
 		WAVEFORMATEX	m_wavFormat;
-		DSBUFFERDESC	m_desc;
+		DWORD			m_capacity{ 0 };
+		DWORD			m_regionSize{ 0 };
 
-		std::array<HANDLE, 2>	m_events{ 0, 0 };
-		
-		// Notification positions.
-		// Expressed in percentage of the "buffer duration".
-		// Valid range: from 0 to 100.
-		// EXAMPLE
-		//	25 means 25%
-		std::array<int, 2>	m_notifPos;
-
-		// The two regions defined the two notification positions.
+		// The regions, whose starts are the notification positions.
+		// They are shifted by half a region, so that no position is at offset 0,
+		// where the play cursor is when the buffer starts to play. With 4 regions:
 		//
-		// 0%             25%                              75%              100%
-		// |---------------|--------------------------------|----------------|
-		// |               |                                |                |
-		// |    Region 1   |            Region 0            |    Region 1    |
-		// |               |                                |                |
-		//  ---------------|--------------------------------|----------------
-		//               pos 0                            pos 1
+		// 0                                                            capacity
+		// |-------|---------------|---------------|---------------|-------|
+		// |       |               |               |               |       |
+		// |  R3   |    Region 0   |    Region 1   |    Region 2   |  R3   |
+		// |       |               |               |               |       |
+		//  -------|---------------|---------------|---------------|-------
+		//       pos 0           pos 1           pos 2           pos 3
 		//
 		using Region = Range<DWORD>;
-		std::array<Region, 2>		m_regions;
+		std::vector<Region>		m_regions;
 	};
 }
\ No newline at end of file
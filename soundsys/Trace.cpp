@@ -0,0 +1,244 @@
+#include "pch.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace sound {
+
+	// Trace files start with this signature and a version, followed by the number of records
+	// and the records, each in 4 64-bit words in the byte order of the machine.
+	static const char kTraceSignature[8] = { 'S', 'N', 'D', 'T', 'R', 'A', 'C', 'E' };
+	static const uint32_t kTraceVersion = 1;
+
+	static const char *kEventNames[TRACE_EVENT_COUNT] = {
+		"REQUEST",
+		"PLAY",
+		"STOP",
+		"REFILL",
+		"WRITE",
+		"UNDERRUN",
+		"LATENCY",
+		"READ_STALL",
+		"READ_ERROR",
+		"NO_FREE_VOICE",
+		"PAUSE",
+		"RESUME"
+	};
+
+	// The names of the arguments of each event. Unnamed arguments are not printed.
+	struct EventArgs {
+		const char	*names[3];
+	};
+
+	static const EventArgs kEventArgs[TRACE_EVENT_COUNT] = {
+		{ { "type", nullptr, nullptr } },
+		{ { nullptr, "bytes", nullptr } },
+		{ { nullptr, nullptr, nullptr } },
+		{ { "region", "lead", "silent" } },
+		{ { "offset", "bytes", "spans" } },
+		{ { "region", "distance", nullptr } },
+		{ { "lead", "ms", nullptr } },
+		{ { nullptr, "stalls", nullptr } },
+		{ { "error", nullptr, nullptr } },
+		{ { "voices", nullptr, nullptr } },
+		{ { nullptr, nullptr, nullptr } },
+		{ { nullptr, nullptr, nullptr } }
+	};
+
+	static void Pack(const TraceRecord &record, uint64_t words[4])
+	{
+		words[0] = record.timeNs;
+		words[1] = static_cast<uint64_t>(record.event)
+			| (static_cast<uint64_t>(record.level) << 16)
+			| (static_cast<uint64_t>(record.arg0) << 32);
+		words[2] = record.arg1;
+		words[3] = record.arg2;
+	}
+
+	static TraceRecord Unpack(const uint64_t words[4])
+	{
+		TraceRecord record{};
+		record.timeNs = words[0];
+		record.event = static_cast<uint16_t>(words[1] & 0xFFFF);
+		record.level = static_cast<uint8_t>((words[1] >> 16) & 0xFF);
+		record.arg0 = static_cast<uint32_t>(words[1] >> 32);
+		record.arg1 = words[2];
+		record.arg2 = words[3];
+
+		return record;
+	}
+
+
+	//					RING
+	//
+
+	void TraceRing::Push(TRACE_LEVEL level, TRACE_EVENT event, uint32_t arg0, uint64_t arg1, uint64_t arg2)
+	{
+		const auto now = std::chrono::steady_clock::now().time_since_epoch();
+
+		TraceRecord record{};
+		record.timeNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+		record.event = static_cast<uint16_t>(event);
+		record.level = static_cast<uint8_t>(level);
+		record.arg0 = arg0;
+		record.arg1 = arg1;
+		record.arg2 = arg2;
+
+		uint64_t words[kNumWords];
+		Pack(record, words);
+
+		// Claim the next record: a writer that laps a slow one makes the slot unreadable
+		// until the last of them is done.
+		const auto index = m_next.fetch_add(1, std::memory_order_relaxed);
+		auto &slot = m_slots[index & kMask];
+
+		slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (int i = 0; i < kNumWords; i++) {
+			slot.words[i].store(words[i], std::memory_order_relaxed);
+		}
+
+		slot.sequence.store(2 * index + 2, std::memory_order_release);
+	}
+
+	size_t TraceRing::Snapshot(TraceRecord *records, size_t maxRecords) const
+	{
+		const auto end = m_next.load(std::memory_order_acquire);
+		auto numRecords = std::min<uint64_t>(std::min<uint64_t>(end, kCapacity), maxRecords);
+
+		size_t count = 0;
+		for (auto index = end - numRecords; index < end; index++) {
+			const auto &slot = m_slots[index & kMask];
+
+			// The record is complete and was not overwritten while it was copied.
+			auto before = slot.sequence.load(std::memory_order_acquire);
+			if (before != 2 * index + 2) {
+				continue;
+			}
+
+			uint64_t words[kNumWords];
+			for (int i = 0; i < kNumWords; i++) {
+				words[i] = slot.words[i].load(std::memory_order_relaxed);
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) != before) {
+				continue;
+			}
+
+			records[count++] = Unpack(words);
+		}
+
+		return count;
+	}
+
+	TraceRing &GlobalTraceRing()
+	{
+		static TraceRing ring;
+		return ring;
+	}
+
+
+	//					DECODING
+	//
+
+	const char *TraceEventName(uint16_t event)
+	{
+		return (event < TRACE_EVENT_COUNT) ? kEventNames[event] : "UNKNOWN";
+	}
+
+	const char *TraceLevelName(uint8_t level)
+	{
+		switch (level) {
+		case TRACE_LEVEL_ERROR:		return "ERROR";
+		case TRACE_LEVEL_WARNING:	return "WARNING";
+		case TRACE_LEVEL_INFO:		return "INFO";
+		case TRACE_LEVEL_VERBOSE:	return "VERBOSE";
+		default:					return "UNKNOWN";
+		}
+	}
+
+	std::string DescribeTraceRecord(const TraceRecord &record, uint64_t startNs)
+	{
+		const auto ms = (record.timeNs - startNs) / 1e6;
+
+		static const char *kUnknownArgs[3] = { "arg0", "arg1", "arg2" };
+		const auto *names = (record.event < TRACE_EVENT_COUNT) ? kEventArgs[record.event].names : kUnknownArgs;
+		const unsigned long long values[3] = { record.arg0, record.arg1, record.arg2 };
+
+		std::string args;
+		for (int i = 0; i < 3; i++) {
+			if (names[i]) {
+				char arg[64];
+				snprintf(arg, sizeof(arg), "%s%s=%llu", args.empty() ? "" : " ", names[i], values[i]);
+				args += arg;
+			}
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "%12.3f ms  %-7s  %-13s  %s",
+			ms, TraceLevelName(record.level), TraceEventName(record.event), args.c_str());
+
+		return line;
+	}
+
+
+	//					FILES
+	//
+
+	Error WriteTraceFile(const char *filename)
+	{
+		std::vector<TraceRecord> records(TraceRing::kCapacity);
+		records.resize(GlobalTraceRing().Snapshot(records.data(), records.size()));
+
+		std::ofstream file(filename, std::ios::binary);
+		if (!file) {
+			return ERROR_FAILURE;
+		}
+
+		const auto count = static_cast<uint32_t>(records.size());
+		file.write(kTraceSignature, sizeof(kTraceSignature));
+		file.write((const char *)&kTraceVersion, sizeof(kTraceVersion));
+		file.write((const char *)&count, sizeof(count));
+
+		for (const auto &record : records) {
+			uint64_t words[4];
+			Pack(record, words);
+			file.write((const char *)words, sizeof(words));
+		}
+
+		return file ? ERROR_NONE : ERROR_FAILURE;
+	}
+
+	Error ReadTraceFile(const char *filename, std::vector<TraceRecord> *records)
+	{
+		assert(records != nullptr);
+
+		std::ifstream file(filename, std::ios::binary);
+
+		char signature[sizeof(kTraceSignature)];
+		uint32_t version = 0;
+		uint32_t count = 0;
+		file.read(signature, sizeof(signature));
+		file.read((char *)&version, sizeof(version));
+		file.read((char *)&count, sizeof(count));
+		if (!file || std::memcmp(signature, kTraceSignature, sizeof(signature)) != 0 || version != kTraceVersion) {
+			return ERROR_FAILURE;
+		}
+
+		records->clear();
+		for (uint32_t i = 0; i < count; i++) {
+			uint64_t words[4];
+			if (!file.read((char *)words, sizeof(words))) {
+				return ERROR_READ;
+			}
+			records->push_back(Unpack(words));
+		}
+
+		return ERROR_NONE;
+	}
+}
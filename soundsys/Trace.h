@@ -0,0 +1,155 @@
+#pragma once
+
+#include "framework.h"
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Trace levels. Only the events at or below SOUND_TRACE_LEVEL are compiled in:
+// the SOUND_TRACE_* macros of the other levels expand to nothing, arguments included.
+// Release builds trace nothing unless SOUND_TRACE_LEVEL is defined.
+#define SOUND_TRACE_LEVEL_NONE		0
+#define SOUND_TRACE_LEVEL_ERROR		1
+#define SOUND_TRACE_LEVEL_WARNING	2
+#define SOUND_TRACE_LEVEL_INFO		3
+#define SOUND_TRACE_LEVEL_VERBOSE	4
+
+#ifndef SOUND_TRACE_LEVEL
+#ifdef NDEBUG
+#define SOUND_TRACE_LEVEL	SOUND_TRACE_LEVEL_NONE
+#else
+#define SOUND_TRACE_LEVEL	SOUND_TRACE_LEVEL_VERBOSE
+#endif
+#endif
+
+#define SOUND_TRACE(level, event, arg0, arg1, arg2) \
+	::sound::GlobalTraceRing().Push((level), (event), static_cast<uint32_t>(arg0), static_cast<uint64_t>(arg1), static_cast<uint64_t>(arg2))
+
+#if SOUND_TRACE_LEVEL >= SOUND_TRACE_LEVEL_ERROR
+#define SOUND_TRACE_ERROR(event, arg0, arg1, arg2)		SOUND_TRACE(::sound::TRACE_LEVEL_ERROR, event, arg0, arg1, arg2)
+#else
+#define SOUND_TRACE_ERROR(event, arg0, arg1, arg2)		((void)0)
+#endif
+
+#if SOUND_TRACE_LEVEL >= SOUND_TRACE_LEVEL_WARNING
+#define SOUND_TRACE_WARNING(event, arg0, arg1, arg2)	SOUND_TRACE(::sound::TRACE_LEVEL_WARNING, event, arg0, arg1, arg2)
+#else
+#define SOUND_TRACE_WARNING(event, arg0, arg1, arg2)	((void)0)
+#endif
+
+#if SOUND_TRACE_LEVEL >= SOUND_TRACE_LEVEL_INFO
+#define SOUND_TRACE_INFO(event, arg0, arg1, arg2)		SOUND_TRACE(::sound::TRACE_LEVEL_INFO, event, arg0, arg1, arg2)
+#else
+#define SOUND_TRACE_INFO(event, arg0, arg1, arg2)		((void)0)
+#endif
+
+#if SOUND_TRACE_LEVEL >= SOUND_TRACE_LEVEL_VERBOSE
+#define SOUND_TRACE_VERBOSE(event, arg0, arg1, arg2)	SOUND_TRACE(::sound::TRACE_LEVEL_VERBOSE, event, arg0, arg1, arg2)
+#else
+#define SOUND_TRACE_VERBOSE(event, arg0, arg1, arg2)	((void)0)
+#endif
+
+namespace sound {
+
+	enum TRACE_LEVEL {
+		TRACE_LEVEL_ERROR = SOUND_TRACE_LEVEL_ERROR,
+		TRACE_LEVEL_WARNING = SOUND_TRACE_LEVEL_WARNING,
+		TRACE_LEVEL_INFO = SOUND_TRACE_LEVEL_INFO,
+		TRACE_LEVEL_VERBOSE = SOUND_TRACE_LEVEL_VERBOSE
+	};
+
+	// The events and the meaning of their arguments.
+	// New events go at the end: the values are stored in the trace files.
+	enum TRACE_EVENT {
+		TRACE_EVENT_REQUEST,		// arg0: MUSIC_REQUEST_TYPE
+		TRACE_EVENT_PLAY,			// arg1: bytes of the first chunk
+		TRACE_EVENT_STOP,
+		TRACE_EVENT_REFILL,			// arg0: region, arg1: lead in regions, arg2: 1 iff silent
+		TRACE_EVENT_WRITE,			// arg0: offset, arg1: bytes, arg2: 2 iff the write wraps around
+		TRACE_EVENT_UNDERRUN,		// arg0: region, arg1: bytes between the cursor and the region
+		TRACE_EVENT_LATENCY,		// arg0: lead in regions, arg1: latency in ms
+		TRACE_EVENT_READ_STALL,		// arg1: number of stalls of the voice so far
+		TRACE_EVENT_READ_ERROR,		// arg0: Error
+		TRACE_EVENT_NO_FREE_VOICE,	// arg0: number of voices
+		TRACE_EVENT_PAUSE,
+		TRACE_EVENT_RESUME,
+
+		TRACE_EVENT_COUNT
+	};
+
+	// A trace event, as stored in the ring and in trace files.
+	struct TraceRecord {
+		uint64_t	timeNs;		// steady clock
+		uint16_t	event;		// TRACE_EVENT
+		uint8_t		level;		// TRACE_LEVEL
+		uint8_t		reserved;
+		uint32_t	arg0;
+		uint64_t	arg1;
+		uint64_t	arg2;
+	};
+
+	// CLASS:		TraceRing
+	//
+	// PURPOSE:		Fixed-size ring of binary trace records, written by any thread without
+	//				a lock or an allocation. When the ring is full, the oldest records are
+	//				overwritten. Each slot carries a sequence number, so that a snapshot
+	//				taken while threads write skips the records that are half written.
+	//
+	class TraceRing {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(TraceRing);
+
+		static constexpr size_t kCapacity = 4096;
+
+		TraceRing() = default;
+
+		//				ACCESSORS
+		//
+
+		// NumPushed returns the number of records pushed since the creation of the ring.
+		uint64_t NumPushed() const { return m_next.load(std::memory_order_relaxed); }
+
+		// Snapshot copies the records still in the ring, oldest first, to records.
+		// Returns the number of records copied, at most maxRecords: the most recent ones.
+		size_t Snapshot(TraceRecord *records, size_t maxRecords) const;
+
+		//				MANIPULATORS
+		//
+
+		// Push records an event. It can be called from any thread.
+		void Push(TRACE_LEVEL level, TRACE_EVENT event, uint32_t arg0, uint64_t arg1, uint64_t arg2);
+
+	private:
+		static const size_t kMask = kCapacity - 1;
+		static const int kNumWords = 4;
+
+		// The sequence number of the record i is 2i + 1 while it is written, 2i + 2 after.
+		struct Slot {
+			std::atomic<uint64_t>	sequence{ 0 };
+			std::array<std::atomic<uint64_t>, kNumWords>	words{};
+		};
+
+		std::array<Slot, kCapacity>	m_slots;
+		std::atomic<uint64_t>		m_next{ 0 };
+	};
+
+	// GlobalTraceRing returns the ring the SOUND_TRACE_* macros write to.
+	TraceRing &GlobalTraceRing();
+
+	// TraceEventName returns the name of an event, or "UNKNOWN".
+	const char *TraceEventName(uint16_t event);
+
+	// TraceLevelName returns the name of a level, or "UNKNOWN".
+	const char *TraceLevelName(uint8_t level);
+
+	// DescribeTraceRecord returns a line of text for a record:
+	// its time relative to startNs, its level, its event and its arguments.
+	std::string DescribeTraceRecord(const TraceRecord &record, uint64_t startNs);
+
+	// WriteTraceFile writes the records of the global ring to a file, oldest first.
+	Error WriteTraceFile(const char *filename);
+
+	// ReadTraceFile reads the records of a trace file.
+	Error ReadTraceFile(const char *filename, std::vector<TraceRecord> *records);
+}
@@ -0,0 +1,422 @@
+#include "pch.h"
+#include "Voice.h"
+#include "Adpcm.h"
+#include "AudioFormat.h"
+#include "SampleConversion.h"
+#include "Trace.h"
+#include "WavHeader.h"
+#include <algorithm>
+#include <cstring>
+
+namespace sound {
+
+	void Voice::SetOutputRate(DWORD samplesPerSec, RESAMPLER_QUALITY quality)
+	{
+		m_outputRate = samplesPerSec;
+		m_quality = quality;
+	}
+
+	void Voice::SetAssetPack(const AssetPack *pack)
+	{
+		m_pack = pack;
+	}
+
+	void Voice::Reserve(size_t maxFrames, const WAVEFORMATEX &format)
+	{
+		m_gains.reserve(maxFrames);
+		m_reader.Reserve(maxFrames * format.nBlockAlign);
+		m_filename.reserve(kReservedPathLength);
+
+		// A stream takes its buffer before it opens a file: it then does not allocate one.
+		if (m_streamBuffers.empty()) {
+			assert(!m_file.is_open() && !m_loopFile.is_open());
+
+			m_streamBuffers.resize(2 * kStreamBufferSize);
+			m_file.rdbuf()->pubsetbuf(m_streamBuffers.data(), kStreamBufferSize);
+			m_loopFile.rdbuf()->pubsetbuf(m_streamBuffers.data() + kStreamBufferSize, kStreamBufferSize);
+		}
+
+		// Voices have at most 2 channels.
+		m_codedBlock.reserve(AdpcmBlockSize(2, kAdpcmMaxFramesPerBlock));
+	}
+
+	Error Voice::Open(const char *filename, size_t maxFrames,
+		size_t firstChunkFrames, size_t chunkFrames, int numReadAheadChunks)
+	{
+		PackedAsset packed;
+		const auto inPack = m_pack && m_pack->Find(filename, &packed);
+
+		return OpenFile(filename, kInvalidAssetHandle, inPack ? &packed : nullptr, nullptr,
+			maxFrames, firstChunkFrames, chunkFrames, numReadAheadChunks);
+	}
+
+	Error Voice::Open(const RegisteredAsset &asset, AssetCache *cache, size_t maxFrames,
+		size_t firstChunkFrames, size_t chunkFrames, int numReadAheadChunks)
+	{
+		assert(!asset.inPack || m_pack);
+
+		return OpenFile(asset.path, asset.handle, asset.inPack ? &asset.packed : nullptr, cache,
+			maxFrames, firstChunkFrames, chunkFrames, numReadAheadChunks);
+	}
+
+	Error Voice::OpenFile(const std::string &filename, AssetHandle handle, const PackedAsset *packed, AssetCache *cache,
+		size_t maxFrames, size_t firstChunkFrames, size_t chunkFrames, int numReadAheadChunks)
+	{
+		Close();
+
+		m_handle = handle;
+		m_cache = (handle != kInvalidAssetHandle) ? cache : nullptr;
+
+		const byte *memory = nullptr;
+		size_t memorySize = 0;
+
+		// Assets of the pack are read in place from the mapped pack, already located:
+		// no file is opened and no header is parsed.
+		m_inPack = (packed != nullptr);
+
+		// Hot assets are played from memory: no file is opened.
+		if (m_cache && !m_inPack) {
+			m_asset = m_cache->Find(m_handle);
+		}
+		if (m_asset) {
+			memory = m_asset.Data();
+			memorySize = m_asset.Size();
+		}
+		// Preferably map the file: the reader then hands out the mapped pages
+		// and the only copy left is the one into the streaming buffer.
+		else if (!m_inPack && !m_mappedFile.Open(filename.c_str())) {
+			memory = m_mappedFile.Data();
+			memorySize = m_mappedFile.Size();
+		}
+
+		WavInfo info;
+		const auto inMemory = m_inPack || m_asset || m_mappedFile.IsOpen();
+		if (inMemory) {
+			if (m_inPack) {
+				info = packed->info;
+				m_audioData = packed->data;
+			}
+			else if (ParseWavHeader(memory, memorySize, &info)) {
+				DebugPrintfA("ERROR: Voice::Open() - %s is not a supported audio file!\n", filename.c_str());
+				Close();
+				return ERROR_FAILURE;
+			}
+			else {
+				m_audioData = memory + info.dataOffset;
+			}
+
+			const auto blockAlign = info.format.nBlockAlign;
+			const auto maxFileFrames = SetUpResampler(info.format, maxFrames);
+			m_reader.Reset(maxFileFrames * blockAlign, m_audioData, info.compressed ? info.codedSize : info.dataSize);
+			if (info.compressed) {
+				m_reader.SetAdpcm(info.format.nChannels, info.framesPerBlock, info.dataSize);
+			}
+		}
+		else {
+			m_file.clear();
+			m_file.open(filename, std::ios::binary);
+			if (!m_file || ParseWavHeader(&m_file, &info)) {
+				m_file.close();
+				return ERROR_FAILURE;
+			}
+
+			const auto blockAlign = info.format.nBlockAlign;
+			const auto maxFileFrames = SetUpResampler(info.format, maxFrames);
+			m_fileSource.Reset(&m_file, info.compressed ? info.codedSize : info.dataSize);
+			m_reader.Reset(maxFileFrames * blockAlign, &m_fileSource);
+			if (info.compressed) {
+				m_reader.SetAdpcm(info.format.nChannels, info.framesPerBlock, info.dataSize);
+			}
+
+			// The next chunks are read in the background while the first ones play.
+			// If the I/O thread cannot start, the chunks are simply read when needed.
+			// The resampler asks for a few frames more or less than the chunks read ahead:
+			// it gets them from two chunks, with a copy.
+			if (numReadAheadChunks > 0) {
+				m_reader.StartReadAhead(FileFrames(firstChunkFrames) * blockAlign, FileFrames(chunkFrames) * blockAlign, numReadAheadChunks);
+			}
+		}
+
+		m_dataOffset = info.dataOffset;
+		m_dataSize = info.dataSize;
+		m_framesPerBlock = info.compressed ? info.framesPerBlock : 0;
+
+		m_format = info.format;
+		if (m_resampled) {
+			m_format = MakeWaveFormat(WAVE_FORMAT_IEEE_FLOAT, info.format.nChannels, m_outputRate, 32);
+		}
+		m_filename = filename;
+		m_isOpen = true;
+		m_finished = false;
+		m_audioFrames = 0;
+
+		m_ramp.Set(1.f);
+		m_fadingOut = false;
+		m_gains.assign(maxFrames, 1.f);
+		m_ramped = false;
+
+		return ERROR_NONE;
+	}
+
+	void Voice::Close()
+	{
+		// The read-ahead thread must not outlive the file.
+		m_reader.StopReadAhead();
+		m_file.close();
+
+		// The reader is left pointing to the mapping but nothing reads it until the next Open.
+		m_mappedFile.Close();
+		m_asset.reset();
+		m_inPack = false;
+		m_audioData = nullptr;
+
+		m_isOpen = false;
+	}
+
+	void Voice::SetGain(float gain)
+	{
+		m_ramp.Set(gain);
+		m_fadingOut = false;
+	}
+
+	void Voice::RampGain(float target, size_t numFrames, FADE_CURVE curve)
+	{
+		m_ramp.Start(target, numFrames, curve);
+		m_fadingOut = false;
+	}
+
+	void Voice::FadeOut(size_t numFrames, FADE_CURVE curve)
+	{
+		m_ramp.Start(0.f, numFrames, curve);
+		m_fadingOut = true;
+	}
+
+	Error Voice::Read(size_t numFrames)
+	{
+		assert(IsOpen());
+		assert(numFrames <= m_gains.size());
+
+		m_ramped = m_ramp.Next(numFrames, m_gains.data());
+
+		// In read-ahead mode, this only waits if the I/O thread is late.
+		auto numStalls = m_reader.ReadAheadStats().numStalls;
+
+		Error err = ERROR_NONE;
+		if (m_resampled) {
+			// When the rate goes up, a small chunk can be made of the frames kept from the previous one.
+			auto numInFrames = m_resampler.InputFramesNeeded(numFrames);
+			if (numInFrames > 0) {
+				err = m_reader.Read(numInFrames * m_fileBlockAlign);
+			}
+
+			m_audioFrames = numFrames;
+			if (err) {
+				auto numAudioInFrames = (numInFrames > 0) ? m_reader.AudioSize() / m_fileBlockAlign : 0;
+				m_audioFrames = m_resampler.OutputFramesBefore(numAudioInFrames, numFrames);
+			}
+
+			ResampleChunk(numInFrames, numFrames);
+		}
+		else {
+			err = m_reader.Read(numFrames * m_format.nBlockAlign);
+			m_audioFrames = m_reader.AudioSize() / m_format.nBlockAlign;
+		}
+
+		if (m_reader.ReadAheadStats().numStalls != numStalls) {
+			SOUND_TRACE_WARNING(TRACE_EVENT_READ_STALL, 0, numStalls + 1, 0);
+		}
+
+		if (err && !m_finished) {
+			m_finished = true;
+
+			// By the time EOF is reached, all the pages of the mapped file were loaded.
+			// The mapping moves to the cache as is: nothing is copied or allocated, and the
+			// chunk just read stays valid. The voice holds the asset until it is closed.
+			if (err == ERROR_EOF && m_cache && m_mappedFile.IsOpen()) {
+				m_asset = m_cache->Insert(m_handle, &m_mappedFile);
+			}
+			else if (err != ERROR_EOF) {
+				SOUND_TRACE_ERROR(TRACE_EVENT_READ_ERROR, err, 0, 0);
+			}
+		}
+
+		// The last chunk of a fade out is mixed, then the voice is done.
+		if (m_fadingOut && !m_ramp.IsRamping()) {
+			m_finished = true;
+		}
+
+		return err;
+	}
+
+	Error Voice::SetLoop(size_t startFrame, size_t endFrame)
+	{
+		assert(IsOpen());
+
+		const auto blockAlign = m_fileBlockAlign;
+		endFrame = std::min(endFrame, m_dataSize / blockAlign);
+		if (startFrame >= endFrame) {
+			return ERROR_FAILURE;
+		}
+
+		const auto start = startFrame * blockAlign;
+		const auto end = endFrame * blockAlign;
+
+		// The body of a file in memory is read in place. The body of a file that is streamed
+		// is loaded once, from a stream of its own: the read-ahead thread uses the other one.
+		// The body of a compressed file is decoded once.
+		const byte *body = nullptr;
+		if (m_framesPerBlock > 0) {
+			if (DecodeLoopBody(startFrame, endFrame)) {
+				DebugPrintfA("ERROR: Voice::SetLoop() - Cannot read the loop of %s!\n", m_filename.c_str());
+				return ERROR_READ;
+			}
+			body = m_loopBody.data();
+		}
+		else if (m_audioData) {
+			body = m_audioData + start;
+		}
+		else {
+			m_loopFile.clear();
+			m_loopFile.open(m_filename, std::ios::binary);
+			m_loopFile.seekg(static_cast<std::streamoff>(m_dataOffset + start));
+
+			m_loopBody.resize(end - start);
+			m_loopFile.read((char *)m_loopBody.data(), m_loopBody.size());
+			const auto numRead = static_cast<size_t>(m_loopFile.gcount());
+			m_loopFile.close();
+
+			if (numRead != m_loopBody.size()) {
+				DebugPrintfA("ERROR: Voice::SetLoop() - Cannot read the loop of %s!\n", m_filename.c_str());
+				return ERROR_READ;
+			}
+			body = m_loopBody.data();
+		}
+
+		m_reader.SetLoop(body, end - start, end);
+		return ERROR_NONE;
+	}
+
+	Error Voice::DecodeLoopBody(size_t startFrame, size_t endFrame)
+	{
+		const auto numChannels = m_format.nChannels;
+		const auto fpb = m_framesPerBlock;
+		const auto blockSize = AdpcmBlockSize(numChannels, fpb);
+		const auto firstBlock = startFrame / fpb;
+		const auto numBlocks = (endFrame + fpb - 1) / fpb - firstBlock;
+
+		// The blocks are decoded in the body itself, then the frames before the loop are
+		// dropped: the body keeps its memory from a loop to the next.
+		m_loopBody.resize(numBlocks * fpb * numChannels * sizeof(int16_t));
+		auto *pcm = reinterpret_cast<int16_t *>(m_loopBody.data());
+
+		if (m_audioData) {
+			DecodeAdpcmBlocks(pcm, m_audioData + firstBlock * blockSize, numBlocks, numChannels, fpb);
+		}
+		else {
+			// A streamed file is read a block at a time, into a buffer allocated by Reserve.
+			m_loopFile.clear();
+			m_loopFile.open(m_filename, std::ios::binary);
+			m_loopFile.seekg(static_cast<std::streamoff>(m_dataOffset + firstBlock * blockSize));
+
+			m_codedBlock.resize(blockSize);
+			for (size_t i = 0; i < numBlocks; i++) {
+				m_loopFile.read((char *)m_codedBlock.data(), blockSize);
+				if (static_cast<size_t>(m_loopFile.gcount()) != blockSize) {
+					m_loopFile.close();
+					return ERROR_READ;
+				}
+				DecodeAdpcmBlocks(pcm + i * fpb * numChannels, m_codedBlock.data(), 1, numChannels, fpb);
+			}
+			m_loopFile.close();
+		}
+
+		const auto offset = (startFrame - firstBlock * fpb) * m_fileBlockAlign;
+		const auto size = (endFrame - startFrame) * m_fileBlockAlign;
+		std::memmove(m_loopBody.data(), m_loopBody.data() + offset, size);
+		m_loopBody.resize(size);
+
+		return ERROR_NONE;
+	}
+
+	void Voice::Prefetch(size_t numFrames)
+	{
+		// A cached asset is in memory already, the pack prefetched the start of its assets
+		// when it was opened, and the read-ahead thread started to read the first chunks
+		// of a file when it was opened.
+		if (!m_mappedFile.IsOpen()) {
+			return;
+		}
+
+		auto numBytes = FileFrames(numFrames) * m_fileBlockAlign;
+		if (m_framesPerBlock > 0) {
+			numBytes = (FileFrames(numFrames) + m_framesPerBlock - 1) / m_framesPerBlock * AdpcmBlockSize(m_format.nChannels, m_framesPerBlock);
+		}
+
+		m_mappedFile.Prefetch(m_dataOffset, numBytes);
+	}
+
+	const BufferData Voice::Data() const
+	{
+		if (m_resampled) {
+			return BufferData{ reinterpret_cast<const byte *>(m_outFrames.data()), m_outSize };
+		}
+
+		return m_reader.Data();
+	}
+
+	size_t Voice::SetUpResampler(const WAVEFORMATEX &fileFormat, size_t maxFrames)
+	{
+		m_fileBlockAlign = fileFormat.nBlockAlign;
+		m_fileSampleType = SampleTypeOf(fileFormat);
+
+		m_resampled = (m_outputRate != 0 && fileFormat.nSamplesPerSec != m_outputRate);
+		if (!m_resampled) {
+			return maxFrames;
+		}
+
+		const auto numChannels = fileFormat.nChannels;
+		m_resampler.Init(fileFormat.nSamplesPerSec, m_outputRate, numChannels, m_quality, maxFrames);
+
+		const auto maxFileFrames = m_resampler.MaxInputFrames();
+		m_inFrames.assign(maxFileFrames * numChannels, 0.f);
+		m_outFrames.assign(maxFrames * numChannels, 0.f);
+		m_outSize = 0;
+
+		return maxFileFrames;
+	}
+
+	size_t Voice::FileFrames(size_t numFrames) const
+	{
+		if (!m_resampled) {
+			return numFrames;
+		}
+
+		return static_cast<size_t>(static_cast<uint64_t>(numFrames) * m_resampler.InputRate() / m_outputRate);
+	}
+
+	void Voice::ResampleChunk(size_t numInFrames, size_t numFrames)
+	{
+		const auto *data = m_reader.Data().ptr;
+		const auto numChannels = m_resampler.NumChannels();
+		const auto numSamples = numInFrames * numChannels;
+
+		// The reader pads the chunk with zeros past EOF: the end of the stream fades
+		// into silence like any other signal.
+		switch (m_fileSampleType) {
+		case SAMPLE_TYPE_S16: {
+			ConvertS16ToF32(m_inFrames.data(), reinterpret_cast<const int16_t *>(data), numSamples);
+		}break;
+
+		case SAMPLE_TYPE_S24: {
+			ConvertS24ToF32(m_inFrames.data(), data, numSamples);
+		}break;
+
+		default: {
+			std::memcpy(m_inFrames.data(), data, numSamples * sizeof(float));
+		}break;
+		}
+
+		m_resampler.Process(m_inFrames.data(), numInFrames, m_outFrames.data(), numFrames);
+		m_outSize = numFrames * numChannels * sizeof(float);
+	}
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include "framework.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "AssetCache.h"
+#include "AssetPack.h"
+#include "AssetRegistry.h"
+#include "AudioFormat.h"
+#include "GainRamp.h"
+#include "AudioFileReader.h"
+#include "MappedFile.h"
+#include "Resampler.h"
+
+namespace sound {
+
+	// CLASS:		Voice
+	//
+	// PURPOSE:		A sound being mixed: an audio file read chunk by chunk, and a gain
+	//				that can ramp from one value to another over a number of frames.
+	//				The file is either a WAV file, a compressed file (see Adpcm.h) decoded
+	//				while it is read, or a headerless file in the default format.
+	//				Only its audio data is read: chunks are whole numbers of frames.
+	//
+	//				The file is read in place from the asset pack if it holds it, from the
+	//				asset cache if it is resident there, otherwise it is mapped in memory,
+	//				or read ahead from a background thread as a last resort.
+	//				A voice that reaches EOF hands its mapped file over to the cache.
+	//
+	//				A voice can loop over a region of the file, without a gap at the seam
+	//				and without reading the file again.
+	//
+	//				A file whose sample rate differs from the output rate is resampled
+	//				while it is read: its chunks are then floats at the output rate.
+	//
+	class Voice {
+	public:
+		DISALLOW_COPY_AND_ASSIGN(Voice);
+
+		Voice() {}
+		~Voice() { Close(); }
+
+		//				ACCESSORS
+		//
+
+		// IsOpen returns true iff a file is open, even if all its data was read.
+		bool IsOpen() const { return m_isOpen; }
+
+		// IsPlaying returns true iff the voice has data left to read.
+		bool IsPlaying() const { return m_isOpen && !m_finished; }
+
+		// Gain returns the gain of the last frame read. If Gains() is nullptr, it is the gain
+		// of every frame of the last chunk.
+		float Gain() const { return m_ramp.Gain(); }
+
+		// Gains returns the gain of each frame of the last chunk read if the gain moved
+		// during the chunk, and nullptr otherwise.
+		const float *Gains() const { return m_ramped ? m_gains.data() : nullptr; }
+
+		// Format returns the format of the chunks returned by Data: the format of the
+		// open file, or floats at the output rate if the file is resampled.
+		const WAVEFORMATEX &Format() const { return m_format; }
+
+		// IsResampled returns true iff the sample rate of the open file is not the output rate.
+		bool IsResampled() const { return m_resampled; }
+
+		// Data returns the chunk loaded by the last call to Read.
+		const BufferData Data() const;
+
+		// AudioFrames returns the number of frames of the last chunk read that come from
+		// the file. The frames after them are the zero padding past the end.
+		size_t AudioFrames() const { return m_audioFrames; }
+
+		//				MANIPULATORS
+		//
+
+		// SetOutputRate sets the sample rate that the next files opened are resampled to.
+		// Zero, the default, plays the files at their own rate.
+		void SetOutputRate(DWORD samplesPerSec, RESAMPLER_QUALITY quality);
+
+		// SetAssetPack sets the pack that the next files opened are looked up in first.
+		// nullptr, the default, opens all the files from the disk.
+		void SetAssetPack(const AssetPack *pack);
+
+		// Reserve allocates the buffers of the voice for chunks of up to maxFrames frames of
+		// files in the given format. Opening such a file then allocates nothing: the buffers
+		// only grow, the first time a file of another format or sample rate is opened.
+		// The streams of the voice get their buffers as well, so that a file that is
+		// streamed opens without an allocation too.
+		//
+		// PRECONDITIONS
+		//	The first call comes before the first Open.
+		//
+		void Reserve(size_t maxFrames, const WAVEFORMATEX &format);
+
+		// Open closes the current file, if any, and opens another one.
+		// Fails if the file is a WAV file in an unsupported format.
+		//
+		// INPUT
+		//	maxFrames:			number of frames of the largest chunk that Read will be asked.
+		//	firstChunkFrames, chunkFrames, numReadAheadChunks:
+		//		the sizes of the reads, in order, for the read-ahead mode.
+		//		All the sizes are in frames at the output rate.
+		//		If numReadAheadChunks == 0, the file is never read ahead.
+		//
+		Error Open(const char *filename, size_t maxFrames,
+			size_t firstChunkFrames = 0, size_t chunkFrames = 0, int numReadAheadChunks = 0);
+
+		// This version opens an asset resolved by an AssetRegistry: an asset of the pack
+		// is not looked up again, and the path is not copied into a new string.
+		// The asset is looked up in the cache, and stored there once read, under its handle.
+		// The cache can be nullptr.
+		// The registry must be the one of the pack set with SetAssetPack.
+		Error Open(const RegisteredAsset &asset, AssetCache *cache, size_t maxFrames,
+			size_t firstChunkFrames = 0, size_t chunkFrames = 0, int numReadAheadChunks = 0);
+
+		// SetLoop makes the voice loop forever from endFrame back to startFrame, frames of
+		// the file. An end past the audio data is the end of the data.
+		// The loop body is read in place if the file is in memory, otherwise it is loaded
+		// once: looping does no I/O. Loading it allocates only if it is longer than
+		// the bodies loaded before.
+		// Fails if the region is empty or cannot be read.
+		//
+		// PRECONDITIONS
+		//	The voice did not read past endFrame yet.
+		//
+		Error SetLoop(size_t startFrame, size_t endFrame);
+
+		// Prefetch asks for the first numFrames frames of the file to be loaded in the
+		// background, so that the first Read does not wait for the disk.
+		// It does nothing for an asset of the pack: the pack prefetched it when it was opened.
+		void Prefetch(size_t numFrames);
+
+		// Close closes the file. Pointers returned by Data become invalid.
+		void Close();
+
+		// Read loads the next numFrames frames of the file, padded with zeros past
+		// the end of the audio data. numFrames is a number of frames at the output rate.
+		// Once the end is reached or a read error occured, the voice stops playing,
+		// but the data of the last chunk remains valid until Close.
+		Error Read(size_t numFrames);
+
+		// SetGain sets the gain from the next chunk on, and cancels a ramp or a fade out.
+		void SetGain(float gain);
+
+		// RampGain moves the gain to target over the next numFrames frames read.
+		void RampGain(float target, size_t numFrames, FADE_CURVE curve);
+
+		// FadeOut moves the gain to zero over the next numFrames frames read,
+		// then the voice stops playing.
+		void FadeOut(size_t numFrames, FADE_CURVE curve);
+
+	private:
+		// OpenFile opens the asset at filename, or the asset of the pack if packed is not nullptr.
+		// The cache is only used for a registered asset, whose handle is not kInvalidAssetHandle.
+		Error OpenFile(const std::string &filename, AssetHandle handle, const PackedAsset *packed, AssetCache *cache,
+			size_t maxFrames, size_t firstChunkFrames, size_t chunkFrames, int numReadAheadChunks);
+
+		// SetUpResampler records the layout of a file and prepares its resampling,
+		// if its rate is not the output rate.
+		// Returns the number of frames of the largest chunk read from the file.
+		size_t SetUpResampler(const WAVEFORMATEX &fileFormat, size_t maxFrames);
+
+		// FileFrames converts a number of frames at the output rate to frames of the file.
+		size_t FileFrames(size_t numFrames) const;
+
+		// DecodeLoopBody decodes the frames of a loop of a compressed file into m_loopBody.
+		Error DecodeLoopBody(size_t startFrame, size_t endFrame);
+
+		// ResampleChunk converts the chunk just read to floats and resamples it.
+		void ResampleChunk(size_t numInFrames, size_t numFrames);
+
+	private:
+		bool				m_isOpen{ false };
+		bool				m_finished{ false };
+
+		GainRamp			m_ramp;
+		bool				m_fadingOut{ false };
+
+		// Gains of the frames of the last chunk, if m_ramped.
+		std::vector<float>	m_gains;
+		bool				m_ramped{ false };
+
+		WAVEFORMATEX		m_format;
+
+		size_t				m_audioFrames{ 0 };
+
+		// Paths up to MAX_PATH are copied without an allocation.
+		static const size_t	kReservedPathLength = 260;
+		std::string			m_filename;
+		AssetHandle			m_handle{ kInvalidAssetHandle };
+		AssetCache			*m_cache{ nullptr };
+		AssetCache::Asset	m_asset;
+		const AssetPack		*m_pack{ nullptr };
+		bool				m_inPack{ false };
+		MappedFile			m_mappedFile;
+		size_t				m_dataOffset{ 0 };
+		size_t				m_dataSize{ 0 };
+
+		// Frames per block of a compressed file, 0 for PCM.
+		size_t				m_framesPerBlock{ 0 };
+
+		// The audio data of a file in memory, nullptr if the file is streamed.
+		const byte			*m_audioData{ nullptr };
+
+		// The loop body of a streamed or compressed file. It keeps its memory from a loop to the next.
+		std::vector<byte>	m_loopBody;
+
+		// A streamed file, read by m_reader through m_fileSource, and a stream of its own
+		// to load the loop body: the read-ahead thread uses the other one.
+		// Both streams read through buffers allocated by Reserve.
+		static const size_t	kStreamBufferSize = 4096;
+		std::vector<char>	m_streamBuffers;
+		std::ifstream		m_file;
+		StreamSource		m_fileSource{ &m_file };
+		std::ifstream		m_loopFile;
+
+		// A block of a streamed compressed file, read to decode its loop body.
+		std::vector<byte>	m_codedBlock;
+
+		AudioFileReader		m_reader;
+
+		//		Resampling
+		//
+
+		DWORD				m_outputRate{ 0 };
+		RESAMPLER_QUALITY	m_quality{ RESAMPLER_QUALITY_MEDIUM };
+		bool				m_resampled{ false };
+		Resampler			m_resampler;
+
+		// Layout of the samples in the file.
+		WORD				m_fileBlockAlign{ 0 };
+		SAMPLE_TYPE			m_fileSampleType{ SAMPLE_TYPE_UNSUPPORTED };
+
+		// The chunk read, converted to floats, and the resampled chunk.
+		std::vector<float>	m_inFrames;
+		std::vector<float>	m_outFrames;
+		size_t				m_outSize{ 0 };
+	};
+}
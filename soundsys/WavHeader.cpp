@@ -0,0 +1,187 @@
+#include "pch.h"
+#include "WavHeader.h"
+#include "Adpcm.h"
+#include "AudioFormat.h"
+#include <algorithm>
+#include <cstring>
+
+namespace sound {
+
+	static const size_t kRiffHeaderSize = 12;	// "RIFF", size, "WAVE"
+	static const size_t kChunkHeaderSize = 8;	// id, size
+
+	// Only the beginning of WAVEFORMATEXTENSIBLE is read: up to the format tag of the sub-format.
+	static const size_t kMaxFmtSize = 26;
+
+	static uint16_t Read16(const byte *p)
+	{
+		return static_cast<uint16_t>(p[0] | (p[1] << 8));
+	}
+
+	static uint32_t Read32(const byte *p)
+	{
+		return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+			| (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+	}
+
+	// ParseFmtChunk decodes the content of a fmt chunk.
+	static Error ParseFmtChunk(const byte *fmt, size_t size, OUT WAVEFORMATEX *format)
+	{
+		if (size < 16) {
+			return ERROR_FAILURE;
+		}
+
+		auto tag = Read16(fmt);
+		if (tag == WAVE_FORMAT_EXTENSIBLE) {
+			if (size < kMaxFmtSize) {
+				return ERROR_FAILURE;
+			}
+
+			// The sub-format GUID starts with the format tag.
+			tag = Read16(fmt + 24);
+		}
+
+		*format = MakeWaveFormat(tag, Read16(fmt + 2), Read32(fmt + 4), Read16(fmt + 14));
+
+		// The block alignment must be the one of interleaved samples.
+		if (Read16(fmt + 12) != format->nBlockAlign || !IsSupportedFormat(*format)) {
+			return ERROR_FAILURE;
+		}
+
+		return ERROR_NONE;
+	}
+
+	// ParseAdpcm locates the blocks of a compressed file of fileSize bytes.
+	// A truncated file ends with its last whole block.
+	static Error ParseAdpcm(const byte *header, size_t fileSize, OUT WavInfo *info)
+	{
+		AdpcmInfo adpcm;
+		if (ParseAdpcmHeader(header, kAdpcmHeaderSize, &adpcm)) {
+			return ERROR_FAILURE;
+		}
+
+		const auto blockSize = AdpcmBlockSize(adpcm.numChannels, adpcm.framesPerBlock);
+		const auto numBlocks = std::min<size_t>((adpcm.numFrames + adpcm.framesPerBlock - 1) / adpcm.framesPerBlock,
+			(fileSize - kAdpcmHeaderSize) / blockSize);
+		const auto numFrames = std::min<size_t>(adpcm.numFrames, numBlocks * adpcm.framesPerBlock);
+
+		info->format = MakeWaveFormat(WAVE_FORMAT_PCM, adpcm.numChannels, adpcm.samplesPerSec, 16);
+		info->dataOffset = kAdpcmHeaderSize;
+		info->dataSize = numFrames * info->format.nBlockAlign;
+		info->compressed = true;
+		info->codedSize = numBlocks * blockSize;
+		info->framesPerBlock = adpcm.framesPerBlock;
+
+		return ERROR_NONE;
+	}
+
+	// ParseChunks walks the chunks of a RIFF file of fileSize bytes.
+	// readAt(offset, size, dst) copies size bytes of the file and returns false if it cannot.
+	template <class ReadAt>
+	static Error ParseChunks(ReadAt readAt, size_t fileSize, OUT WavInfo *info)
+	{
+		byte adpcmHeader[kAdpcmHeaderSize];
+		if (fileSize >= kAdpcmHeaderSize && readAt(0, kAdpcmHeaderSize, adpcmHeader) && IsAdpcmFile(adpcmHeader, kAdpcmHeaderSize)) {
+			return ParseAdpcm(adpcmHeader, fileSize, info);
+		}
+
+		byte header[kRiffHeaderSize];
+
+		if (fileSize < kRiffHeaderSize || !readAt(0, kRiffHeaderSize, header) || std::memcmp(header, "RIFF", 4) != 0) {
+			// Headerless file.
+			info->format = DefaultWaveFormat();
+			info->dataOffset = 0;
+			info->dataSize = fileSize - fileSize % info->format.nBlockAlign;
+			return ERROR_NONE;
+		}
+
+		if (std::memcmp(header + 8, "WAVE", 4) != 0) {
+			return ERROR_FAILURE;
+		}
+
+		auto fmtFound = false;
+
+		for (size_t pos = kRiffHeaderSize; pos + kChunkHeaderSize <= fileSize; ) {
+			byte chunk[kChunkHeaderSize];
+			if (!readAt(pos, kChunkHeaderSize, chunk)) {
+				return ERROR_FAILURE;
+			}
+
+			const size_t chunkSize = Read32(chunk + 4);
+			const size_t bodyOffset = pos + kChunkHeaderSize;
+
+			if (std::memcmp(chunk, "fmt ", 4) == 0) {
+				byte fmt[kMaxFmtSize] = { 0 };
+				auto n = std::min(chunkSize, kMaxFmtSize);
+				if (!readAt(bodyOffset, n, fmt) || ParseFmtChunk(fmt, n, &info->format)) {
+					return ERROR_FAILURE;
+				}
+				fmtFound = true;
+			}
+			else if (std::memcmp(chunk, "data", 4) == 0) {
+				if (!fmtFound) {
+					return ERROR_FAILURE;
+				}
+
+				// Files being recorded may not have their sizes written yet:
+				// the data then goes on up to the end of the file.
+				auto size = std::min(chunkSize, fileSize - bodyOffset);
+
+				info->dataOffset = bodyOffset;
+				info->dataSize = size - size % info->format.nBlockAlign;
+				return ERROR_NONE;
+			}
+
+			// Chunks are padded to an even size.
+			pos = bodyOffset + chunkSize + (chunkSize & 1);
+		}
+
+		// No data chunk.
+		return ERROR_FAILURE;
+	}
+
+	Error ParseWavHeader(const byte *data, size_t size, OUT WavInfo *info)
+	{
+		assert(data != nullptr || size == 0);
+		assert(info != nullptr);
+
+		auto readAt = [data, size](size_t offset, size_t n, byte *dst) {
+			if (offset > size || n > size - offset) {
+				return false;
+			}
+			std::memcpy(dst, data + offset, n);
+			return true;
+		};
+
+		return ParseChunks(readAt, size, info);
+	}
+
+	Error ParseWavHeader(std::istream *file, OUT WavInfo *info)
+	{
+		assert(file != nullptr);
+		assert(info != nullptr);
+
+		file->seekg(0, std::ios::end);
+		auto end = file->tellg();
+		if (end < 0) {
+			return ERROR_FAILURE;
+		}
+		const auto fileSize = static_cast<size_t>(end);
+
+		auto readAt = [file](size_t offset, size_t n, byte *dst) {
+			file->seekg(static_cast<std::streamoff>(offset));
+			file->read((char *)dst, static_cast<std::streamsize>(n));
+			return static_cast<size_t>(file->gcount()) == n;
+		};
+
+		auto err = ParseChunks(readAt, fileSize, info);
+		if (err) {
+			return err;
+		}
+
+		file->clear();
+		file->seekg(static_cast<std::streamoff>(info->dataOffset));
+
+		return file->good() ? ERROR_NONE : ERROR_FAILURE;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "framework.h"
+#include <istream>
+
+namespace sound {
+
+	// WavInfo locates the audio data of a file.
+	struct WavInfo {
+		WAVEFORMATEX	format;
+		size_t			dataOffset{ 0 };	// byte offset of the first sample in the file
+		size_t			dataSize{ 0 };		// number of bytes of samples, a whole number of frames
+
+		// A compressed file (see Adpcm.h) holds codedSize bytes of blocks from dataOffset on,
+		// which decode to dataSize bytes of 16-bit samples in format.
+		bool			compressed{ false };
+		size_t			codedSize{ 0 };
+		WORD			framesPerBlock{ 0 };
+	};
+
+	// ParseWavHeader reads the fmt and data chunks of a RIFF/WAVE file.
+	// The other chunks are skipped.
+	// A compressed file is recognized by its own header.
+	// A file that does not start with a RIFF header is headerless: all its bytes
+	// are samples in the DefaultWaveFormat.
+	//
+	// RETURN VALUE
+	//	ERROR_FAILURE if the header is malformed or the format is not supported
+	//	(see IsSupportedFormat).
+	//
+	Error ParseWavHeader(const byte *data, size_t size, OUT WavInfo *info);
+
+	// This version reads the header from a file.
+	// On success, the file is positioned at the first sample.
+	Error ParseWavHeader(std::istream *file, OUT WavInfo *info);
+}
@@ -1,11 +1,36 @@
 #pragma once
 
+#ifdef _WIN32
 // Always include this header before the line #define WIN32_LEAN_AND_MEAN
 #include <dsound.h>
 
 #define NOMINMAX
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#include <mmreg.h>// WAVE_FORMAT_IEEE_FLOAT, WAVE_FORMAT_EXTENSIBLE
+#else
+// Without the Windows SDK (headless builds), we only define the few Windows types
+// the platform independent parts of the library are written against.
+#include <cstdint>
+
+using DWORD = uint32_t;
+using WORD = uint16_t;
+using LPVOID = void *;
+
+const WORD WAVE_FORMAT_PCM = 1;
+const WORD WAVE_FORMAT_IEEE_FLOAT = 3;
+const WORD WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+struct WAVEFORMATEX {
+	WORD	wFormatTag;
+	WORD	nChannels;
+	DWORD	nSamplesPerSec;
+	DWORD	nAvgBytesPerSec;
+	WORD	nBlockAlign;
+	WORD	wBitsPerSample;
+	WORD	cbSize;
+};
+#endif
 
 #define IN
 #define OUT
@@ -47,6 +72,7 @@ inline void SafeRelease(T **ptr)
 
 
 #include <cstdio>// _vsnprintf_s
+#include <cstdarg>
 
 inline void DebugPrintfA(const char *format, ...)
 {
@@ -55,9 +81,15 @@ inline void DebugPrintfA(const char *format, ...)
 
 	const size_t kCapacity = 512;
 	char buf[kCapacity];
+#ifdef _WIN32
 	auto n = _vsnprintf_s((char *)buf, kCapacity, kCapacity - 1, format, args);
 
 	OutputDebugStringA(buf);
+#else
+	vsnprintf(buf, kCapacity, format, args);
+
+	fputs(buf, stderr);
+#endif
 
 	va_end(args);
 }
\ No newline at end of file
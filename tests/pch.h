@@ -8,3 +8,4 @@
 #define NOMINMAX
 
 #include "gtest/gtest.h"
+#include <cstring>
@@ -0,0 +1,185 @@
+#include "pch.h"
+#include "../soundsys/Adpcm.h"
+#include "../soundsys/AudioFileReader.h"
+#include "../soundsys/WavHeader.h"
+#include <cmath>
+#include <random>
+
+// make_tone returns numFrames frames of a tone with some noise, a different one per channel.
+static std::vector<int16_t> make_tone(size_t numFrames, int numChannels)
+{
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> noise(-200, 200);
+
+	std::vector<int16_t> samples(numFrames * numChannels);
+	for (size_t f = 0; f < numFrames; f++) {
+		for (int c = 0; c < numChannels; c++) {
+			auto v = 12000.0 * std::sin(f * (0.03 + 0.02 * c)) + noise(rng);
+			samples[f * numChannels + c] = static_cast<int16_t>(v);
+		}
+	}
+
+	return samples;
+}
+
+// decode_file decodes all the blocks of a compressed file and returns its frames.
+static std::vector<int16_t> decode_file(const std::vector<byte> &file)
+{
+	sound::AdpcmInfo info;
+	EXPECT_FALSE(sound::ParseAdpcmHeader(file.data(), file.size(), &info));
+
+	const auto numBlocks = (info.numFrames + info.framesPerBlock - 1) / info.framesPerBlock;
+	std::vector<int16_t> samples(numBlocks * info.framesPerBlock * info.numChannels);
+	sound::DecodeAdpcmBlocks_Scalar(samples.data(), file.data() + sound::kAdpcmHeaderSize, numBlocks, info.numChannels, info.framesPerBlock);
+
+	samples.resize(info.numFrames * info.numChannels);
+	return samples;
+}
+
+TEST(Adpcm, RoundTripIsClose)
+{
+	for (int numChannels : { 1, 2 }) {
+		const auto samples = make_tone(10000, numChannels);
+
+		std::vector<byte> file;
+		sound::EncodeAdpcm(samples.data(), 10000, numChannels, 44100, sound::kAdpcmDefaultFramesPerBlock, &file);
+		const auto decoded = decode_file(file);
+		ASSERT_EQ(decoded.size(), samples.size());
+
+		double signal = 0, error = 0;
+		for (size_t i = 0; i < samples.size(); i++) {
+			signal += double(samples[i]) * samples[i];
+			error += double(samples[i] - decoded[i]) * (samples[i] - decoded[i]);
+		}
+		EXPECT_GT(10 * std::log10(signal / error), 35.0) << numChannels << " channel(s)";
+
+		// About 4:1.
+		EXPECT_LT(file.size() * 3.5, samples.size() * sizeof(int16_t));
+	}
+}
+
+TEST(Adpcm, LanesDecodeLikeScalar)
+{
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int> bytes(0, 255);
+
+	// Numbers of units that are and are not multiples of the number of lanes.
+	for (int numChannels : { 1, 2 }) {
+		for (size_t numBlocks : { 1, 3, 4, 7 }) {
+			const size_t fpb = 64;
+			std::vector<byte> blocks(numBlocks * sound::AdpcmBlockSize(numChannels, fpb));
+			for (auto &b : blocks) {
+				b = static_cast<byte>(bytes(rng));
+			}
+
+			std::vector<int16_t> scalar(numBlocks * fpb * numChannels), lanes(scalar.size());
+			sound::DecodeAdpcmBlocks_Scalar(scalar.data(), blocks.data(), numBlocks, numChannels, fpb);
+			sound::DecodeAdpcmBlocks(lanes.data(), blocks.data(), numBlocks, numChannels, fpb);
+
+			EXPECT_EQ(lanes, scalar) << numChannels << " channel(s), " << numBlocks << " blocks";
+		}
+	}
+}
+
+TEST(Adpcm, RejectsBadHeaders)
+{
+	const auto samples = make_tone(100, 1);
+	std::vector<byte> file;
+	sound::EncodeAdpcm(samples.data(), 100, 1, 44100, 32, &file);
+
+	sound::AdpcmInfo info;
+	EXPECT_FALSE(sound::ParseAdpcmHeader(file.data(), file.size(), &info));
+	EXPECT_EQ(info.numFrames, 100u);
+	EXPECT_EQ(info.framesPerBlock, 32);
+
+	auto bad = file;
+	bad[4] = 2;// Version.
+	EXPECT_TRUE(sound::ParseAdpcmHeader(bad.data(), bad.size(), &info));
+
+	bad = file;
+	bad[6] = 3;// Channels.
+	EXPECT_TRUE(sound::ParseAdpcmHeader(bad.data(), bad.size(), &info));
+
+	bad = file;
+	bad[16] = 33;// Odd frames per block.
+	EXPECT_TRUE(sound::ParseAdpcmHeader(bad.data(), bad.size(), &info));
+
+	EXPECT_TRUE(sound::ParseAdpcmHeader(file.data(), sound::kAdpcmHeaderSize - 1, &info));
+}
+
+TEST(Adpcm, WavHeaderLocatesTheBlocks)
+{
+	const auto samples = make_tone(1000, 2);
+	std::vector<byte> file;
+	sound::EncodeAdpcm(samples.data(), 1000, 2, 22050, 128, &file);
+
+	sound::WavInfo info;
+	ASSERT_FALSE(sound::ParseWavHeader(file.data(), file.size(), &info));
+	EXPECT_TRUE(info.compressed);
+	EXPECT_EQ(info.format.nChannels, 2);
+	EXPECT_EQ(info.format.nSamplesPerSec, 22050u);
+	EXPECT_EQ(info.format.wBitsPerSample, 16);
+	EXPECT_EQ(info.dataOffset, sound::kAdpcmHeaderSize);
+	EXPECT_EQ(info.dataSize, 1000u * 4);
+	EXPECT_EQ(info.codedSize, 8 * sound::AdpcmBlockSize(2, 128));
+	EXPECT_EQ(info.framesPerBlock, 128);
+
+	// A truncated file ends with its last whole block.
+	ASSERT_FALSE(sound::ParseWavHeader(file.data(), file.size() - 10, &info));
+	EXPECT_EQ(info.dataSize, 7u * 128 * 4);
+	EXPECT_EQ(info.codedSize, 7 * sound::AdpcmBlockSize(2, 128));
+}
+
+TEST(Adpcm, ReaderDecodesTheFile)
+{
+	const size_t kNumFrames = 5000;
+	const auto samples = make_tone(kNumFrames, 2);
+	std::vector<byte> file;
+	sound::EncodeAdpcm(samples.data(), kNumFrames, 2, 44100, 128, &file);
+
+	const auto decoded = decode_file(file);
+	const auto *expected = reinterpret_cast<const byte *>(decoded.data());
+	const size_t pcmSize = decoded.size() * sizeof(int16_t);
+
+	std::ofstream ofs("temp.bin", std::ios::binary);
+	ofs.write((const char *)file.data(), file.size());
+	ofs.close();
+
+	sound::WavInfo info;
+	ASSERT_FALSE(sound::ParseWavHeader(file.data(), file.size(), &info));
+
+	// Chunk sizes that do not match the blocks, from memory, from a file, and read ahead.
+	for (int mode = 0; mode < 3; mode++) {
+		std::ifstream	stream("temp.bin", std::ios::binary);
+		stream.seekg(info.dataOffset);
+
+		sound::AudioFileReader	reader = (mode == 0)
+			? sound::AudioFileReader(2000, file.data() + info.dataOffset, info.codedSize)
+			: sound::AudioFileReader(2000, &stream, info.codedSize);
+		reader.SetAdpcm(2, info.framesPerBlock, info.dataSize);
+		if (mode == 2) {
+			EXPECT_FALSE(reader.StartReadAhead(1200, 2000, 3));
+		}
+
+		std::vector<byte> got;
+		Error err = ERROR_NONE;
+		for (size_t i = 0; !err; i++) {
+			const size_t size = (i == 0) ? 1200 : (i % 2 ? 2000 : 36);
+			err = reader.Read(size);
+			ASSERT_EQ(reader.Data().size, size);
+			ASSERT_LE(reader.AudioSize(), size);
+			got.insert(got.end(), reader.Data().ptr, reader.Data().ptr + reader.AudioSize());
+
+			// The padding is silent.
+			for (size_t k = reader.AudioSize(); k < size; k++) {
+				ASSERT_EQ(reader.Data().ptr[k], (byte)0);
+			}
+		}
+
+		EXPECT_EQ(err, ERROR_EOF) << "mode " << mode;
+		EXPECT_TRUE(reader.AtEOF());
+		EXPECT_EQ(got, std::vector<byte>(expected, expected + pcmSize)) << "mode " << mode;
+
+		reader.StopReadAhead();
+	}
+}
@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "../soundsys/AssetCache.h"
+#include <fstream>
+#include <vector>
+
+static void map_file(const std::string &filepath, size_t size, byte value, sound::MappedFile *file)
+{
+	std::vector<byte> data(size, value);
+
+	{
+		std::ofstream	ofs(filepath, std::ios::binary);
+		ofs.write((const char*)data.data(), data.size());
+	}
+
+	ASSERT_FALSE(file->Open(filepath.c_str()));
+}
+
+TEST(AssetCache, HitAndMiss)
+{
+	sound::AssetCache	cache(1000, 4);
+	sound::MappedFile	file;
+	map_file("temp_a.bin", 100, 0x42, &file);
+	const auto *data = file.Data();
+
+	EXPECT_FALSE(cache.Find(1));
+
+	// The mapping is taken over, not copied.
+	auto inserted = cache.Insert(1, &file);
+	ASSERT_TRUE(inserted);
+	EXPECT_FALSE(file.IsOpen());
+	EXPECT_EQ(inserted.Data(), data);
+	EXPECT_EQ(inserted.Size(), 100u);
+	EXPECT_EQ(inserted.Data()[99], 0x42);
+
+	auto found = cache.Find(1);
+	ASSERT_TRUE(found);
+	EXPECT_EQ(found.Data(), data);
+
+	auto stats = cache.Stats();
+	EXPECT_EQ(stats.hits, 1u);
+	EXPECT_EQ(stats.misses, 1u);
+	EXPECT_EQ(stats.evictions, 0u);
+	EXPECT_EQ(stats.residentBytes, 100u);
+
+	// A handle out of the cache is never stored.
+	sound::MappedFile	other;
+	map_file("temp_b.bin", 100, 0, &other);
+	EXPECT_FALSE(cache.Insert(5, &other));
+	EXPECT_TRUE(other.IsOpen());
+	EXPECT_FALSE(cache.Find(sound::kInvalidAssetHandle));
+}
+
+TEST(AssetCache, EvictsTheLeastRecentlyUsed)
+{
+	sound::AssetCache	cache(300, 8);
+	sound::MappedFile	files[4];
+	for (int i = 0; i < 4; i++) {
+		map_file("temp_" + std::to_string(i) + ".bin", 100, 0, &files[i]);
+	}
+
+	EXPECT_TRUE(cache.Insert(1, &files[0]));
+	EXPECT_TRUE(cache.Insert(2, &files[1]));
+	EXPECT_TRUE(cache.Insert(3, &files[2]));
+
+	// 1 becomes the most recently used, so 2 goes first.
+	EXPECT_TRUE(cache.Find(1));
+	EXPECT_TRUE(cache.Insert(4, &files[3]));
+
+	EXPECT_FALSE(cache.Find(2));
+	EXPECT_TRUE(cache.Find(1));
+	EXPECT_TRUE(cache.Find(3));
+	EXPECT_TRUE(cache.Find(4));
+
+	auto stats = cache.Stats();
+	EXPECT_EQ(stats.evictions, 1u);
+	EXPECT_EQ(stats.residentBytes, 300u);
+}
+
+TEST(AssetCache, AssetsInUseAreNotEvicted)
+{
+	sound::AssetCache	cache(200, 8);
+	sound::MappedFile	a, b, c, again;
+	map_file("temp_a.bin", 100, 0, &a);
+	map_file("temp_b.bin", 100, 0, &b);
+	map_file("temp_c.bin", 100, 0, &c);
+
+	auto heldA = cache.Insert(1, &a);
+	auto heldB = cache.Insert(2, &b);
+
+	// Both assets are held: nothing can be evicted, and the file is left to the caller.
+	EXPECT_FALSE(cache.Insert(3, &c));
+	EXPECT_TRUE(c.IsOpen());
+
+	// Once 1 is released, it makes room for 3.
+	heldA.reset();
+	EXPECT_TRUE(cache.Insert(3, &c));
+	EXPECT_FALSE(cache.Find(1));
+	EXPECT_TRUE(cache.Find(2));
+
+	// An asset resident already keeps its mapping.
+	map_file("temp_b.bin", 100, 0, &again);
+	auto resident = cache.Insert(2, &again);
+	EXPECT_EQ(resident.Data(), heldB.Data());
+	EXPECT_TRUE(again.IsOpen());
+
+	// An asset larger than the budget is never cached.
+	sound::MappedFile	big;
+	map_file("temp_big.bin", 300, 0, &big);
+	EXPECT_FALSE(cache.Insert(4, &big));
+}
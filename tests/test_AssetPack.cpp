@@ -0,0 +1,147 @@
+#include "pch.h"
+#include "../soundsys/AssetPack.h"
+#include "../soundsys/Adpcm.h"
+#include "../soundsys/AudioFormat.h"
+#include <fstream>
+
+static void write_bytes(const std::string &filepath, const std::vector<byte> &data)
+{
+	std::ofstream	ofs(filepath, std::ios::binary);
+	ofs.write((const char*)data.data(), data.size());
+}
+
+// write_wav writes a WAV file of the given format and audio data.
+static void write_wav(const std::string &filepath, const WAVEFORMATEX &format, const std::vector<byte> &data)
+{
+	auto put32 = [](std::ofstream &ofs, uint32_t v) { ofs.write((const char*)&v, 4); };
+	auto put16 = [](std::ofstream &ofs, uint16_t v) { ofs.write((const char*)&v, 2); };
+
+	std::ofstream	ofs(filepath, std::ios::binary);
+	ofs.write("RIFF", 4);
+	put32(ofs, static_cast<uint32_t>(36 + data.size()));
+	ofs.write("WAVEfmt ", 8);
+	put32(ofs, 16);
+	put16(ofs, format.wFormatTag);
+	put16(ofs, format.nChannels);
+	put32(ofs, format.nSamplesPerSec);
+	put32(ofs, format.nAvgBytesPerSec);
+	put16(ofs, format.nBlockAlign);
+	put16(ofs, format.wBitsPerSample);
+	ofs.write("data", 4);
+	put32(ofs, static_cast<uint32_t>(data.size()));
+	ofs.write((const char*)data.data(), data.size());
+}
+
+static std::vector<byte> pattern(size_t size, int seed)
+{
+	std::vector<byte> data(size);
+	for (size_t i = 0; i < size; i++) {
+		data[i] = static_cast<byte>(i * 7 + seed);
+	}
+	return data;
+}
+
+TEST(AssetPack, FindsEveryKindOfFile)
+{
+	const auto headerless = pattern(1000, 1);
+	const auto wav = pattern(4800, 2);
+	write_bytes("temp_a.bin", headerless);
+	write_wav("temp_b.wav", sound::MakeWaveFormat(WAVE_FORMAT_PCM, 2, 48000, 16), wav);
+
+	std::vector<int16_t> samples(3000, 1234);
+	std::vector<byte> adpcm;
+	sound::EncodeAdpcm(samples.data(), samples.size(), 1, 22050, 64, &adpcm);
+	write_bytes("temp_c.adpcm", adpcm);
+
+	ASSERT_FALSE(sound::BuildAssetPack("temp.pack", { "temp_a.bin", "temp_b.wav", "temp_c.adpcm" }));
+
+	sound::AssetPack	pack;
+	ASSERT_FALSE(pack.Open("temp.pack"));
+	EXPECT_EQ(pack.NumAssets(), 3u);
+
+	sound::PackedAsset	asset;
+	ASSERT_TRUE(pack.Find("temp_a.bin", &asset));
+	EXPECT_EQ(asset.info.format.nSamplesPerSec, 44100u);
+	EXPECT_EQ(asset.info.dataSize, headerless.size());
+	EXPECT_EQ(asset.info.dataOffset % sound::kPackAlignment, 0u);
+	EXPECT_TRUE(std::equal(headerless.begin(), headerless.end(), asset.data));
+
+	ASSERT_TRUE(pack.Find("temp_b.wav", &asset));
+	EXPECT_EQ(asset.info.format.nChannels, 2);
+	EXPECT_EQ(asset.info.format.nSamplesPerSec, 48000u);
+	EXPECT_EQ(asset.info.dataSize, wav.size());
+	EXPECT_EQ(asset.info.dataOffset % sound::kPackAlignment, 0u);
+	EXPECT_FALSE(asset.info.compressed);
+	EXPECT_TRUE(std::equal(wav.begin(), wav.end(), asset.data));
+
+	ASSERT_TRUE(pack.Find("temp_c.adpcm", &asset));
+	EXPECT_TRUE(asset.info.compressed);
+	EXPECT_EQ(asset.info.framesPerBlock, 64);
+	EXPECT_EQ(asset.info.dataSize, 3000u * 2);
+	EXPECT_EQ(asset.info.codedSize, adpcm.size() - sound::kAdpcmHeaderSize);
+	EXPECT_TRUE(std::equal(adpcm.begin() + sound::kAdpcmHeaderSize, adpcm.end(), asset.data));
+
+	EXPECT_FALSE(pack.Find("temp_d.bin", &asset));
+	EXPECT_FALSE(pack.Find("temp_a.bi", &asset));
+	EXPECT_FALSE(pack.Find("", &asset));
+
+	pack.Close();
+	EXPECT_FALSE(pack.Find("temp_a.bin", &asset));
+}
+
+TEST(AssetPack, FindsManyAssets)
+{
+	// The same file under many names: they collide in the buckets now and then.
+	write_bytes("temp_a.bin", pattern(64, 3));
+
+	std::vector<std::string> names;
+	std::string prefix;
+	for (int i = 0; i < 500; i++) {
+		names.push_back(prefix + "temp_a.bin");
+		prefix += "./";
+	}
+	ASSERT_FALSE(sound::BuildAssetPack("temp.pack", names));
+
+	sound::AssetPack	pack;
+	ASSERT_FALSE(pack.Open("temp.pack"));
+	EXPECT_EQ(pack.NumAssets(), names.size());
+
+	for (const auto &name : names) {
+		sound::PackedAsset	asset;
+		ASSERT_TRUE(pack.Find(name.c_str(), &asset)) << name;
+		EXPECT_EQ(asset.info.dataSize, 64u);
+	}
+
+	// The same name twice is an error.
+	names.push_back(names[100]);
+	EXPECT_TRUE(sound::BuildAssetPack("temp2.pack", names));
+}
+
+TEST(AssetPack, RejectsCorruptPacks)
+{
+	write_bytes("temp_a.bin", pattern(5000, 4));
+	ASSERT_FALSE(sound::BuildAssetPack("temp.pack", { "temp_a.bin" }));
+
+	std::ifstream	ifs("temp.pack", std::ios::binary);
+	std::vector<byte> pack((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+	sound::AssetPack	opened;
+
+	// Missing files and audio files are not packs.
+	EXPECT_TRUE(opened.Open("temp_none.pack"));
+	EXPECT_TRUE(opened.Open("temp_a.bin"));
+	EXPECT_TRUE(sound::BuildAssetPack("temp2.pack", { "temp_none.bin" }));
+
+	// The data of the asset goes past the end of the file.
+	write_bytes("temp2.pack", std::vector<byte>(pack.begin(), pack.end() - 1));
+	EXPECT_TRUE(opened.Open("temp2.pack"));
+
+	// Another name under the hash of the first one.
+	auto corrupt = pack;
+	corrupt[sound::kPackHeaderSize + sizeof(sound::PackEntry) + 2 * sizeof(uint32_t)] ^= 1;
+	write_bytes("temp2.pack", corrupt);
+	EXPECT_TRUE(opened.Open("temp2.pack"));
+
+	write_bytes("temp2.pack", pack);
+	EXPECT_FALSE(opened.Open("temp2.pack"));
+}
@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "../soundsys/AssetRegistry.h"
+#include <fstream>
+
+static void write_file(const std::string &filepath, size_t size, byte value)
+{
+	std::vector<byte> data(size, value);
+
+	std::ofstream	ofs(filepath, std::ios::binary);
+	ofs.write((const char*)data.data(), data.size());
+}
+
+TEST(AssetRegistry, RegistersEachFileOnce)
+{
+	write_file("temp_a.bin", 4000, 0x11);
+	write_file("temp_b.bin", 4000, 0x22);
+
+	sound::AssetRegistry	registry(2);
+	EXPECT_EQ(registry.Find(sound::kInvalidAssetHandle), nullptr);
+	EXPECT_EQ(registry.Find(1), nullptr);
+
+	// The handles follow the order of registration.
+	sound::AssetHandle a = 0, b = 0, again = 0;
+	ASSERT_FALSE(registry.Register("temp_a.bin", nullptr, &a));
+	ASSERT_FALSE(registry.Register("temp_b.bin", nullptr, &b));
+	ASSERT_FALSE(registry.Register("temp_a.bin", nullptr, &again));
+	EXPECT_EQ(a, 1u);
+	EXPECT_EQ(b, 2u);
+	EXPECT_EQ(again, a);
+	EXPECT_EQ(registry.NumAssets(), 2u);
+
+	ASSERT_NE(registry.Find(b), nullptr);
+	EXPECT_EQ(registry.Find(b)->path, "temp_b.bin");
+	EXPECT_FALSE(registry.Find(b)->inPack);
+	EXPECT_EQ(registry.Find(3), nullptr);
+
+	// A full registry still finds the files registered.
+	write_file("temp_c.bin", 4000, 0x33);
+	sound::AssetHandle c = 0;
+	EXPECT_TRUE(registry.Register("temp_c.bin", nullptr, &c));
+	EXPECT_FALSE(registry.Register("temp_b.bin", nullptr, &c));
+	EXPECT_EQ(c, b);
+}
+
+TEST(AssetRegistry, RejectsFilesThatCannotBePlayed)
+{
+	sound::AssetRegistry	registry(4);
+	sound::AssetHandle handle = 0;
+	EXPECT_TRUE(registry.Register("temp_none.bin", nullptr, &handle));
+
+	// A RIFF header of an unsupported format.
+	std::ofstream	ofs("temp_bad.wav", std::ios::binary);
+	ofs.write("RIFF\x24\0\0\0WAVEfmt \x10\0\0\0\x02\0\x01\0", 24);
+	ofs.close();
+	EXPECT_TRUE(registry.Register("temp_bad.wav", nullptr, &handle));
+
+	// The failures use no handle.
+	write_file("temp_a.bin", 4000, 0x11);
+	ASSERT_FALSE(registry.Register("temp_a.bin", nullptr, &handle));
+	EXPECT_EQ(handle, 1u);
+}
+
+TEST(AssetRegistry, ResolvesAssetsOfThePack)
+{
+	write_file("temp_packed.bin", 4000, 0x44);
+	ASSERT_FALSE(sound::BuildAssetPack("temp.pack", { "temp_packed.bin" }));
+	remove("temp_packed.bin");
+
+	sound::AssetPack	pack;
+	ASSERT_FALSE(pack.Open("temp.pack"));
+
+	sound::AssetRegistry	registry(4);
+	sound::AssetHandle handle = 0;
+	ASSERT_FALSE(registry.Register("temp_packed.bin", &pack, &handle));
+
+	// The asset is located once: its data is read in place from the pack.
+	const auto *asset = registry.Find(handle);
+	ASSERT_NE(asset, nullptr);
+	EXPECT_TRUE(asset->inPack);
+	EXPECT_EQ(asset->packed.info.dataSize, 4000u);
+	EXPECT_EQ(asset->packed.data[0], 0x44);
+
+	// Without the pack, the file does not exist anymore.
+	sound::AssetRegistry	other(4);
+	EXPECT_TRUE(other.Register("temp_packed.bin", nullptr, &handle));
+}
@@ -1,31 +1,10 @@
 #include "pch.h"
 #include "../soundsys/AudioFileReader.h"
+#include "../soundsys/MappedFile.h"
 #include <chrono>
+#include <algorithm>
 #include <array>
 
-TEST(AudioFileReader, OneRead)
-{
-	std::vector<byte> data(512, (byte)0xAB);
-
-	std::ofstream	ofs("temp.bin", std::ios::binary);
-	ofs.write((const char*)data.data(), data.size());
-	ofs.close();
-
-	std::ifstream	file("temp.bin", std::ios::binary);
-
-	sound::AudioFileReader	r(512, &file);
-	auto err = r.Read();
-	EXPECT_FALSE(err);
-
-	// Copy the data in a vector.
-	std::vector<byte> got(512, 0);
-	std::memcpy(got.data(), r.Data().ptr, r.Data().size);
-
-	EXPECT_EQ(got, data);
-
-	file.close();
-}
-
 const size_t CHUNKSIZE = 512;
 using Chunk = std::array<byte, CHUNKSIZE>;
 using ChunkList = std::vector<Chunk>;
@@ -60,58 +39,381 @@ static ChunkList read_file(sound::AudioFileReader &reader)
 	return chunks;
 }
 
+// The kinds of sources the generic tests run on.
+enum SOURCE_KIND {
+	SOURCE_KIND_STREAM,				// a file
+	SOURCE_KIND_READ_AHEAD,			// a file read ahead
+	SOURCE_KIND_MEMORY,				// a buffer
+	SOURCE_KIND_MAPPED_FILE,		// a mapped file
+	SOURCE_KIND_ARCHIVE_STREAM,		// an entry in the middle of a file
+	SOURCE_KIND_ARCHIVE_MAPPED,		// an entry in the middle of a mapped file
+	SOURCE_KIND_COUNT
+};
+
+static const char *kSourceNames[SOURCE_KIND_COUNT] = {
+	"stream", "read-ahead", "memory", "mapped file", "archive stream", "archive mapped"
+};
+
+// TestSource holds what the source of a reader refers to, and must outlive the reader.
+struct TestSource {
+	std::ifstream		file;
+	std::vector<byte>	memory;
+
+	// MakeReader writes the data to temp.bin, in the middle of other bytes for the archives,
+	// and returns a reader of size bytes of the data from offset on. The reader of a
+	// file read ahead reads chunks of its capacity.
+	sound::AudioFileReader MakeReader(int kind, const std::vector<byte> &data, size_t capacity, size_t offset = 0, size_t size = SIZE_MAX)
+	{
+		const size_t kArchiveOffset = 37;
+		const auto archive = (kind == SOURCE_KIND_ARCHIVE_STREAM || kind == SOURCE_KIND_ARCHIVE_MAPPED);
+
+		std::vector<byte> contents(archive ? kArchiveOffset : 0, (byte)0xEE);
+		contents.insert(contents.end(), data.begin(), data.end());
+		if (archive) {
+			contents.insert(contents.end(), 50, (byte)0xEE);
+		}
+
+		std::ofstream	ofs("temp.bin", std::ios::binary);
+		ofs.write((const char*)contents.data(), contents.size());
+		ofs.close();
+
+		size = std::min(size, data.size() - offset);
+		const auto begin = offset + (archive ? kArchiveOffset : 0);
+
+		switch (kind) {
+		case SOURCE_KIND_MEMORY: {
+			memory = data;
+			return sound::AudioFileReader(capacity, memory.data() + offset, size);
+		}
+
+		case SOURCE_KIND_MAPPED_FILE:
+		case SOURCE_KIND_ARCHIVE_MAPPED: {
+			auto mapped = new sound::MappedFileSource;
+			EXPECT_FALSE(mapped->Open("temp.bin", begin, size));
+			return sound::AudioFileReader(capacity, std::unique_ptr<sound::ByteSource>(mapped));
+		}
+
+		default: {
+			file.open("temp.bin", std::ios::binary);
+			sound::AudioFileReader reader(capacity, std::unique_ptr<sound::ByteSource>(new sound::StreamSource(&file, begin, size)));
+			if (kind == SOURCE_KIND_READ_AHEAD) {
+				EXPECT_FALSE(reader.StartReadAhead(capacity, capacity, 2));
+			}
+			return reader;
+		}
+		}
+	}
+};
+
+TEST(AudioFileReader, OneRead)
+{
+	std::vector<byte> data(512, (byte)0xAB);
+
+	for (int kind = 0; kind < SOURCE_KIND_COUNT; kind++) {
+		TestSource source;
+		auto r = source.MakeReader(kind, data, 512);
+
+		auto err = r.Read();
+		EXPECT_FALSE(err) << kSourceNames[kind];
+
+		// Copy the data in a vector.
+		std::vector<byte> got(512, 0);
+		std::memcpy(got.data(), r.Data().ptr, r.Data().size);
+
+		EXPECT_EQ(got, data) << kSourceNames[kind];
+
+		r.StopReadAhead();
+	}
+}
+
 TEST(AudioFileReader, Padding)
 {
 	// Generate some data.
 	std::vector<byte> expected(256, 0xFF);
 
-	// Write it to a file.
-	const auto filepath = std::string("temp.bin");
-	std::ofstream	ofs(filepath, std::ios::binary);
-	ofs.write((const char*)expected.data(), expected.size());
-	ofs.close();
+	for (int kind = 0; kind < SOURCE_KIND_COUNT; kind++) {
+		TestSource source;
+		auto reader = source.MakeReader(kind, expected, 512);
 
-	// Read the entire file into a list of chunks.
-	std::ifstream	file(filepath, std::ios::binary);
-	sound::AudioFileReader	reader(512, &file);
+		EXPECT_EQ(reader.Read(), ERROR_EOF) << kSourceNames[kind];
+		auto data = reader.Data();
+		EXPECT_EQ(data.size, 512);
+		EXPECT_EQ(reader.AudioSize(), 256u);
 
-	reader.Read();
-	auto data = reader.Data();
-	EXPECT_EQ(data.size, 512);
+		// The first 256 bytes match the original data.
+		std::vector<byte> got(256);
+		std::memcpy(got.data(), reader.Data().ptr, 256);
+		EXPECT_EQ(got, expected) << kSourceNames[kind];
 
-	// The first 256 bytes match the original data.
-	std::vector<byte> got(256);
-	std::memcpy(got.data(), reader.Data().ptr, 256);
-	EXPECT_EQ(got, expected);
+		// The last 256 bytes are zeros.
+		std::memcpy(got.data(), reader.Data().ptr + 256, 256);
+		std::vector<byte> zeros(256, 0);
+		EXPECT_EQ(got, zeros) << kSourceNames[kind];
 
-	// The last 256 bytes are zeros.
-	std::memcpy(got.data(), reader.Data().ptr + 256, 256);
-	std::vector<byte> zeros(256, 0);
-	EXPECT_EQ(got, zeros);
+		// Reading after EOF gives zeros.
+		EXPECT_EQ(reader.Read(), ERROR_EOF);
+		EXPECT_EQ(reader.Data().size, 512);
+		EXPECT_TRUE(std::all_of(reader.Data().ptr, reader.Data().ptr + 512, [](byte b) { return b == 0; }));
 
-	file.close();
+		reader.StopReadAhead();
+	}
 }
 
 TEST(AudioFileReader, ReadEntireFile)
 {
 	// Generate some data chunks.
 	ChunkList	expected;
+	std::vector<byte> data;
 	for (int i = 0; i < 2; i++) {
 		Chunk ch;
 		std::fill(ch.begin(), ch.end(), (byte)i);
 
+		expected.push_back(ch);
+		data.insert(data.end(), ch.begin(), ch.end());
+	}
+
+	// Read the entire source into a list of chunks.
+	for (int kind = 0; kind < SOURCE_KIND_COUNT; kind++) {
+		TestSource source;
+		auto reader = source.MakeReader(kind, data, CHUNKSIZE);
+		auto got = read_file(reader);
+
+		EXPECT_EQ(got, expected) << kSourceNames[kind];
+		EXPECT_TRUE(reader.AtEOF());
+
+		reader.StopReadAhead();
+	}
+}
+TEST(AudioFileReader, ReadAheadEntireFile)
+{
+	// Generate some data chunks.
+	ChunkList	expected;
+	for (int i = 0; i < 5; i++) {
+		Chunk ch;
+		std::fill(ch.begin(), ch.end(), (byte)(i + 1));
+
 		expected.push_back(ch);
 	}
 
-	// Write the data to a file.
 	const auto filepath = std::string("temp.bin");
 	write_to_file(expected, filepath);
-	
-	// Read the entire file into a list of chunks.
+
+	// Read the entire file through the read-ahead queue.
 	std::ifstream	file(filepath, std::ios::binary);
 	sound::AudioFileReader	reader(CHUNKSIZE, &file);
+	EXPECT_FALSE(reader.StartReadAhead(CHUNKSIZE, CHUNKSIZE, 2));
+
 	auto got = read_file(reader);
+	EXPECT_EQ(got, expected);
+	EXPECT_TRUE(reader.AtEOF());
+	EXPECT_GE(reader.ReadAheadStats().numChunks, 5u);
+
+	reader.StopReadAhead();
+	file.close();
+}
+
+TEST(AudioFileReader, ReadAheadWithOtherSizes)
+{
+	// 1000 bytes: 0, 1, 2, ...
+	std::vector<byte> data(1000);
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = (byte)i;
+	}
+
+	std::ofstream	ofs("temp.bin", std::ios::binary);
+	ofs.write((const char*)data.data(), data.size());
+	ofs.close();
+
+	// The queue reads 300 bytes then chunks of 200, but we read by 256 bytes:
+	// the data is gathered across chunks.
+	std::ifstream	file("temp.bin", std::ios::binary);
+	sound::AudioFileReader	reader(512, &file);
+	EXPECT_FALSE(reader.StartReadAhead(300, 200, 3));
+
+	std::vector<byte> got;
+	Error err = ERROR_NONE;
+	while (err == ERROR_NONE) {
+		err = reader.Read(256);
+		EXPECT_EQ(reader.Data().size, 256u);
+		got.insert(got.end(), reader.Data().ptr, reader.Data().ptr + reader.Data().size);
+	}
+	EXPECT_EQ(err, ERROR_EOF);
+
+	// 4 reads of 256 bytes: the file followed by 24 zeros.
+	ASSERT_EQ(got.size(), 1024u);
+	EXPECT_TRUE(std::equal(data.begin(), data.end(), got.begin()));
+	EXPECT_TRUE(std::all_of(got.begin() + 1000, got.end(), [](byte b) { return b == 0; }));
+
+	// Reading after EOF gives zeros.
+	EXPECT_EQ(reader.Read(256), ERROR_EOF);
+	EXPECT_EQ(reader.Data().ptr[0], 0);
+
+	reader.StopReadAhead();
 	file.close();
+}
+
+TEST(AudioFileReader, ReadAheadGoesOnWithTheNextSource)
+{
+	// 1000 bytes: 0, 1, 2, ...
+	std::vector<byte> data(1000);
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = (byte)i;
+	}
+
+	std::ofstream	ofs("temp.bin", std::ios::binary);
+	ofs.write((const char*)data.data(), data.size());
+	ofs.close();
+
+	// The reader does not own the source: the same one reads both files.
+	std::ifstream		file("temp.bin", std::ios::binary);
+	sound::StreamSource	source(&file);
+	sound::AudioFileReader	reader(512);
+
+	// The first source is stopped in the middle, with chunks still queued.
+	reader.Reset(512, &source);
+	EXPECT_FALSE(reader.StartReadAhead(100, 100, 4));
+	EXPECT_FALSE(reader.Read(100));
+	EXPECT_EQ(reader.Data().ptr[99], 99);
+	reader.StopReadAhead();
+
+	// The second one is read ahead with other sizes, from its start.
+	file.clear();
+	file.seekg(200);
+	source.Reset(&file, 700);
+	reader.Reset(512, &source);
+	EXPECT_FALSE(reader.StartReadAhead(300, 300, 2));
+
+	std::vector<byte> got;
+	Error err = ERROR_NONE;
+	while (err == ERROR_NONE) {
+		err = reader.Read(300);
+		got.insert(got.end(), reader.Data().ptr, reader.Data().ptr + reader.Data().size);
+	}
+	EXPECT_EQ(err, ERROR_EOF);
+
+	ASSERT_EQ(got.size(), 900u);
+	EXPECT_TRUE(std::equal(data.begin() + 200, data.begin() + 900, got.begin()));
+	EXPECT_TRUE(std::all_of(got.begin() + 700, got.end(), [](byte b) { return b == 0; }));
+
+	reader.StopReadAhead();
+	file.close();
+}
+
+TEST(AudioFileReader, MemoryModeDoesNotCopy)
+{
+	std::vector<byte> data(1000, 0x7F);
+
+	sound::AudioFileReader	reader(512, data.data(), data.size());
+
+	// The first chunk points into the memory.
+	EXPECT_EQ(reader.Read(512), ERROR_NONE);
+	EXPECT_EQ(reader.Data().ptr, data.data());
+	EXPECT_EQ(reader.Data().size, 512u);
+	EXPECT_FALSE(reader.AtEOF());
+
+	// The second chunk contains EOF: the end of the data is copied and padded.
+	EXPECT_EQ(reader.Read(512), ERROR_EOF);
+	EXPECT_EQ(reader.Data().size, 512u);
+	EXPECT_EQ(reader.Data().ptr[487], 0x7F);
+	EXPECT_EQ(reader.Data().ptr[488], 0);
+	EXPECT_TRUE(reader.AtEOF());
+
+	// Past EOF, all the readers share the same zeros.
+	EXPECT_EQ(reader.Read(512), ERROR_EOF);
+	auto silence = reader.Data().ptr;
+	EXPECT_TRUE(std::all_of(silence, silence + 512, [](byte b) { return b == 0; }));
+
+	sound::AudioFileReader	other(512, data.data(), 0);
+	EXPECT_EQ(other.Read(256), ERROR_EOF);
+	EXPECT_EQ(other.Data().ptr, silence);
+}
+
+TEST(AudioFileReader, MappedFileEntireFile)
+{
+	// Generate some data chunks.
+	ChunkList	expected;
+	for (int i = 0; i < 3; i++) {
+		Chunk ch;
+		std::fill(ch.begin(), ch.end(), (byte)(0x10 + i));
+
+		expected.push_back(ch);
+	}
 
+	const auto filepath = std::string("temp.bin");
+	write_to_file(expected, filepath);
+
+	sound::MappedFile	file;
+	ASSERT_FALSE(file.Open(filepath.c_str()));
+	EXPECT_EQ(file.Size(), 3 * CHUNKSIZE);
+
+	sound::AudioFileReader	reader(CHUNKSIZE, file.Data(), file.Size());
+	auto got = read_file(reader);
 	EXPECT_EQ(got, expected);
-}
\ No newline at end of file
+
+	file.Close();
+	EXPECT_FALSE(file.IsOpen());
+}
+
+TEST(AudioFileReader, StopsAtTheEndOfTheAudioData)
+{
+	ChunkList	chunks;
+	std::vector<byte> data;
+	for (int i = 0; i < 5; i++) {
+		Chunk ch;
+		std::fill(ch.begin(), ch.end(), (byte)(i + 1));
+
+		chunks.push_back(ch);
+		data.insert(data.end(), ch.begin(), ch.end());
+	}
+
+	// The audio data is made of the chunks 1 to 3.
+	ChunkList	expected(chunks.begin() + 1, chunks.begin() + 4);
+
+	for (int kind = 0; kind < SOURCE_KIND_COUNT; kind++) {
+		TestSource source;
+		auto reader = source.MakeReader(kind, data, CHUNKSIZE, CHUNKSIZE, 3 * CHUNKSIZE);
+
+		auto got = read_file(reader);
+		EXPECT_EQ(got, expected) << kSourceNames[kind];
+		EXPECT_TRUE(reader.AtEOF());
+
+		reader.StopReadAhead();
+	}
+}
+
+TEST(AudioFileReader, LoopsWithoutAGap)
+{
+	std::vector<byte> data(1000);
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = (byte)(i % 251);
+	}
+
+	// The bytes 0 to 699, then the bytes 300 to 699 over and over.
+	std::vector<byte> expected(data.begin(), data.begin() + 700);
+	while (expected.size() < 3000) {
+		expected.insert(expected.end(), data.begin() + 300, data.begin() + 700);
+	}
+	expected.resize(3000);
+
+	const byte *body = data.data() + 300;
+	const size_t bodySize = 400;
+
+	for (int kind = 0; kind < SOURCE_KIND_COUNT; kind++) {
+		TestSource source;
+		auto reader = source.MakeReader(kind, data, 256);
+		reader.SetLoop(body, bodySize, 700);
+
+		std::vector<byte> got;
+		while (got.size() < expected.size()) {
+			auto size = std::min<size_t>(256, expected.size() - got.size());
+			ASSERT_EQ(reader.Read(size), ERROR_NONE) << kSourceNames[kind];
+			ASSERT_EQ(reader.Data().size, size);
+			got.insert(got.end(), reader.Data().ptr, reader.Data().ptr + size);
+		}
+
+		EXPECT_EQ(got, expected) << kSourceNames[kind];
+		EXPECT_FALSE(reader.AtEOF());
+
+		reader.StopReadAhead();
+	}
+}
@@ -0,0 +1,82 @@
+#include "pch.h"
+#include "../soundsys/CommandRing.h"
+#include <thread>
+#include <vector>
+
+TEST(CommandRing, PushAndPopInOrder)
+{
+	sound::CommandRing<int, 4>	ring;
+	EXPECT_TRUE(ring.Empty());
+
+	for (int i = 0; i < 4; i++) {
+		EXPECT_TRUE(ring.Push(i));
+	}
+
+	// The ring is full.
+	EXPECT_FALSE(ring.Push(4));
+
+	int value;
+	for (int i = 0; i < 4; i++) {
+		EXPECT_TRUE(ring.Pop(&value));
+		EXPECT_EQ(value, i);
+	}
+
+	EXPECT_TRUE(ring.Empty());
+	EXPECT_FALSE(ring.Pop(&value));
+}
+
+TEST(CommandRing, PopAllWrapsAround)
+{
+	sound::CommandRing<int, 4>	ring;
+	int values[4];
+
+	for (int lap = 0; lap < 3; lap++) {
+		EXPECT_TRUE(ring.Push(lap * 10 + 0));
+		EXPECT_TRUE(ring.Push(lap * 10 + 1));
+		EXPECT_TRUE(ring.Push(lap * 10 + 2));
+
+		EXPECT_EQ(ring.PopAll(values, 4), 3u);
+		EXPECT_EQ(values[0], lap * 10 + 0);
+		EXPECT_EQ(values[2], lap * 10 + 2);
+	}
+}
+
+TEST(CommandRing, ManyProducers)
+{
+	const int kNumProducers = 4;
+	const int kPerProducer = 10000;
+
+	sound::CommandRing<int, 64>	ring;
+
+	std::vector<std::thread> producers;
+	for (int p = 0; p < kNumProducers; p++) {
+		producers.emplace_back([&ring, p]() {
+			for (int i = 0; i < kPerProducer; i++) {
+				while (!ring.Push(p * kPerProducer + i)) {
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+
+	// Each producer's values come out in the order they were pushed.
+	std::vector<int> next(kNumProducers, 0);
+	int received = 0;
+	while (received < kNumProducers * kPerProducer) {
+		int value;
+		if (!ring.Pop(&value)) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		auto p = value / kPerProducer;
+		EXPECT_EQ(value % kPerProducer, next[p]);
+		next[p]++;
+		received++;
+	}
+
+	for (auto &t : producers) {
+		t.join();
+	}
+	EXPECT_TRUE(ring.Empty());
+}
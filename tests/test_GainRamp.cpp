@@ -0,0 +1,52 @@
+#include "pch.h"
+#include "../soundsys/GainRamp.h"
+#include <vector>
+
+TEST(GainRamp, ConstantGainFillsNothing)
+{
+	sound::GainRamp ramp(0.5f);
+
+	std::vector<float> gains(16, -1.f);
+	EXPECT_FALSE(ramp.Next(16, gains.data()));
+	EXPECT_EQ(gains, std::vector<float>(16, -1.f));
+	EXPECT_EQ(ramp.Gain(), 0.5f);
+}
+
+TEST(GainRamp, EndsOnTheExactFrameAcrossChunks)
+{
+	sound::GainRamp ramp(0.f);
+	ramp.Start(1.f, 100, sound::FADE_CURVE_LINEAR);
+
+	// 3 chunks of 40 frames: the ramp ends in the middle of the last one.
+	std::vector<float> gains(120);
+	for (int i = 0; i < 3; i++) {
+		EXPECT_TRUE(ramp.Next(40, gains.data() + 40 * i));
+	}
+	EXPECT_FALSE(ramp.IsRamping());
+
+	for (size_t k = 0; k < 100; k++) {
+		EXPECT_NEAR(gains[k], (k + 1) / 100.f, 1e-6f);
+	}
+	EXPECT_EQ(std::vector<float>(gains.begin() + 99, gains.end()), std::vector<float>(21, 1.f));
+
+	std::vector<float> next(8);
+	EXPECT_FALSE(ramp.Next(8, next.data()));
+	EXPECT_EQ(ramp.Gain(), 1.f);
+}
+
+TEST(GainRamp, ExponentialFadeOutGoesDownEvenlyInDecibels)
+{
+	sound::GainRamp ramp(1.f);
+	ramp.Start(0.f, 300, sound::FADE_CURVE_EXPONENTIAL);
+
+	std::vector<float> gains(300);
+	EXPECT_TRUE(ramp.Next(300, gains.data()));
+
+	// -60 dB over 300 frames: -20 dB every 100 frames.
+	EXPECT_NEAR(gains[99], 0.1f, 1e-4f);
+	EXPECT_NEAR(gains[199], 0.01f, 1e-5f);
+	EXPECT_EQ(gains[299], 0.f);
+	for (size_t k = 1; k < gains.size(); k++) {
+		EXPECT_LT(gains[k], gains[k - 1]);
+	}
+}
@@ -0,0 +1,107 @@
+#include "pch.h"
+#include "../soundsys/HeadlessDevice.h"
+#include "../soundsys/StreamingBuffer.h"
+#include "../soundsys/AudioFormat.h"
+#include <thread>
+#include <vector>
+
+static WAVEFORMATEX make_format()
+{
+	WAVEFORMATEX format{ 0 };
+	format.wFormatTag = WAVE_FORMAT_PCM;
+	format.nChannels = 1;
+	format.nSamplesPerSec = 44100;
+	format.wBitsPerSample = 16;
+	format.nBlockAlign = 2;
+	format.nAvgBytesPerSec = 88200;
+
+	return format;
+}
+
+TEST(HeadlessDevice, FastClockJumpsToNextNotification)
+{
+	sound::NullDevice	device(sound::DEVICE_CLOCK_AS_FAST_AS_POSSIBLE);
+	device.CreateBuffer(make_format(), 1000, { 250, 750 });
+
+	int pos = -1;
+	EXPECT_FALSE(device.WaitForNotification(0, &pos));
+
+	device.Play();
+
+	// The cursor alternates between the two offsets.
+	for (int i = 0; i < 4; i++) {
+		EXPECT_TRUE(device.WaitForNotification(0, &pos));
+		EXPECT_EQ(pos, i % 2);
+		EXPECT_EQ(device.PlayCursor(), (i % 2) ? 750u : 250u);
+	}
+
+	EXPECT_EQ(device.PlayedBytes(), 250u + 500u + 500u + 500u);
+
+	device.Stop();
+	EXPECT_FALSE(device.WaitForNotification(0, &pos));
+}
+
+TEST(HeadlessDevice, LockWrapsAroundTheEnd)
+{
+	sound::NullDevice	device;
+	device.CreateBuffer(make_format(), 1000, { 0 });
+
+	sound::DeviceMemoryRegion	memory;
+	EXPECT_EQ(device.Lock(900, 300, &memory), ERROR_NONE);
+	EXPECT_EQ(memory.span[0].length, 100u);
+	EXPECT_EQ(memory.span[1].length, 200u);
+	EXPECT_EQ(device.Unlock(memory), ERROR_NONE);
+}
+
+TEST(HeadlessDevice, WavFileRecordsWhatIsPlayed)
+{
+	const auto filepath = std::string("temp.wav");
+	{
+		sound::WavFileDevice	device(filepath.c_str());
+		sound::StreamingBuffer	buffer(&device, sound::DefaultWaveFormat(), 1000, 2);
+
+		std::vector<byte> data(buffer.Capacity(), 0x5A);
+		buffer.Write(0, data.data(), buffer.Capacity());
+		buffer.Play();
+
+		// Play the whole buffer once: from 0 to 25%, to 75%, then to 25% again.
+		int pos;
+		for (int i = 0; i < 3; i++) {
+			EXPECT_TRUE(buffer.APositionWasSignaled(&pos));
+		}
+		buffer.Stop();
+	}
+
+	std::ifstream	file(filepath, std::ios::binary);
+	std::vector<char> header(44);
+	file.read(header.data(), header.size());
+	EXPECT_EQ(std::string(header.data(), 4), "RIFF");
+	EXPECT_EQ(std::string(header.data() + 36, 4), "data");
+
+	uint32_t dataSize;
+	std::memcpy(&dataSize, header.data() + 40, 4);
+	EXPECT_EQ(dataSize, 88200u + 88200u / 4);
+
+	std::vector<char> data(dataSize);
+	file.read(data.data(), data.size());
+	EXPECT_EQ(file.gcount(), (std::streamsize)dataSize);
+	EXPECT_EQ(data.front(), 0x5A);
+	EXPECT_EQ(data.back(), 0x5A);
+}
+
+TEST(HeadlessDevice, InterruptWakesUpAWaitingThread)
+{
+	sound::NullDevice	device(sound::DEVICE_CLOCK_REAL_TIME);
+	device.CreateBuffer(make_format(), 88200, { 0 });
+
+	std::thread other([&device]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		device.Interrupt();
+	});
+
+	// The device is stopped: only the interrupt can end the wait.
+	int pos;
+	EXPECT_FALSE(device.WaitForNotification(sound::kWaitForever, &pos));
+
+	other.join();
+}
@@ -0,0 +1,40 @@
+#include "pch.h"
+#include "../soundsys/HealthMetrics.h"
+
+TEST(HealthMetrics, DurationsFallInPowerOfTwoBuckets)
+{
+	sound::HealthMetrics metrics;
+
+	// 0.5 us, 1 us, 3 us, 1 ms and 1 hour.
+	for (uint64_t ns : { 500ull, 1000ull, 3000ull, 1000000ull, 3600000000000ull }) {
+		metrics.RecordWakeup(ns);
+	}
+
+	auto jitter = metrics.Snapshot().wakeupJitter;
+	EXPECT_EQ(jitter.count, 5u);
+	EXPECT_EQ(jitter.buckets[0], 1u);
+	EXPECT_EQ(jitter.buckets[1], 1u);
+	EXPECT_EQ(jitter.buckets[2], 1u);
+	EXPECT_EQ(jitter.buckets[10], 1u);
+	EXPECT_EQ(jitter.buckets[sound::kNumHistogramBuckets - 1], 1u);
+	EXPECT_EQ(jitter.maxMicroseconds, 3600000000ull);
+	EXPECT_EQ(jitter.totalMicroseconds, 0u + 1u + 3u + 1000u + 3600000000ull);
+}
+
+TEST(HealthMetrics, RefillsCountUnderrunsAndNearMisses)
+{
+	sound::HealthMetrics metrics;
+
+	metrics.RecordRefill(2000, 1000, false, false);
+	metrics.RecordRefill(2000, 1000, false, true);
+	metrics.RecordRefill(2000, 1000, true, true);
+
+	auto health = metrics.Snapshot();
+	EXPECT_EQ(health.numRefills, 3u);
+	EXPECT_EQ(health.numUnderruns, 1u);
+	EXPECT_EQ(health.numNearMisses, 1u);
+	EXPECT_EQ(health.refillDuration.count, 3u);
+	EXPECT_EQ(health.refillDuration.buckets[2], 3u);
+	EXPECT_EQ(health.readLatency.totalMicroseconds, 3u);
+	EXPECT_EQ(health.wakeupJitter.count, 0u);
+}
@@ -0,0 +1,73 @@
+#include "pch.h"
+#include "../soundsys/LatencyController.h"
+
+const DWORD kRegionSize = 1000;
+
+TEST(LatencyController, NearMissGrowsTheLead)
+{
+	sound::LatencyController controller(2, 8, 3, 10);
+	EXPECT_EQ(controller.Lead(), 3);
+
+	controller.OnRefill(2 * kRegionSize, kRegionSize, false);
+	EXPECT_EQ(controller.Lead(), 3);
+
+	controller.OnRefill(kRegionSize / 2 - 1, kRegionSize, false);
+	EXPECT_EQ(controller.Lead(), 4);
+}
+
+TEST(LatencyController, UnderrunGrowsTheLeadUpToTheMaximum)
+{
+	sound::LatencyController controller(2, 6, 3, 10);
+
+	controller.OnRefill(0, kRegionSize, true);
+	EXPECT_EQ(controller.Lead(), 5);
+
+	controller.OnRefill(0, kRegionSize, true);
+	EXPECT_EQ(controller.Lead(), 6);
+}
+
+TEST(LatencyController, StablePeriodShrinksTheLeadDownToTheMinimum)
+{
+	sound::LatencyController controller(2, 8, 4, 10);
+
+	// Two regions to spare during a whole period: one region less.
+	for (int i = 0; i < 9; i++) {
+		controller.OnRefill(3 * kRegionSize, kRegionSize, false);
+		EXPECT_EQ(controller.Lead(), 4);
+	}
+	controller.OnRefill(3 * kRegionSize, kRegionSize, false);
+	EXPECT_EQ(controller.Lead(), 3);
+
+	for (int i = 0; i < 50; i++) {
+		controller.OnRefill(3 * kRegionSize, kRegionSize, false);
+	}
+	EXPECT_EQ(controller.Lead(), 2);
+}
+
+TEST(LatencyController, TightPeriodKeepsTheLead)
+{
+	sound::LatencyController controller(2, 8, 4, 10);
+
+	// A single refill with less than two regions to spare is enough.
+	for (int i = 0; i < 30; i++) {
+		auto slack = (i % 10 == 5) ? kRegionSize : 3 * kRegionSize;
+		controller.OnRefill(slack, kRegionSize, false);
+	}
+	EXPECT_EQ(controller.Lead(), 4);
+}
+
+TEST(LatencyController, NearMissRestartsTheStablePeriod)
+{
+	sound::LatencyController controller(2, 8, 4, 10);
+
+	for (int i = 0; i < 9; i++) {
+		controller.OnRefill(3 * kRegionSize, kRegionSize, false);
+	}
+	controller.OnRefill(0, kRegionSize, false);
+	EXPECT_EQ(controller.Lead(), 5);
+
+	for (int i = 0; i < 9; i++) {
+		controller.OnRefill(3 * kRegionSize, kRegionSize, false);
+	}
+	EXPECT_EQ(controller.Lead(), 5);
+}
@@ -0,0 +1,105 @@
+#include "pch.h"
+#include "../soundsys/MixKernels.h"
+#include "../soundsys/SampleConversion.h"
+#include <random>
+#include <vector>
+
+// random_samples returns n samples spread over the whole 16-bit range.
+static std::vector<int16_t> random_samples(size_t n, unsigned seed)
+{
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<int> dist(-32768, 32767);
+
+	std::vector<int16_t> samples(n);
+	for (auto &s : samples) {
+		s = static_cast<int16_t>(dist(gen));
+	}
+
+	return samples;
+}
+
+TEST(MixKernels, SingleVoiceAtFullGainIsUnchanged)
+{
+	auto src = random_samples(1001, 1);
+
+	std::vector<float> acc(src.size(), 0.f);
+	sound::AccumulateS16(acc.data(), src.data(), src.size(), 1.f);
+
+	std::vector<int16_t> dst(src.size());
+	sound::ConvertF32ToS16(dst.data(), acc.data(), acc.size());
+
+	EXPECT_EQ(dst, src);
+}
+
+TEST(MixKernels, SumsSaturate)
+{
+	std::vector<int16_t> loud = { 30000, -30000, 20000, -20000, 100, -100, 32767, -32768, 1 };
+
+	std::vector<float> acc(loud.size(), 0.f);
+	sound::AccumulateS16(acc.data(), loud.data(), loud.size(), 1.f);
+	sound::AccumulateS16(acc.data(), loud.data(), loud.size(), 1.f);
+
+	std::vector<int16_t> dst(loud.size());
+	sound::ConvertF32ToS16(dst.data(), acc.data(), acc.size());
+
+	std::vector<int16_t> expected = { 32767, -32768, 32767, -32768, 200, -200, 32767, -32768, 2 };
+	EXPECT_EQ(dst, expected);
+}
+
+TEST(MixKernels, SimdMatchesScalar)
+{
+	// Odd sizes, so that the scalar tail of the SIMD loops is used too.
+	const size_t n = 4099;
+	std::vector<std::vector<int16_t>> voices = { random_samples(n, 2), random_samples(n, 3), random_samples(n, 4) };
+	const float gains[] = { 1.f, 0.5f, 0.3f };
+
+	std::vector<float> acc(n, 0.f), accScalar(n, 0.f);
+	for (size_t v = 0; v < voices.size(); v++) {
+		sound::AccumulateS16(acc.data(), voices[v].data(), n, gains[v]);
+		sound::AccumulateS16_Scalar(accScalar.data(), voices[v].data(), n, gains[v]);
+	}
+
+	// A voice already in floats, mostly out of [-1, 1].
+	std::vector<float> floats(n);
+	for (size_t i = 0; i < n; i++) {
+		floats[i] = voices[0][i] / 8192.f;
+	}
+	sound::AccumulateF32(acc.data(), floats.data(), n, 0.25f);
+	sound::AccumulateF32_Scalar(accScalar.data(), floats.data(), n, 0.25f);
+
+	EXPECT_EQ(acc, accScalar);
+}
+
+TEST(MixKernels, RampsMatchScalar)
+{
+	const size_t numFrames = 1027;
+
+	std::vector<float> linear(numFrames), linearScalar(numFrames);
+	sound::FillLinearRamp(linear.data(), numFrames, 1.f, -1.f / numFrames);
+	sound::FillLinearRamp_Scalar(linearScalar.data(), numFrames, 1.f, -1.f / numFrames);
+	EXPECT_EQ(linear, linearScalar);
+	EXPECT_NEAR(linear.back(), 0.f, 1e-6f);
+
+	std::vector<float> expo(numFrames), expoScalar(numFrames);
+	sound::FillExponentialRamp(expo.data(), numFrames, 0.001f, 1.0068f);
+	sound::FillExponentialRamp_Scalar(expoScalar.data(), numFrames, 0.001f, 1.0068f);
+	EXPECT_EQ(expo, expoScalar);
+
+	for (int numChannels = 1; numChannels <= 2; numChannels++) {
+		const auto n = numFrames * numChannels;
+		auto src = random_samples(n, 5 + numChannels);
+
+		std::vector<float> acc(n, 0.f), accScalar(n, 0.f);
+		sound::AccumulateS16Ramp(acc.data(), src.data(), numFrames, numChannels, linear.data());
+		sound::AccumulateS16Ramp_Scalar(accScalar.data(), src.data(), numFrames, numChannels, linear.data());
+
+		std::vector<float> floats(n);
+		for (size_t i = 0; i < n; i++) {
+			floats[i] = src[i] / 8192.f;
+		}
+		sound::AccumulateF32Ramp(acc.data(), floats.data(), numFrames, numChannels, expo.data());
+		sound::AccumulateF32Ramp_Scalar(accScalar.data(), floats.data(), numFrames, numChannels, expo.data());
+
+		EXPECT_EQ(acc, accScalar);
+	}
+}
@@ -0,0 +1,158 @@
+#include "pch.h"
+#include "../soundsys/Mixer.h"
+#include <vector>
+
+static void write_samples(const std::string &filepath, const std::vector<int16_t> &samples)
+{
+	std::ofstream	ofs(filepath, std::ios::binary);
+	ofs.write((const char*)samples.data(), samples.size() * sizeof(int16_t));
+}
+
+TEST(Mixer, SilentWithoutVoices)
+{
+	sound::Mixer mixer(4, sound::DefaultWaveFormat(), 32);
+
+	auto silent = false;
+	auto data = mixer.Mix(64, &silent);
+	EXPECT_TRUE(silent);
+	EXPECT_EQ(std::vector<byte>(data, data + 64), std::vector<byte>(64, 0));
+}
+
+TEST(Mixer, SingleVoiceIsNotCopied)
+{
+	write_samples("temp.bin", std::vector<int16_t>(64, 1000));
+
+	sound::Mixer mixer(4, sound::DefaultWaveFormat(), 64);
+	ASSERT_FALSE(mixer.MusicVoice().Open("temp.bin", mixer.MaxFrames()));
+
+	auto silent = true;
+	auto data = mixer.Mix(64, &silent);
+	EXPECT_FALSE(silent);
+	EXPECT_EQ(data, mixer.MusicVoice().Data().ptr);
+}
+
+TEST(Mixer, VoicesAreSummedUntilTheyFinish)
+{
+	write_samples("temp.bin", std::vector<int16_t>(32, 1000));
+	write_samples("temp2.bin", std::vector<int16_t>(48, -300));
+
+	sound::Mixer mixer(4, sound::DefaultWaveFormat(), 64);
+	ASSERT_FALSE(mixer.MusicVoice().Open("temp.bin", mixer.MaxFrames()));
+
+	auto sound = mixer.FindFreeVoice();
+	ASSERT_NE(sound, nullptr);
+	ASSERT_FALSE(sound->Open("temp2.bin", mixer.MaxFrames()));
+
+	// Both voices, then the sound alone, then nothing.
+	auto silent = true;
+	auto data = reinterpret_cast<const int16_t *>(mixer.Mix(64, &silent));
+	EXPECT_FALSE(silent);
+	EXPECT_EQ(std::vector<int16_t>(data, data + 32), std::vector<int16_t>(32, 700));
+
+	data = reinterpret_cast<const int16_t *>(mixer.Mix(64, &silent));
+	EXPECT_FALSE(silent);
+	EXPECT_EQ(std::vector<int16_t>(data, data + 16), std::vector<int16_t>(16, -300));
+	EXPECT_EQ(std::vector<int16_t>(data + 16, data + 32), std::vector<int16_t>(16, 0));
+
+	data = reinterpret_cast<const int16_t *>(mixer.Mix(64, &silent));
+	EXPECT_TRUE(silent);
+	EXPECT_FALSE(mixer.HasPlayingVoices());
+}
+
+TEST(Mixer, NoFreeVoiceWhenAllSoundsPlay)
+{
+	write_samples("temp.bin", std::vector<int16_t>(64, 1));
+
+	sound::Mixer mixer(3, sound::DefaultWaveFormat(), 64);
+	for (int i = 0; i < 2; i++) {
+		auto voice = mixer.FindFreeVoice();
+		ASSERT_NE(voice, nullptr);
+		ASSERT_FALSE(voice->Open("temp.bin", mixer.MaxFrames()));
+	}
+
+	EXPECT_EQ(mixer.FindFreeVoice(), nullptr);
+}
+
+TEST(Mixer, CrossfadeKeepsTheLevelAndClosesThePreviousMusic)
+{
+	write_samples("temp.bin", std::vector<int16_t>(1024, 1000));
+	write_samples("temp2.bin", std::vector<int16_t>(1024, 1000));
+
+	sound::Mixer mixer(4, sound::DefaultWaveFormat(), 64);
+	ASSERT_FALSE(mixer.MusicVoice().Open("temp.bin", mixer.MaxFrames()));
+
+	auto silent = true;
+	mixer.Mix(128, &silent);
+
+	// Linear fades in and out add up to a constant gain.
+	mixer.SwapMusicVoices();
+	mixer.FadingMusicVoice().FadeOut(100, sound::FADE_CURVE_LINEAR);
+	ASSERT_FALSE(mixer.MusicVoice().Open("temp2.bin", mixer.MaxFrames()));
+	mixer.MusicVoice().SetGain(0.f);
+	mixer.MusicVoice().RampGain(1.f, 100, sound::FADE_CURVE_LINEAR);
+
+	for (int i = 0; i < 3; i++) {
+		auto data = reinterpret_cast<const int16_t *>(mixer.Mix(128, &silent));
+		for (int k = 0; k < 64; k++) {
+			EXPECT_NEAR(data[k], 1000, 1);
+		}
+	}
+
+	EXPECT_FALSE(mixer.FadingMusicVoice().IsOpen());
+	EXPECT_TRUE(mixer.MusicVoice().IsPlaying());
+}
+
+TEST(Mixer, NextMusicStartsOnTheFrameAfterTheEnd)
+{
+	write_samples("temp.bin", std::vector<int16_t>(100, 1000));
+	write_samples("temp2.bin", std::vector<int16_t>(200, 2000));
+
+	sound::Mixer mixer(4, sound::DefaultWaveFormat(), 64);
+	ASSERT_FALSE(mixer.MusicVoice().Open("temp.bin", mixer.MaxFrames()));
+	ASSERT_FALSE(mixer.NextMusicVoice().Open("temp2.bin", mixer.MaxFrames()));
+	mixer.QueueNextMusic();
+
+	// 100 frames of the first music, then 200 of the next one, in chunks of 64 frames.
+	std::vector<int16_t> played;
+	auto silent = true;
+	for (int i = 0; i < 5; i++) {
+		auto data = reinterpret_cast<const int16_t *>(mixer.Mix(128, &silent));
+		played.insert(played.end(), data, data + 64);
+	}
+
+	std::vector<int16_t> expected(100, 1000);
+	expected.insert(expected.end(), 200, 2000);
+	expected.insert(expected.end(), 20, 0);
+	EXPECT_EQ(played, expected);
+}
+
+TEST(Mixer, LoopRepeatsTheRegionSampleAccurately)
+{
+	// Frames whose samples are their index.
+	std::vector<int16_t> samples;
+	for (int16_t i = 0; i < 100; i++) {
+		samples.push_back(i);
+	}
+	write_samples("temp.bin", samples);
+
+	sound::Mixer mixer(4, sound::DefaultWaveFormat(), 64);
+	ASSERT_FALSE(mixer.MusicVoice().Open("temp.bin", mixer.MaxFrames()));
+	ASSERT_FALSE(mixer.MusicVoice().SetLoop(20, 70));
+
+	// The frames 0 to 69, then the frames 20 to 69 over and over.
+	std::vector<int16_t> expected;
+	for (int16_t i = 0; expected.size() < 300; i = (i == 69) ? 20 : i + 1) {
+		expected.push_back(i);
+	}
+
+	std::vector<int16_t> played;
+	auto silent = true;
+	for (int i = 0; i < 10; i++) {
+		auto data = reinterpret_cast<const int16_t *>(mixer.Mix(2 * 30, &silent));
+		EXPECT_FALSE(silent);
+		played.insert(played.end(), data, data + 30);
+	}
+
+	EXPECT_EQ(played, expected);
+	EXPECT_TRUE(mixer.MusicVoice().IsPlaying());
+}
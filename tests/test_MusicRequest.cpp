@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "../soundsys/MusicRequest.h"
+
+TEST(MusicRequest, SuccessivePlaysCollapseToTheLast)
+{
+	sound::MusicRequest reqs[] = {
+		sound::MakeMusicRequest_Play(1),
+		sound::MakeMusicRequest_Play(2),
+		sound::MakeMusicRequest_Play(3),
+	};
+
+	auto count = sound::CoalesceMusicRequests(reqs, 3);
+	ASSERT_EQ(count, 1u);
+	EXPECT_EQ(reqs[0].type, sound::MUSIC_REQUEST_TYPE_PLAY);
+	EXPECT_EQ(reqs[0].asset, 3u);
+}
+
+TEST(MusicRequest, StopCancelsPreviousPlays)
+{
+	sound::MusicRequest reqs[] = {
+		sound::MakeMusicRequest_Play(1),
+		sound::MakeMusicRequest_Stop(),
+		sound::MakeMusicRequest_Play(2),
+		sound::MakeMusicRequest_Stop(),
+	};
+
+	auto count = sound::CoalesceMusicRequests(reqs, 4);
+	ASSERT_EQ(count, 1u);
+	EXPECT_EQ(reqs[0].type, sound::MUSIC_REQUEST_TYPE_STOP);
+}
+
+TEST(MusicRequest, PauseAfterPlayIsKept)
+{
+	sound::MusicRequest reqs[] = {
+		sound::MakeMusicRequest_Pause(),
+		sound::MakeMusicRequest_Play(1),
+		sound::MakeMusicRequest_Pause(),
+		sound::MakeMusicRequest_Pause(),
+	};
+
+	auto count = sound::CoalesceMusicRequests(reqs, 4);
+	ASSERT_EQ(count, 2u);
+	EXPECT_EQ(reqs[0].type, sound::MUSIC_REQUEST_TYPE_PLAY);
+	EXPECT_EQ(reqs[1].type, sound::MUSIC_REQUEST_TYPE_PAUSE);
+}
+
+TEST(MusicRequest, SoundsAreNotSuperseded)
+{
+	sound::MusicRequest reqs[] = {
+		sound::MakeMusicRequest_PlaySound(1),
+		sound::MakeMusicRequest_Play(2),
+		sound::MakeMusicRequest_PlaySound(1),
+		sound::MakeMusicRequest_Stop(),
+	};
+
+	auto count = sound::CoalesceMusicRequests(reqs, 4);
+	ASSERT_EQ(count, 3u);
+	EXPECT_EQ(reqs[0].type, sound::MUSIC_REQUEST_TYPE_PLAY_SOUND);
+	EXPECT_EQ(reqs[1].type, sound::MUSIC_REQUEST_TYPE_PLAY_SOUND);
+	EXPECT_EQ(reqs[2].type, sound::MUSIC_REQUEST_TYPE_STOP);
+}
+
+TEST(MusicRequest, OnlyTheLastNextMusicIsQueued)
+{
+	sound::MusicRequest reqs[] = {
+		sound::MakeMusicRequest_Play(1),
+		sound::MakeMusicRequest_PlayNext(2),
+		sound::MakeMusicRequest_PlayNext(3),
+	};
+
+	auto count = sound::CoalesceMusicRequests(reqs, 3);
+	ASSERT_EQ(count, 2u);
+	EXPECT_EQ(reqs[0].type, sound::MUSIC_REQUEST_TYPE_PLAY);
+	EXPECT_EQ(reqs[1].type, sound::MUSIC_REQUEST_TYPE_PLAY_NEXT);
+	EXPECT_EQ(reqs[1].asset, 3u);
+}
+
+TEST(MusicRequest, OnlyTheLastPauseOrResumeIsKept)
+{
+	sound::MusicRequest reqs[] = {
+		sound::MakeMusicRequest_Play(1),
+		sound::MakeMusicRequest_Pause(),
+		sound::MakeMusicRequest_Resume(),
+		sound::MakeMusicRequest_Pause(),
+		sound::MakeMusicRequest_Stop(),
+	};
+
+	// The stop leaves the sounds paused.
+	auto count = sound::CoalesceMusicRequests(reqs, 5);
+	ASSERT_EQ(count, 2u);
+	EXPECT_EQ(reqs[0].type, sound::MUSIC_REQUEST_TYPE_PAUSE);
+	EXPECT_EQ(reqs[1].type, sound::MUSIC_REQUEST_TYPE_STOP);
+
+	// A new music ends the pause.
+	sound::MusicRequest more[] = {
+		sound::MakeMusicRequest_Pause(),
+		sound::MakeMusicRequest_Resume(),
+		sound::MakeMusicRequest_Play(2),
+	};
+
+	count = sound::CoalesceMusicRequests(more, 3);
+	ASSERT_EQ(count, 1u);
+	EXPECT_EQ(more[0].type, sound::MUSIC_REQUEST_TYPE_PLAY);
+}
+
+TEST(MusicRequest, CrossfadeKeepsTheStopBeforeIt)
+{
+	sound::MusicRequest reqs[] = {
+		sound::MakeMusicRequest_Play(1),
+		sound::MakeMusicRequest_Stop(),
+		sound::MakeMusicRequest_PlayCrossfade(2, 500, sound::FADE_CURVE_LINEAR),
+	};
+
+	// The stopped music must not fade out: the new one starts from silence.
+	auto count = sound::CoalesceMusicRequests(reqs, 3);
+	ASSERT_EQ(count, 2u);
+	EXPECT_EQ(reqs[0].type, sound::MUSIC_REQUEST_TYPE_STOP);
+	EXPECT_EQ(reqs[1].type, sound::MUSIC_REQUEST_TYPE_PLAY);
+	EXPECT_EQ(reqs[1].asset, 2u);
+	EXPECT_EQ(reqs[1].fadeMs, 500u);
+}
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "../soundsys/Resampler.h"
+#include <cmath>
+#include <vector>
+
+// resample converts a whole signal, in chunks of at most chunkFrames output frames.
+static std::vector<float> resample(sound::Resampler &resampler, const std::vector<float> &in, size_t numOutFrames, size_t chunkFrames)
+{
+	const auto numChannels = resampler.NumChannels();
+
+	std::vector<float> out(numOutFrames * numChannels);
+	size_t inPos = 0;
+	for (size_t outPos = 0; outPos < numOutFrames; ) {
+		auto n = std::min(chunkFrames, numOutFrames - outPos);
+		auto numIn = resampler.InputFramesNeeded(n);
+
+		// Past the end of the signal, the input is silence.
+		std::vector<float> chunk(numIn * numChannels, 0.f);
+		for (size_t i = 0; i < chunk.size() && inPos * numChannels + i < in.size(); i++) {
+			chunk[i] = in[inPos * numChannels + i];
+		}
+
+		resampler.Process(chunk.data(), numIn, out.data() + outPos * numChannels, n);
+		inPos += numIn;
+		outPos += n;
+	}
+
+	return out;
+}
+
+static std::vector<float> sine(size_t numFrames, double frequency, double rate)
+{
+	std::vector<float> samples(numFrames);
+	for (size_t i = 0; i < numFrames; i++) {
+		samples[i] = static_cast<float>(0.5 * std::sin(2. * 3.14159265358979323846 * frequency * i / rate));
+	}
+
+	return samples;
+}
+
+TEST(Resampler, ConstantSignalKeepsItsLevel)
+{
+	sound::Resampler resampler;
+	resampler.Init(44100, 48000, 2, sound::RESAMPLER_QUALITY_MEDIUM, 512);
+
+	std::vector<float> in(2 * 10000, 0.25f);
+	auto out = resample(resampler, in, 8000, 512);
+
+	// Past the start, where the filter sees the silence before the stream.
+	for (size_t i = 2 * 16; i < out.size(); i++) {
+		EXPECT_NEAR(out[i], 0.25f, 1e-5f);
+	}
+}
+
+TEST(Resampler, ChunksGiveTheSameOutputAsOnePiece)
+{
+	const auto in = sine(5000, 440., 22050.);
+
+	sound::Resampler whole;
+	whole.Init(22050, 44100, 1, sound::RESAMPLER_QUALITY_HIGH, 9000);
+	auto expected = resample(whole, in, 9000, 9000);
+
+	sound::Resampler chunked;
+	chunked.Init(22050, 44100, 1, sound::RESAMPLER_QUALITY_HIGH, 700);
+	auto out = resample(chunked, in, 9000, 700);
+
+	EXPECT_EQ(out, expected);
+}
+
+TEST(Resampler, InputFollowsTheRateRatio)
+{
+	sound::Resampler resampler;
+	resampler.Init(48000, 44100, 1, sound::RESAMPLER_QUALITY_LOW, 441);
+
+	// The first chunk also reads ahead the frames of the filter.
+	size_t numIn = 0;
+	for (int i = 0; i < 100; i++) {
+		auto n = resampler.InputFramesNeeded(441);
+		EXPECT_LE(n, resampler.MaxInputFrames());
+
+		std::vector<float> in(n, 0.f), out(441);
+		resampler.Process(in.data(), n, out.data(), 441);
+		numIn += n;
+	}
+
+	EXPECT_NEAR(static_cast<double>(numIn), 100 * 480., resampler.NumTaps());
+}
+
+TEST(Resampler, SineKeepsItsFrequencyAndPhase)
+{
+	const auto in = sine(20000, 1000., 32000.);
+
+	for (auto quality : { sound::RESAMPLER_QUALITY_LOW, sound::RESAMPLER_QUALITY_MEDIUM, sound::RESAMPLER_QUALITY_HIGH }) {
+		sound::Resampler resampler;
+		resampler.Init(32000, 44100, 1, quality, 1024);
+		auto out = resample(resampler, in, 20000, 1024);
+
+		// The resampler adds no delay: the output is the same sine, sampled at the new rate.
+		auto expected = sine(20000, 1000., 44100.);
+		for (size_t i = 100; i < out.size(); i++) {
+			ASSERT_NEAR(out[i], expected[i], 2e-3f) << "quality " << quality << ", frame " << i;
+		}
+	}
+}
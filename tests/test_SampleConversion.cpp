@@ -0,0 +1,177 @@
+#include "pch.h"
+#include "../soundsys/SampleConversion.h"
+#include <limits>
+#include <random>
+#include <vector>
+
+// Odd sizes, so that the scalar tail of the SIMD loops is used too.
+static const size_t kNumSamples = 1027;
+
+// random_floats returns n samples, some out of [-1, 1], some exactly halfway
+// between two 16-bit values, and a few infinities.
+static std::vector<float> random_floats(size_t n, unsigned seed)
+{
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> dist(-1.25f, 1.25f);
+	std::uniform_int_distribution<int> ints(-32768, 32767);
+
+	std::vector<float> samples(n);
+	for (size_t i = 0; i < n; i++) {
+		samples[i] = (i % 4 == 0) ? (ints(gen) + 0.5f) / 32768.f : dist(gen);
+	}
+
+	samples[1] = std::numeric_limits<float>::infinity();
+	samples[2] = -std::numeric_limits<float>::infinity();
+	samples[3] = 1.f;
+	samples[5] = -1.f;
+
+	return samples;
+}
+
+static std::vector<byte> random_bytes(size_t n, unsigned seed)
+{
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<int> dist(0, 255);
+
+	std::vector<byte> bytes(n);
+	for (auto &b : bytes) {
+		b = static_cast<byte>(dist(gen));
+	}
+
+	return bytes;
+}
+
+// supported_levels returns the instruction sets the CPU can run, scalar excepted.
+static std::vector<sound::SIMD_LEVEL> supported_levels()
+{
+	std::vector<sound::SIMD_LEVEL> levels;
+	for (int level = sound::SIMD_LEVEL_SSE2; level <= sound::DetectSimdLevel(); level++) {
+		levels.push_back(static_cast<sound::SIMD_LEVEL>(level));
+	}
+
+	return levels;
+}
+
+TEST(SampleConversion, S16RoundTrip)
+{
+	std::vector<int16_t> src(65536);
+	for (size_t i = 0; i < src.size(); i++) {
+		src[i] = static_cast<int16_t>(i - 32768);
+	}
+
+	std::vector<float> floats(src.size());
+	sound::ConvertS16ToF32(floats.data(), src.data(), src.size());
+	EXPECT_EQ(floats.front(), -1.f);
+
+	std::vector<int16_t> dst(src.size());
+	sound::ConvertF32ToS16(dst.data(), floats.data(), floats.size());
+	EXPECT_EQ(dst, src);
+}
+
+TEST(SampleConversion, S24RoundTrip)
+{
+	auto src = random_bytes(3 * kNumSamples, 1);
+
+	std::vector<float> floats(kNumSamples);
+	sound::ConvertS24ToF32(floats.data(), src.data(), kNumSamples);
+
+	std::vector<byte> dst(src.size());
+	sound::ConvertF32ToS24(dst.data(), floats.data(), kNumSamples);
+	EXPECT_EQ(dst, src);
+}
+
+TEST(SampleConversion, SaturatesAndRoundsToEven)
+{
+	const std::vector<float> src = { 2.f, -2.f, 0.5f / 32768.f, 1.5f / 32768.f, -2.5f / 32768.f };
+
+	std::vector<int16_t> dst(src.size());
+	sound::ConvertF32ToS16(dst.data(), src.data(), src.size());
+
+	const std::vector<int16_t> expected = { 32767, -32768, 0, 2, -2 };
+	EXPECT_EQ(dst, expected);
+}
+
+TEST(SampleConversion, ChannelsRoundTrip)
+{
+	auto left = random_floats(kNumSamples, 2);
+	auto right = random_floats(kNumSamples, 3);
+
+	std::vector<float> stereo(2 * kNumSamples);
+	sound::Interleave(stereo.data(), left.data(), right.data(), kNumSamples);
+	EXPECT_EQ(stereo[0], left[0]);
+	EXPECT_EQ(stereo[1], right[0]);
+
+	std::vector<float> l(kNumSamples), r(kNumSamples);
+	sound::Deinterleave(l.data(), r.data(), stereo.data(), kNumSamples);
+	EXPECT_EQ(l, left);
+	EXPECT_EQ(r, right);
+
+	std::vector<float> mono(kNumSamples);
+	sound::MonoToStereo(stereo.data(), left.data(), kNumSamples);
+	sound::StereoToMono(mono.data(), stereo.data(), kNumSamples);
+	EXPECT_EQ(mono, left);
+}
+
+TEST(SampleConversion, SimdMatchesScalar)
+{
+	const auto &scalar = sound::GetConversionKernels(sound::SIMD_LEVEL_SCALAR);
+
+	auto floats = random_floats(2 * kNumSamples, 4);
+	auto bytes = random_bytes(3 * kNumSamples, 5);
+	const auto *s16 = reinterpret_cast<const int16_t *>(bytes.data());
+
+	for (auto level : supported_levels()) {
+		const auto &kernels = sound::GetConversionKernels(level);
+		SCOPED_TRACE(sound::SimdLevelName(kernels.level));
+
+		{
+			std::vector<float> a(kNumSamples), b(kNumSamples);
+			kernels.s16ToF32(a.data(), s16, kNumSamples);
+			scalar.s16ToF32(b.data(), s16, kNumSamples);
+			EXPECT_EQ(a, b);
+		}
+		{
+			std::vector<int16_t> a(kNumSamples), b(kNumSamples);
+			kernels.f32ToS16(a.data(), floats.data(), kNumSamples);
+			scalar.f32ToS16(b.data(), floats.data(), kNumSamples);
+			EXPECT_EQ(a, b);
+		}
+		{
+			std::vector<float> a(kNumSamples), b(kNumSamples);
+			kernels.s24ToF32(a.data(), bytes.data(), kNumSamples);
+			scalar.s24ToF32(b.data(), bytes.data(), kNumSamples);
+			EXPECT_EQ(a, b);
+		}
+		{
+			std::vector<byte> a(3 * kNumSamples), b(3 * kNumSamples);
+			kernels.f32ToS24(a.data(), floats.data(), kNumSamples);
+			scalar.f32ToS24(b.data(), floats.data(), kNumSamples);
+			EXPECT_EQ(a, b);
+		}
+		{
+			std::vector<float> a(2 * kNumSamples), b(2 * kNumSamples);
+			kernels.monoToStereo(a.data(), floats.data(), kNumSamples);
+			scalar.monoToStereo(b.data(), floats.data(), kNumSamples);
+			EXPECT_EQ(a, b);
+		}
+		{
+			std::vector<float> a(kNumSamples), b(kNumSamples);
+			kernels.stereoToMono(a.data(), floats.data(), kNumSamples);
+			scalar.stereoToMono(b.data(), floats.data(), kNumSamples);
+			EXPECT_EQ(a, b);
+		}
+		{
+			std::vector<float> a(2 * kNumSamples), b(2 * kNumSamples);
+			kernels.interleave(a.data(), floats.data(), floats.data() + kNumSamples, kNumSamples);
+			scalar.interleave(b.data(), floats.data(), floats.data() + kNumSamples, kNumSamples);
+			EXPECT_EQ(a, b);
+		}
+		{
+			std::vector<float> al(kNumSamples), ar(kNumSamples), bl(kNumSamples), br(kNumSamples);
+			kernels.deinterleave(al.data(), ar.data(), floats.data(), kNumSamples);
+			scalar.deinterleave(bl.data(), br.data(), floats.data(), kNumSamples);
+			EXPECT_EQ(al, bl);
+			EXPECT_EQ(ar, br);
+		}
+	}
+}
@@ -0,0 +1,723 @@
+#include "pch.h"
+#include "../soundsys/SoundSystem.h"
+#include "../soundsys/HeadlessDevice.h"
+#include "../soundsys/Adpcm.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+// The global allocator counts the allocations of the threads that ask for it:
+// the steady state of the streaming must not allocate.
+static thread_local bool	t_countAllocations = false;
+static std::atomic<size_t>	g_numAllocations{ 0 };
+
+// Every form of new and delete is replaced, so that each delete frees memory of the
+// allocator that the matching new used. The allocator is not inlined: a compiler that
+// sees free called on the result of new would warn about a mismatch.
+#if defined(_MSC_VER)
+#define TEST_NOINLINE __declspec(noinline)
+#elif defined(__GNUC__)
+#define TEST_NOINLINE __attribute__((noinline))
+#else
+#define TEST_NOINLINE
+#endif
+
+TEST_NOINLINE static void *CountedAlloc(size_t size, size_t alignment)
+{
+	if (t_countAllocations) {
+		g_numAllocations++;
+	}
+
+#if defined(_MSC_VER)
+	return _aligned_malloc(size ? size : 1, alignment);
+#else
+	// aligned_alloc wants a size that is a multiple of the alignment.
+	size = (size + alignment - 1) / alignment * alignment;
+	return std::aligned_alloc(alignment, size ? size : alignment);
+#endif
+}
+
+TEST_NOINLINE static void CountedFree(void *p) noexcept
+{
+#if defined(_MSC_VER)
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+
+void *operator new(size_t size)
+{
+	auto p = CountedAlloc(size, alignof(std::max_align_t));
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+	auto p = CountedAlloc(size, static_cast<size_t>(alignment));
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return CountedAlloc(size, alignof(std::max_align_t)); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return CountedAlloc(size, alignof(std::max_align_t)); }
+
+void operator delete(void *p) noexcept { CountedFree(p); }
+void operator delete[](void *p) noexcept { CountedFree(p); }
+void operator delete(void *p, size_t) noexcept { CountedFree(p); }
+void operator delete[](void *p, size_t) noexcept { CountedFree(p); }
+void operator delete(void *p, std::align_val_t) noexcept { CountedFree(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { CountedFree(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { CountedFree(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { CountedFree(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { CountedFree(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { CountedFree(p); }
+
+static void write_file(const std::string &filepath, size_t size, byte value)
+{
+	std::vector<byte> data(size, value);
+
+	std::ofstream	ofs(filepath, std::ios::binary);
+	ofs.write((const char*)data.data(), data.size());
+}
+
+// write_wav_samples writes a mono 16-bit WAV file.
+static void write_wav_samples(const std::string &filepath, DWORD samplesPerSec, const std::vector<int16_t> &samples)
+{
+	auto put32 = [](std::ofstream &ofs, uint32_t v) { ofs.write((const char*)&v, 4); };
+	auto put16 = [](std::ofstream &ofs, uint16_t v) { ofs.write((const char*)&v, 2); };
+
+	const auto numFrames = samples.size();
+
+	std::ofstream	ofs(filepath, std::ios::binary);
+	ofs.write("RIFF", 4);
+	put32(ofs, static_cast<uint32_t>(36 + 2 * numFrames));
+	ofs.write("WAVEfmt ", 8);
+	put32(ofs, 16);
+	put16(ofs, WAVE_FORMAT_PCM);
+	put16(ofs, 1);
+	put32(ofs, samplesPerSec);
+	put32(ofs, 2 * samplesPerSec);
+	put16(ofs, 2);
+	put16(ofs, 16);
+	ofs.write("data", 4);
+	put32(ofs, static_cast<uint32_t>(2 * numFrames));
+
+	ofs.write((const char*)samples.data(), 2 * numFrames);
+}
+
+// write_wav writes a mono 16-bit WAV file of numFrames frames.
+static void write_wav(const std::string &filepath, DWORD samplesPerSec, size_t numFrames, int16_t value)
+{
+	write_wav_samples(filepath, samplesPerSec, std::vector<int16_t>(numFrames, value));
+}
+
+// LateDevice reports a play cursor that is numLateBytes ahead of the simulated one,
+// as if the streaming thread always woke up that late.
+class LateDevice : public sound::NullDevice {
+public:
+	LateDevice(DWORD numLateBytes) : m_numLateBytes(numLateBytes) {}
+
+	void CreateBuffer(const WAVEFORMATEX &format, DWORD capacity, const std::vector<DWORD> &notifyOffsets) override
+	{
+		sound::NullDevice::CreateBuffer(format, capacity, notifyOffsets);
+		m_capacity = capacity;
+	}
+
+	DWORD PlayCursor() override { return (sound::NullDevice::PlayCursor() + m_numLateBytes) % m_capacity; }
+
+private:
+	DWORD	m_numLateBytes;
+	DWORD	m_capacity{ 1 };
+};
+
+// wait_until_stopped waits for the system to play and stop, with a time limit.
+static bool wait_until_stopped(sound::SoundSystem *system, sound::SimulatedDevice *device)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	while (device->PlayedBytes() == 0 || system->IsPlaying()) {
+		if (std::chrono::steady_clock::now() - start > std::chrono::seconds(5)) {
+			return false;
+		}
+		std::this_thread::yield();
+	}
+
+	return true;
+}
+
+TEST(SoundSystem, CreateAndDestroy)
+{
+	sound::SoundSystem	*system = nullptr;
+	auto err = sound::CreateSoundSystem(new sound::NullDevice(), &system);
+	ASSERT_FALSE(err);
+	EXPECT_FALSE(system->IsPlaying());
+
+	sound::DestroySoundSystem(&system);
+	EXPECT_EQ(system, nullptr);
+}
+
+TEST(SoundSystem, PlaysAFileToTheEnd)
+{
+	write_file("temp.bin", 3 * 88200, 0x11);
+
+	auto device = new sound::NullDevice(sound::DEVICE_CLOCK_AS_FAST_AS_POSSIBLE);
+
+	sound::SoundSystem	*system = nullptr;
+	ASSERT_FALSE(sound::CreateSoundSystem(device, &system));
+
+	system->Play("temp.bin");
+	EXPECT_TRUE(wait_until_stopped(system, device));
+
+	// The whole file went through the buffer, followed by some silence.
+	EXPECT_GE(device->PlayedBytes(), 3u * 88200u);
+
+	sound::DestroySoundSystem(&system);
+}
+
+TEST(SoundSystem, ReplayedFileComesFromTheCache)
+{
+	write_file("temp.bin", 88200, 0x22);
+
+	auto device = new sound::NullDevice(sound::DEVICE_CLOCK_AS_FAST_AS_POSSIBLE);
+
+	sound::SoundSystem	*system = nullptr;
+	ASSERT_FALSE(sound::CreateSoundSystem(device, &system));
+
+	system->Play("temp.bin");
+	ASSERT_TRUE(wait_until_stopped(system, device));
+	EXPECT_EQ(system->CacheStats().misses, 1u);
+	EXPECT_EQ(system->CacheStats().residentBytes, 88200u);
+
+	auto playedBytes = device->PlayedBytes();
+	system->Play("temp.bin");
+	while (device->PlayedBytes() == playedBytes) {
+		std::this_thread::yield();
+	}
+	ASSERT_TRUE(wait_until_stopped(system, device));
+	EXPECT_EQ(system->CacheStats().hits, 1u);
+
+	sound::DestroySoundSystem(&system);
+}
+
+TEST(SoundSystem, SoundsPlayOverTheMusic)
+{
+	write_file("temp.bin", 2 * 88200, 0x01);
+	write_file("temp2.bin", 88200, 0x02);
+
+	// Offline, the three requests are handled by the same step: with a streaming thread,
+	// the first sound could end before the music is registered and pushed.
+	auto device = new sound::NullDevice(sound::DEVICE_CLOCK_MANUAL);
+
+	sound::SoundSystem	*system = nullptr;
+	ASSERT_FALSE(sound::CreateOfflineSoundSystem(device, &system));
+
+	// A sound alone starts the buffer, like a music.
+	system->PlaySound("temp2.bin");
+	system->Play("temp.bin");
+	system->PlaySound("temp2.bin");
+	ASSERT_FALSE(system->Render(100000));
+	EXPECT_FALSE(system->IsPlaying());
+	EXPECT_GE(device->PlayedBytes(), 2u * 88200u);
+
+	sound::DestroySoundSystem(&system);
+}
+
+TEST(SoundSystem, ConvertsWavFilesToTheBufferFormat)
+{
+	const size_t numFrames = 30000;
+	write_wav("temp_in.wav", 48000, numFrames, 0x1111);
+
+	sound::SoundSystemDesc desc;
+	desc.format = sound::MakeWaveFormat(WAVE_FORMAT_IEEE_FLOAT, 2, 48000, 32);
+
+	auto device = new sound::WavFileDevice("temp_out.wav", sound::DEVICE_CLOCK_AS_FAST_AS_POSSIBLE);
+
+	sound::SoundSystem	*system = nullptr;
+	ASSERT_FALSE(sound::CreateSoundSystem(device, &system, desc));
+
+	system->Play("temp_in.wav");
+	EXPECT_TRUE(wait_until_stopped(system, device));
+	sound::DestroySoundSystem(&system);
+
+	// Every frame of the data chunk was played once, in both channels, and nothing else:
+	// the header of the input file was not played as audio.
+	std::ifstream	ifs("temp_out.wav", std::ios::binary);
+	ifs.seekg(44);
+	std::vector<float> played;
+	float frame[2];
+	while (ifs.read((char*)frame, sizeof(frame))) {
+		if (frame[0] != 0.f || frame[1] != 0.f) {
+			EXPECT_EQ(frame[0], 0x1111 / 32768.f);
+			EXPECT_EQ(frame[1], 0x1111 / 32768.f);
+			played.push_back(frame[0]);
+		}
+	}
+	EXPECT_EQ(played.size(), numFrames);
+}
+
+TEST(SoundSystem, ResamplesFilesToTheBufferRate)
+{
+	const size_t numFrames = 22050;
+	write_wav("temp_in.wav", 22050, numFrames, 0x1111);
+
+	auto device = new sound::WavFileDevice("temp_out.wav", sound::DEVICE_CLOCK_AS_FAST_AS_POSSIBLE);
+
+	sound::SoundSystem	*system = nullptr;
+	ASSERT_FALSE(sound::CreateSoundSystem(device, &system));
+
+	system->Play("temp_in.wav");
+	EXPECT_TRUE(wait_until_stopped(system, device));
+	sound::DestroySoundSystem(&system);
+
+	// One second at 22.05 kHz is one second at 44.1 kHz, give or take the edges
+	// smoothed by the filter.
+	std::ifstream	ifs("temp_out.wav", std::ios::binary);
+	ifs.seekg(44);
+	size_t numLoud = 0;
+	int16_t sample;
+	while (ifs.read((char*)&sample, sizeof(sample))) {
+		// The filter rings a little around the steps at both ends.
+		EXPECT_LE(sample, 0x1111 + 0x1111 / 5);
+		numLoud += (sample > 0x1111 / 2) ? 1 : 0;
+	}
+	EXPECT_NEAR(static_cast<double>(numLoud), 2. * numFrames, 16.);
+}
+
+TEST(SoundSystem, NextMusicFollowsWithoutAGap)
+{
+	// The first music is still playing when the next one is queued.
+	write_wav("temp_in.wav", 44100, 100000, 0x1111);
+	write_wav("temp_in2.wav", 44100, 50000, 0x2222);
+
+	// Offline, both requests are handled by the same step: with a streaming thread,
+	// the first music could end before the second request is pushed.
+	auto device = new sound::WavFileDevice("temp_out.wav", sound::DEVICE_CLOCK_MANUAL);
+
+	sound::SoundSystem	*system = nullptr;
+	ASSERT_FALSE(sound::CreateOfflineSoundSystem(device, &system));
+
+	ASSERT_FALSE(system->Play("temp_in.wav"));
+	ASSERT_FALSE(system->PlayNext("temp_in2.wav"));
+	ASSERT_FALSE(system->Render(160000));
+	EXPECT_FALSE(system->IsPlaying());
+	sound::DestroySoundSystem(&system);
+
+	// The buffer was not restarted: the second music follows the first on the next frame.
+	std::ifstream	ifs("temp_out.wav", std::ios::binary);
+	ifs.seekg(44);
+	std::vector<int16_t> played(150000 + 1000);
+	ifs.read((char*)played.data(), played.size() * sizeof(int16_t));
+
+	std::vector<int16_t> expected(100000, 0x1111);
+	expected.insert(expected.end(), 50000, 0x2222);
+	expected.insert(expected.end(), 1000, 0);
+	EXPECT_EQ(played, expected);
+}
+
+TEST(SoundSystem, AdaptiveLatencyShrinksWithoutAGlitch)
+{
+	// 3 seconds of a sawtooth, which shows any frame played twice or skipped.
+	std::vector<int16_t> samples(3 * 44100);
+	for (size_t i = 0; i < samples.size(); i++) {
+		samples[i] = static_cast<int16_t>(1 + i % 1000);
+	}
+	write_wav_samples("temp_in.wav", 44100, samples);
+
+	sound::SoundSystemDesc desc;
+	desc.latencyMs = 80;
+	desc.numRegions = 4;
+	desc.adaptiveLatency = true;
+
+	auto device = new sound::WavFileDevice("temp_out.wav", sound::DEVICE_CLOCK_AS_FAST_AS_POSSIBLE);
+
+	sound::SoundSystem	*system = nullptr;
+	ASSERT_FALSE(sound::CreateSoundSystem(device, &system, desc));
+	EXPECT_EQ(system->LatencyMs(), 60u);
+
+	// Without a deadline to miss, the refills come closer to the play cursor
+	// after each stable period of 2 seconds, down to 2 regions.
+	system->Play("temp_in.wav");
+	EXPECT_TRUE(wait_until_stopped(system, device));
+	EXPECT_EQ(system->LatencyMs(), 40u);
+	sound::DestroySoundSystem(&system);
+
+	std::ifstream	ifs("temp_out.wav", std::ios::binary);
+	ifs.seekg(44);
+	std::vector<int16_t> played(samples.size() + 1000);
+	ifs.read((char*)played.data(), played.size() * sizeof(int16_t));
+
+	auto expected = samples;
+	expected.insert(expected.end(), 1000, 0);
+	EXPECT_EQ(played, expected);
+}
+
+TEST(SoundSystem, HealthCountsLateRefills)
+{
+	write_file("temp.bin", 88200, 0x11);
+
+	// 4 regions of 20 ms: the refills are written 3 regions ahead of the play cursor.
+	const DWORD regionSize = 1764;
+	struct Case { DWORD numLateBytes; bool underrun; bool nearMiss; };
+	for (auto c : { Case{ 0, false, false }, Case{ regionSize * 11 / 4, false, true }, Case{ regionSize * 7 / 2, true, false } }) {
+		auto device = new LateDevice(c.numLateBytes);
+
+		sound::SoundSystem	*system = nullptr;
+		ASSERT_FALSE(sound::CreateSoundSystem(device, &system));
+
+		system->Play("temp.bin");
+		EXPECT_TRUE(wait_until_stopped(system, device));
+
+		auto health = system->Health();
+		EXPECT_GE(health.numRefills, 50u);
+		EXPECT_EQ(health.numUnderruns, c.underrun ? health.numRefills : 0u);
+		EXPECT_EQ(health.numNearMisses, c.nearMiss ? health.numRefills : 0u);
+		EXPECT_EQ(health.refillDuration.count, health.numRefills);
+		EXPECT_EQ(health.readLatency.count, health.numRefills);
+
+		// Every wakeup was as late as the cursor says.
+		auto lateUs = static_cast<uint64_t>(c.numLateBytes) * 1000000 / 88200;
+		EXPECT_EQ(health.wakeupJitter.maxMicroseconds, lateUs);
+
+		sound::DestroySoundSystem(&system);
+	}
+}
+
+// read_wav_data reads the samples of a mono 16-bit WAV file written by a WavFileDevice.
+static std::vector<int16_t> read_wav_data(const std::string &filepath)
+{
+	std::ifstream	ifs(filepath, std::ios::binary);
+	ifs.seekg(40);
+	uint32_t dataSize = 0;
+	ifs.read((char*)&dataSize, 4);
+
+	std::vector<int16_t> samples(dataSize / 2);
+	ifs.read((char*)samples.data(), dataSize);
+	return samples;
+}
+
+TEST(SoundSystem, OfflineRenderStartsOnTheRequestFrame)
+{
+	std::vector<int16_t> samples(20000);
+	for (size_t i = 0; i < samples.size(); i++) {
+		samples[i] = static_cast<int16_t>(1 + i % 1000);
+	}
+	write_wav_samples("temp_in.wav", 44100, samples);
+
+	const char *assets[] = { "temp_in.wav" };
+	const sound::RenderCommand script[] = {
+		{ 5000, sound::MakeMusicRequest_Play(1) }
+	};
+	ASSERT_FALSE(sound::RenderOffline("temp_out.wav", assets, 1, script, 1, 30000));
+
+	// Silence until the request, then the music to its end, then silence.
+	std::vector<int16_t> expected(5000, 0);
+	expected.insert(expected.end(), samples.begin(), samples.end());
+	expected.insert(expected.end(), 5000, 0);
+	EXPECT_EQ(read_wav_data("temp_out.wav"), expected);
+}
+
+TEST(SoundSystem, PlaysCompressedFiles)
+{
+	std::vector<int16_t> samples(20000);
+	for (size_t i = 0; i < samples.size(); i++) {
+		samples[i] = static_cast<int16_t>(8000 * std::sin(i * 0.05));
+	}
+
+	std::vector<byte> file;
+	sound::EncodeAdpcm(samples.data(), samples.size(), 1, 44100, 100, &file);
+	std::ofstream	ofs("temp_in.adpcm", std::ios::binary);
+	ofs.write((const char*)file.data(), file.size());
+	ofs.close();
+
+	std::vector<int16_t> decoded(20000);
+	sound::DecodeAdpcmBlocks(decoded.data(), file.data() + sound::kAdpcmHeaderSize, 200, 1, 100);
+
+	// Played to its end, then looped over a region that does not start on a block.
+	const char *assets[] = { "temp_in.adpcm" };
+	const sound::RenderCommand script[] = {
+		{ 0, sound::MakeMusicRequest_Play(1) },
+		{ 25000, sound::MakeMusicRequest_PlayLooped(1, 1050, 3000) }
+	};
+	ASSERT_FALSE(sound::RenderOffline("temp_out.wav", assets, 1, script, 2, 35000));
+
+	auto expected = decoded;
+	expected.insert(expected.end(), 5000, 0);
+	expected.insert(expected.end(), decoded.begin(), decoded.begin() + 3000);
+	while (expected.size() < 35000) {
+		expected.insert(expected.end(), decoded.begin() + 1050, decoded.begin() + 3000);
+	}
+	expected.resize(35000);
+	EXPECT_EQ(read_wav_data("temp_out.wav"), expected);
+}
+
+TEST(SoundSystem, PlaysFromTheAssetPack)
+{
+	std::vector<int16_t> samples(20000);
+	for (size_t i = 0; i < samples.size(); i++) {
+		samples[i] = static_cast<int16_t>(1 + i % 1000);
+	}
+	write_wav_samples("temp_packed.wav", 44100, samples);
+	ASSERT_FALSE(sound::BuildAssetPack("temp.pack", { "temp_packed.wav" }));
+
+	// The file is only in the pack now.
+	remove("temp_packed.wav");
+
+	sound::SoundSystemDesc	desc;
+	desc.packFilename = "temp.pack";
+
+	const char *assets[] = { "temp_packed.wav" };
+	const sound::RenderCommand script[] = {
+		{ 0, sound::MakeMusicRequest_Play(1) }
+	};
+	ASSERT_FALSE(sound::RenderOffline("temp_out.wav", assets, 1, script, 1, 25000, desc));
+
+	auto expected = samples;
+	expected.insert(expected.end(), 5000, 0);
+	EXPECT_EQ(read_wav_data("temp_out.wav"), expected);
+
+	// A pack that cannot be opened fails the creation.
+	desc.packFilename = "temp_none.pack";
+	sound::SoundSystem	*system = nullptr;
+	EXPECT_TRUE(sound::CreateOfflineSoundSystem(new sound::NullDevice(sound::DEVICE_CLOCK_MANUAL), &system, desc));
+	EXPECT_EQ(system, nullptr);
+}
+
+TEST(SoundSystem, OfflineRenderIsDeterministic)
+{
+	std::vector<int16_t> samples(44100);
+	for (size_t i = 0; i < samples.size(); i++) {
+		samples[i] = static_cast<int16_t>(1 + i % 1000);
+	}
+	write_wav_samples("temp_in.wav", 44100, samples);
+	write_wav("temp_in2.wav", 44100, 2000, 0x100);
+
+	const char *assets[] = { "temp_in.wav", "temp_in2.wav" };
+	const sound::RenderCommand script[] = {
+		{ 0, sound::MakeMusicRequest_Play(1) },
+		{ 10000, sound::MakeMusicRequest_PlaySound(2) },
+		{ 20000, sound::MakeMusicRequest_PlayCrossfade(2, 100, sound::FADE_CURVE_LINEAR) },
+		{ 30000, sound::MakeMusicRequest_Play(1) },
+		{ 40000, sound::MakeMusicRequest_Stop() }
+	};
+	ASSERT_FALSE(sound::RenderOffline("temp_out.wav", assets, 2, script, 5, 50000));
+	ASSERT_FALSE(sound::RenderOffline("temp_out2.wav", assets, 2, script, 5, 50000));
+
+	auto first = read_wav_data("temp_out.wav");
+	ASSERT_EQ(first.size(), 50000u);
+	EXPECT_EQ(first, read_wav_data("temp_out2.wav"));
+
+	// The music starts on the first frame, the sound mixes over it from a later refill,
+	// and the music stops on the frame of the request.
+	EXPECT_TRUE(std::equal(first.begin(), first.begin() + 10000, samples.begin()));
+	EXPECT_TRUE(std::equal(first.begin() + 30000, first.begin() + 40000, samples.begin()));
+	EXPECT_EQ(std::count(first.begin() + 40000, first.end(), 0), 10000);
+	EXPECT_NE(first[13000], samples[13000]);
+
+	// The render needs a device that it can move.
+	sound::SoundSystem	*system = nullptr;
+	EXPECT_TRUE(sound::CreateOfflineSoundSystem(new sound::NullDevice(), &system));
+	EXPECT_EQ(system, nullptr);
+}
+
+TEST(SoundSystem, PlaysRegisteredAssets)
+{
+	std::vector<int16_t> samples(20000);
+	for (size_t i = 0; i < samples.size(); i++) {
+		samples[i] = static_cast<int16_t>(1 + i % 1000);
+	}
+	write_wav_samples("temp_in.wav", 44100, samples);
+
+	sound::SoundSystemDesc	desc;
+	desc.maxAssets = 2;
+
+	sound::SoundSystem	*system = nullptr;
+	auto device = new sound::WavFileDevice("temp_out.wav", sound::DEVICE_CLOCK_MANUAL);
+	ASSERT_FALSE(sound::CreateOfflineSoundSystem(device, &system, desc));
+
+	sound::AssetHandle music = sound::kInvalidAssetHandle;
+	ASSERT_FALSE(system->Register("temp_in.wav", &music));
+	EXPECT_NE(music, sound::kInvalidAssetHandle);
+
+	// Only registered handles and playable files are accepted.
+	EXPECT_TRUE(system->Play(sound::kInvalidAssetHandle));
+	EXPECT_TRUE(system->PlaySound(music + 1));
+	EXPECT_TRUE(system->Play("temp_none.wav"));
+
+	ASSERT_FALSE(system->Play(music));
+	ASSERT_FALSE(system->Render(25000));
+	sound::DestroySoundSystem(&system);
+
+	auto expected = samples;
+	expected.insert(expected.end(), 5000, 0);
+	EXPECT_EQ(read_wav_data("temp_out.wav"), expected);
+
+	// A script whose assets cannot be registered is not rendered.
+	const char *assets[] = { "temp_none.wav" };
+	EXPECT_TRUE(sound::RenderOffline("temp_out.wav", assets, 1, nullptr, 0, 1000));
+}
+
+TEST(SoundSystem, SteadyStateDoesNotAllocate)
+{
+	std::vector<int16_t> samples(30000);
+	for (size_t i = 0; i < samples.size(); i++) {
+		samples[i] = static_cast<int16_t>(8000 * std::sin(i * 0.05));
+	}
+	write_wav_samples("temp_in.wav", 44100, samples);
+	write_wav_samples("temp_in2.wav", 22050, std::vector<int16_t>(samples.begin(), samples.begin() + 5000));
+	write_wav_samples("temp_in3.wav", 44100, std::vector<int16_t>(samples.begin(), samples.begin() + 8000));
+	write_wav_samples("temp_in4.wav", 22050, std::vector<int16_t>(samples.begin(), samples.begin() + 4000));
+
+	std::vector<byte> file;
+	sound::EncodeAdpcm(samples.data(), samples.size(), 1, 44100, 100, &file);
+	std::ofstream	ofs("temp_in.adpcm", std::ios::binary);
+	ofs.write((const char*)file.data(), file.size());
+	ofs.close();
+
+	sound::SoundSystem	*system = nullptr;
+	ASSERT_FALSE(sound::CreateOfflineSoundSystem(new sound::NullDevice(sound::DEVICE_CLOCK_MANUAL), &system));
+
+	sound::AssetHandle music, sound22k, compressed, newMusic, newSound;
+	ASSERT_FALSE(system->Register("temp_in.wav", &music));
+	ASSERT_FALSE(system->Register("temp_in2.wav", &sound22k));
+	ASSERT_FALSE(system->Register("temp_in.adpcm", &compressed));
+	ASSERT_FALSE(system->Register("temp_in3.wav", &newMusic));
+	ASSERT_FALSE(system->Register("temp_in4.wav", &newSound));
+
+	// Musics, sounds at another rate, a crossfade, a loop of a compressed file, and a queued music.
+	auto play = [&]() {
+		system->Play(music);
+		system->Render(5000);
+		system->PlaySound(sound22k);
+		system->PlaySound(music);
+		system->Render(5000);
+		system->PlayWithCrossfade(compressed, 100);
+		system->Render(5000);
+		system->PlayLooped(compressed, 1050, 3000);
+		system->Render(5000);
+		system->PlayNext(music);
+		system->Render(10000);
+		system->Stop();
+		system->Render(40000);
+	};
+
+	// The music voices swap at each crossfade: after two rounds, each of them opened every file.
+	play();
+	play();
+	EXPECT_FALSE(system->IsPlaying());
+
+	// Assets played for the first time are mapped, read to their end and handed over
+	// to the cache, without an allocation either.
+	const auto residentBytes = system->CacheStats().residentBytes;
+
+	g_numAllocations = 0;
+	t_countAllocations = true;
+	play();
+	system->Play(newMusic);
+	system->PlaySound(newSound);
+	system->Render(20000);
+	t_countAllocations = false;
+
+	EXPECT_EQ(g_numAllocations.load(), 0u);
+	EXPECT_FALSE(system->IsPlaying());
+	EXPECT_EQ(system->CacheStats().residentBytes, residentBytes + (44 + 16000) + (44 + 8000));
+
+	sound::DestroySoundSystem(&system);
+}
+
+TEST(SoundSystem, PauseKeepsThePosition)
+{
+	// A sawtooth shows any frame played twice or skipped.
+	std::vector<int16_t> samples(30000);
+	for (size_t i = 0; i < samples.size(); i++) {
+		samples[i] = static_cast<int16_t>(1 + i % 1000);
+	}
+	write_wav_samples("temp_in.wav", 44100, samples);
+
+	auto device = new sound::WavFileDevice("temp_out.wav", sound::DEVICE_CLOCK_MANUAL);
+
+	sound::SoundSystem	*system = nullptr;
+	ASSERT_FALSE(sound::CreateOfflineSoundSystem(device, &system));
+
+	sound::AssetHandle music;
+	ASSERT_FALSE(system->Register("temp_in.wav", &music));
+	ASSERT_FALSE(system->Play(music));
+	ASSERT_FALSE(system->Render(7000));
+
+	ASSERT_FALSE(system->Pause());
+	ASSERT_FALSE(system->Render(5000));
+	EXPECT_TRUE(system->IsPaused());
+	EXPECT_TRUE(system->IsPlaying());
+
+	// While paused, and to resume, nothing is read, mixed or allocated.
+	const auto numRefills = system->Health().numRefills;
+	g_numAllocations = 0;
+	t_countAllocations = true;
+	system->Render(5000);
+	system->Resume();
+	system->Render(0);
+	t_countAllocations = false;
+	EXPECT_EQ(g_numAllocations.load(), 0u);
+	EXPECT_EQ(system->Health().numRefills, numRefills);
+	EXPECT_FALSE(system->IsPaused());
+
+	ASSERT_FALSE(system->Render(30000));
+	EXPECT_FALSE(system->IsPlaying());
+	sound::DestroySoundSystem(&system);
+
+	// The music goes on from the frame it was paused at.
+	std::vector<int16_t> expected(samples.begin(), samples.begin() + 7000);
+	expected.insert(expected.end(), 10000, 0);
+	expected.insert(expected.end(), samples.begin() + 7000, samples.end());
+	expected.resize(47000, 0);
+	EXPECT_EQ(read_wav_data("temp_out.wav"), expected);
+}
+
+TEST(SoundSystem, NewMusicEndsThePause)
+{
+	write_wav("temp_in.wav", 44100, 20000, 0x1111);
+
+	sound::SoundSystem	*system = nullptr;
+	ASSERT_FALSE(sound::CreateOfflineSoundSystem(new sound::NullDevice(sound::DEVICE_CLOCK_MANUAL), &system));
+
+	// Nothing to pause.
+	ASSERT_FALSE(system->Pause());
+	ASSERT_FALSE(system->Render(1000));
+	EXPECT_FALSE(system->IsPaused());
+
+	ASSERT_FALSE(system->Play("temp_in.wav"));
+	ASSERT_FALSE(system->Render(1000));
+	ASSERT_FALSE(system->Pause());
+	ASSERT_FALSE(system->Render(1000));
+	EXPECT_TRUE(system->IsPaused());
+
+	// The crossfade is heard: it starts from the paused position.
+	ASSERT_FALSE(system->PlayWithCrossfade("temp_in.wav", 10));
+	ASSERT_FALSE(system->Render(1000));
+	EXPECT_FALSE(system->IsPaused());
+
+	// Stopping everything ends the pause too.
+	ASSERT_FALSE(system->Pause());
+	ASSERT_FALSE(system->Stop());
+	ASSERT_FALSE(system->Render(1000));
+	EXPECT_FALSE(system->IsPaused());
+	EXPECT_FALSE(system->IsPlaying());
+
+	sound::DestroySoundSystem(&system);
+}
@@ -0,0 +1,47 @@
+#include "pch.h"
+#include "../soundsys/HeadlessDevice.h"
+#include "../soundsys/StreamingBuffer.h"
+#include "../soundsys/AudioFormat.h"
+#include <stdexcept>
+
+TEST(StreamingBuffer, RegionsAreWholeFramesOfTheLatency)
+{
+	sound::NullDevice	device;
+	auto format = sound::MakeWaveFormat(WAVE_FORMAT_PCM, 2, 48000, 16);
+
+	// 60 ms in 4 regions of 15 ms, that is 720 frames.
+	sound::StreamingBuffer	buffer(&device, format, 60, 4);
+	EXPECT_EQ(buffer.NumRegions(), 4);
+	EXPECT_EQ(buffer.RegionSize(), 720u * 4);
+	EXPECT_EQ(buffer.Capacity(), 4 * buffer.RegionSize());
+
+	// The regions follow each other, half a region after the start of the buffer.
+	for (int i = 0; i < 4; i++) {
+		EXPECT_EQ(buffer.RegionStart(i), 360u * 4 + i * buffer.RegionSize());
+		EXPECT_EQ(buffer.RegionStart(i) % format.nBlockAlign, 0u);
+	}
+}
+
+TEST(StreamingBuffer, CursorCrossesEachRegionInTurn)
+{
+	sound::NullDevice	device(sound::DEVICE_CLOCK_AS_FAST_AS_POSSIBLE);
+	sound::StreamingBuffer	buffer(&device, sound::DefaultWaveFormat(), 40, 8);
+
+	buffer.Play();
+
+	int pos = -1;
+	for (int i = 0; i < 20; i++) {
+		EXPECT_TRUE(buffer.APositionWasSignaled(&pos));
+		EXPECT_EQ(pos, i % 8);
+		EXPECT_EQ(device.PlayCursor(), buffer.RegionStart(pos));
+	}
+	buffer.Stop();
+}
+
+TEST(StreamingBuffer, RejectsUnsupportedRegionCounts)
+{
+	sound::NullDevice	device;
+
+	EXPECT_THROW(sound::StreamingBuffer(&device, sound::DefaultWaveFormat(), 100, 1), std::runtime_error);
+	EXPECT_THROW(sound::StreamingBuffer(&device, sound::DefaultWaveFormat(), 100, sound::StreamingBuffer::kMaxRegions + 1), std::runtime_error);
+}
@@ -0,0 +1,112 @@
+#include "pch.h"
+#include "../soundsys/Trace.h"
+
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(Trace, RingKeepsTheLatestRecordsInOrder)
+{
+	auto ring = std::make_unique<sound::TraceRing>();
+	const auto kNumRecords = sound::TraceRing::kCapacity + 100;
+
+	for (uint32_t i = 0; i < kNumRecords; i++) {
+		ring->Push(sound::TRACE_LEVEL_INFO, sound::TRACE_EVENT_REFILL, i, 2 * i, 3 * i);
+	}
+	EXPECT_EQ(ring->NumPushed(), kNumRecords);
+
+	std::vector<sound::TraceRecord> records(sound::TraceRing::kCapacity);
+	ASSERT_EQ(ring->Snapshot(records.data(), records.size()), sound::TraceRing::kCapacity);
+
+	// The 100 oldest records were overwritten.
+	for (uint32_t i = 0; i < sound::TraceRing::kCapacity; i++) {
+		const auto &record = records[i];
+		EXPECT_EQ(record.event, sound::TRACE_EVENT_REFILL);
+		EXPECT_EQ(record.level, sound::TRACE_LEVEL_INFO);
+		EXPECT_EQ(record.arg0, i + 100);
+		EXPECT_EQ(record.arg1, 2ull * (i + 100));
+		EXPECT_EQ(record.arg2, 3ull * (i + 100));
+		if (i > 0) {
+			EXPECT_LE(records[i - 1].timeNs, record.timeNs);
+		}
+	}
+
+	// A smaller snapshot has the most recent records.
+	sound::TraceRecord last[2];
+	ASSERT_EQ(ring->Snapshot(last, 2), 2u);
+	EXPECT_EQ(last[1].arg0, kNumRecords - 1);
+}
+
+TEST(Trace, ThreadsPushWithoutLosingRecords)
+{
+	auto ring = std::make_unique<sound::TraceRing>();
+	const int kNumThreads = 4;
+	const uint32_t kRecordsPerThread = sound::TraceRing::kCapacity / kNumThreads;
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < kNumThreads; t++) {
+		threads.emplace_back([&ring, t, kRecordsPerThread]() {
+			for (uint32_t i = 0; i < kRecordsPerThread; i++) {
+				ring->Push(sound::TRACE_LEVEL_VERBOSE, sound::TRACE_EVENT_WRITE, t, i, 0);
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	std::vector<sound::TraceRecord> records(sound::TraceRing::kCapacity);
+	ASSERT_EQ(ring->Snapshot(records.data(), records.size()), sound::TraceRing::kCapacity);
+
+	// The records of each thread are all there, in the order they were pushed.
+	std::vector<uint64_t> next(kNumThreads, 0);
+	for (const auto &record : records) {
+		ASSERT_LT(record.arg0, static_cast<uint32_t>(kNumThreads));
+		EXPECT_EQ(record.arg1, next[record.arg0]);
+		next[record.arg0]++;
+	}
+	for (int t = 0; t < kNumThreads; t++) {
+		EXPECT_EQ(next[t], kRecordsPerThread);
+	}
+}
+
+TEST(Trace, FileRoundTrip)
+{
+	const char *kFilename = "test_trace.bin";
+
+	sound::GlobalTraceRing().Push(sound::TRACE_LEVEL_WARNING, sound::TRACE_EVENT_UNDERRUN, 3, 1234, 0);
+	ASSERT_EQ(sound::WriteTraceFile(kFilename), ERROR_NONE);
+
+	std::vector<sound::TraceRecord> records;
+	ASSERT_EQ(sound::ReadTraceFile(kFilename, &records), ERROR_NONE);
+	remove(kFilename);
+
+	ASSERT_FALSE(records.empty());
+	const auto &record = records.back();
+	EXPECT_EQ(record.event, sound::TRACE_EVENT_UNDERRUN);
+	EXPECT_EQ(record.level, sound::TRACE_LEVEL_WARNING);
+	EXPECT_EQ(record.arg0, 3u);
+	EXPECT_EQ(record.arg1, 1234u);
+
+	EXPECT_NE(sound::ReadTraceFile("no_such_file.trace", &records), ERROR_NONE);
+}
+
+TEST(Trace, DescribeNamesTheArguments)
+{
+	sound::TraceRecord record{};
+	record.timeNs = 2500000;
+	record.event = sound::TRACE_EVENT_UNDERRUN;
+	record.level = sound::TRACE_LEVEL_WARNING;
+	record.arg0 = 3;
+	record.arg1 = 1234;
+
+	auto line = sound::DescribeTraceRecord(record, 1000000);
+	EXPECT_NE(line.find("1.500 ms"), std::string::npos);
+	EXPECT_NE(line.find("WARNING"), std::string::npos);
+	EXPECT_NE(line.find("UNDERRUN"), std::string::npos);
+	EXPECT_NE(line.find("region=3 distance=1234"), std::string::npos);
+
+	record.event = 999;
+	EXPECT_NE(sound::DescribeTraceRecord(record, 0).find("UNKNOWN"), std::string::npos);
+}
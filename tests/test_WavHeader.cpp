@@ -0,0 +1,127 @@
+#include "pch.h"
+#include "../soundsys/WavHeader.h"
+#include "../soundsys/AudioFormat.h"
+#include <sstream>
+#include <vector>
+
+static void put16(std::vector<byte> *out, uint16_t v)
+{
+	out->push_back(static_cast<byte>(v));
+	out->push_back(static_cast<byte>(v >> 8));
+}
+
+static void put32(std::vector<byte> *out, uint32_t v)
+{
+	put16(out, static_cast<uint16_t>(v));
+	put16(out, static_cast<uint16_t>(v >> 16));
+}
+
+static void put_id(std::vector<byte> *out, const char *id)
+{
+	out->insert(out->end(), id, id + 4);
+}
+
+// make_wav returns a WAV file with a LIST chunk of odd size before the data chunk.
+// If extensible is true, the fmt chunk is a WAVEFORMATEXTENSIBLE.
+static std::vector<byte> make_wav(const WAVEFORMATEX &format, size_t dataSize, bool extensible = false)
+{
+	std::vector<byte> wav;
+	put_id(&wav, "RIFF");
+	put32(&wav, 0);// Not checked.
+	put_id(&wav, "WAVE");
+
+	put_id(&wav, "fmt ");
+	put32(&wav, extensible ? 40 : 16);
+	put16(&wav, extensible ? WAVE_FORMAT_EXTENSIBLE : format.wFormatTag);
+	put16(&wav, format.nChannels);
+	put32(&wav, format.nSamplesPerSec);
+	put32(&wav, format.nAvgBytesPerSec);
+	put16(&wav, format.nBlockAlign);
+	put16(&wav, format.wBitsPerSample);
+	if (extensible) {
+		put16(&wav, 22);
+		put16(&wav, format.wBitsPerSample);
+		put32(&wav, 3);
+		put16(&wav, format.wFormatTag);
+		wav.insert(wav.end(), 14, 0);// Rest of the GUID.
+	}
+
+	put_id(&wav, "LIST");
+	put32(&wav, 3);
+	wav.insert(wav.end(), 4, 0xEE);// Padded to an even size.
+
+	put_id(&wav, "data");
+	put32(&wav, static_cast<uint32_t>(dataSize));
+	wav.insert(wav.end(), dataSize, 0x11);
+
+	return wav;
+}
+
+TEST(WavHeader, FindsTheDataChunk)
+{
+	auto format = sound::MakeWaveFormat(WAVE_FORMAT_PCM, 2, 48000, 24);
+	auto wav = make_wav(format, 600);
+
+	sound::WavInfo info;
+	ASSERT_FALSE(sound::ParseWavHeader(wav.data(), wav.size(), &info));
+	EXPECT_EQ(info.format.nChannels, 2);
+	EXPECT_EQ(info.format.nSamplesPerSec, 48000u);
+	EXPECT_EQ(sound::SampleTypeOf(info.format), sound::SAMPLE_TYPE_S24);
+	EXPECT_EQ(info.dataOffset, wav.size() - 600);
+	EXPECT_EQ(info.dataSize, 600u);
+}
+
+TEST(WavHeader, ReadsExtensibleFormats)
+{
+	auto format = sound::MakeWaveFormat(WAVE_FORMAT_IEEE_FLOAT, 2, 48000, 32);
+	auto wav = make_wav(format, 800, true);
+
+	sound::WavInfo info;
+	ASSERT_FALSE(sound::ParseWavHeader(wav.data(), wav.size(), &info));
+	EXPECT_EQ(sound::SampleTypeOf(info.format), sound::SAMPLE_TYPE_F32);
+	EXPECT_EQ(info.dataSize, 800u);
+}
+
+TEST(WavHeader, TruncatedDataStopsAtTheEndOfTheFile)
+{
+	auto format = sound::MakeWaveFormat(WAVE_FORMAT_PCM, 1, 44100, 16);
+	auto wav = make_wav(format, 100);
+	wav.resize(wav.size() - 51);
+
+	sound::WavInfo info;
+	ASSERT_FALSE(sound::ParseWavHeader(wav.data(), wav.size(), &info));
+	EXPECT_EQ(info.dataSize, 48u);
+}
+
+TEST(WavHeader, HeaderlessFilesHaveTheDefaultFormat)
+{
+	std::vector<byte> raw(1001, 0x22);
+
+	sound::WavInfo info;
+	ASSERT_FALSE(sound::ParseWavHeader(raw.data(), raw.size(), &info));
+	EXPECT_EQ(info.format.nSamplesPerSec, sound::DefaultWaveFormat().nSamplesPerSec);
+	EXPECT_EQ(info.dataOffset, 0u);
+	EXPECT_EQ(info.dataSize, 1000u);
+}
+
+TEST(WavHeader, RejectsUnsupportedFormats)
+{
+	auto format = sound::MakeWaveFormat(WAVE_FORMAT_PCM, 6, 48000, 16);
+	auto wav = make_wav(format, 120);
+
+	sound::WavInfo info;
+	EXPECT_EQ(sound::ParseWavHeader(wav.data(), wav.size(), &info), ERROR_FAILURE);
+}
+
+TEST(WavHeader, StreamIsPositionedAtTheData)
+{
+	auto format = sound::MakeWaveFormat(WAVE_FORMAT_PCM, 1, 44100, 16);
+	auto wav = make_wav(format, 10);
+
+	std::istringstream stream(std::string(wav.begin(), wav.end()));
+
+	sound::WavInfo info;
+	ASSERT_FALSE(sound::ParseWavHeader(&stream, &info));
+	EXPECT_EQ(static_cast<size_t>(stream.tellg()), info.dataOffset);
+	EXPECT_EQ(stream.get(), 0x11);
+}